@@ -0,0 +1,60 @@
+#!/bin/sh
+# Parser scaling benchmark: compiles generated programs of growing size and
+# reports the marginal cost per element between consecutive sizes, which
+# cancels the fixed per-program cost (trace generation, JSON output). Linear
+# list building keeps it flat; quadratic building grows it with N.
+#
+#   sh scripts/bench_parser.sh [path/to/dsa_compiler]
+set -e
+
+COMPILER=${1:-./dsa_compiler}
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/dsa_bench.XXXXXX")
+trap 'rm -rf "$WORK"' EXIT
+
+# Compile time in ms, taken from the batch summary (excludes process start)
+compile_ms() {
+    "$COMPILER" -b -t 1 -d "$WORK/out" "$1" >/dev/null
+    sed -n 's/.*"status": "ok".*"timeMs": \([0-9.]*\).*/\1/p' "$WORK/out/summary.json"
+}
+
+# The literal is parsed in full, but a program without calls would sort it
+# with the default algorithm; a call whose trace does not grow with N keeps
+# trace generation out of the measurement
+gen_array() {
+    awk -v n="$1" 'BEGIN {
+        printf "arr[] = [";
+        for (i = 0; i < n; i++) printf "%s%d", (i ? "," : ""), (i * 7919) % 100003;
+        print "];";
+        print "stack.peek();";
+    }' > "$2"
+}
+
+gen_statements() {
+    awk -v n="$1" 'BEGIN { for (i = 0; i < n; i++) printf "x%d = %d;\n", i, i; }' > "$2"
+}
+
+run() {
+    kind=$1; shift
+    prev_n=0
+    prev_ms=0
+    for n in "$@"; do
+        "gen_$kind" "$n" "$WORK/input.algo"
+        ms=$(compile_ms "$WORK/input.algo")
+        if [ -z "$ms" ]; then
+            echo "$kind n=$n: compile failed" >&2
+            exit 1
+        fi
+        ns=-
+        if [ "$prev_n" -gt 0 ]; then
+            ns=$(awk -v ms="$ms" -v pms="$prev_ms" -v n="$n" -v pn="$prev_n" \
+                 'BEGIN { printf "%.1f", (ms - pms) * 1e6 / (n - pn) }')
+        fi
+        printf "%-12s %10d %12s %16s\n" "$kind" "$n" "$ms" "$ns"
+        prev_n=$n
+        prev_ms=$ms
+    done
+}
+
+printf "%-12s %10s %12s %16s\n" "input" "N" "ms" "marginal ns/elem"
+run array 1000 250000 500000 1000000
+run statements 1000 25000 50000 100000
@@ -0,0 +1,53 @@
+#!/bin/sh
+# Example check: every shipped program in tests/examples must compile (the
+# deliberate error examples must not), and each tests/inputs/<name>.algo
+# must produce exactly tests/expected/<name>.json.
+#
+#   sh scripts/check_examples.sh [path/to/dsa_compiler]
+
+COMPILER=${1:-./dsa_compiler}
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/dsa_check.XXXXXX")
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+
+# Batch mode writes <name>.json without starting the visualizer
+compile() {
+    "$COMPILER" -b -t 1 -d "$WORK" "$1" >"$WORK/log" 2>&1
+}
+
+for f in tests/examples/*.algo; do
+    case $(basename "$f" .algo) in
+        # Unknown names, bad tokens and a loop that never ends. test_bs
+        # calls binary_search, which is not a built-in.
+        *error* | test_runaway | test_bs)
+            if compile "$f"; then
+                echo "FAIL $f: compiled, but is an error example"
+                failed=1
+            fi
+            ;;
+        *)
+            if ! compile "$f"; then
+                echo "FAIL $f: did not compile"
+                sed 's/^/    /' "$WORK/log"
+                failed=1
+            fi
+            ;;
+    esac
+done
+
+for f in tests/inputs/*.algo; do
+    name=$(basename "$f" .algo)
+    if ! compile "$f"; then
+        echo "FAIL $f: did not compile"
+        sed 's/^/    /' "$WORK/log"
+        failed=1
+    elif ! cmp -s "$WORK/$name.json" "tests/expected/$name.json"; then
+        echo "FAIL $f: trace differs from tests/expected/$name.json"
+        diff "tests/expected/$name.json" "$WORK/$name.json" | head -20
+        failed=1
+    fi
+done
+
+[ $failed = 0 ] && echo "All examples ok"
+exit $failed
@@ -18,11 +18,14 @@ if ($Regenerate -or -not (Test-Path "$root\parser.tab.c") -or -not (Test-Path "$
 
 # Build with strict flags (sources in src/)
 Write-Host "[build] Compiling with warnings as errors" -ForegroundColor Cyan
+& gcc -std=c11 -O2 -Wall -Wextra -Werror -Isrc -pthread -c -o algorithms.o src\algorithms.c
+& gcc -std=c11 -O2 -Wall -Wextra -Werror -Isrc -pthread -c -o threadpool.o src\threadpool.c
+& ar rcs libalgorithms.a algorithms.o threadpool.o
 $gccArgs = @(
-    '-std=c11','-Wall','-Wextra','-Werror','-Isrc',
+    '-std=c11','-Wall','-Wextra','-Werror','-Isrc','-pthread',
     '-o','dsa_compiler',
-    'parser.tab.c','lex.yy.c','src\ast.c','src\ir.c','src\codegen.c','src\main.c',
-    '-lfl'
+    'parser.tab.c','lex.yy.c','src\arena.c','src\symbols.c','src\ast.c','src\ir.c','src\codegen.c','src\vm.c','src\compiler.c','src\source.c','src\dataload.c','src\generators.c','src\batch.c','src\tracecache.c','src\watch.c','src\traceevents.c','src\main.c',
+    '-L.','-lalgorithms'
 )
 & gcc @gccArgs
 
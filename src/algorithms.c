@@ -1,515 +1,2500 @@
 // algorithms.c
-// Implementations of sorting algorithms and basic data-structure operations
-// Designed to be called by a compiler backend (e.g., codegen.c) which may
-// pass a callback to collect IR/visualization steps.
+// The algorithm engine: every sort and data structure the compiler can
+// visualize, emitting its steps into a TraceSink (see algorithms.h).
 //
-// The file provides:
-//  - Sorting: bubble_sort, selection_sort, insertion_sort, quick_sort, merge_sort
-//  - Stack: stack_create, stack_push, stack_pop, stack_peek
-//  - Queue: queue_create, queue_enqueue, queue_dequeue, queue_peek
-//  - Binary Search Tree (BST): bst_insert, bst_traverse_inorder/preorder/postorder
-//  - Graph: graph_create, graph_add_node, graph_add_edge, graph_bfs, graph_dfs
-//
-// Each algorithm accepts an optional callback of signature `ir_callback_t`
-// which is invoked with descriptive actions and integer arguments so the
-// compiler/visualizer can build the IR or JSON steps.
-//
-// Example callback signature:
-//    typedef void (*ir_callback_t)(const char *action, const int *args, int nargs, void *ctx);
-// `action`   - a short string like "compare", "swap", "push", "enqueue", "insert", "visit"
-// `args`     - integer arguments (indices, values, node ids) meaningful per action
-// `nargs`    - number of args in the args array
-// `ctx`      - user-provided context passed through (e.g., pointer to IR accumulator)
-//
-// If callback is NULL, the algorithm runs normally but does not emit steps.
+// Each public function forwards to a body that takes the sink last. The
+// body is inlined twice, once with a literal NULL sink; that copy has
+// every emit() folded away, so untraced runs pay nothing for tracing.
+// With TRACE_INLINE_SINKS (the default; build with -DTRACE_INLINE_SINKS=0
+// to send every step through the sink's function pointer) emit() also
+// recognises a CountingSink and counts the step in place, its action
+// compared as a constant, so counting costs a test and an increment.
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include "algorithms.h"
+#include "threadpool.h"
 
-/* Callback type used to emit IR steps to the rest of the pipeline */
-typedef void (*ir_callback_t)(const char *action, const int *args, int nargs, void *ctx);
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+#endif
 
-/* ---------------------------
-   Utility helpers
-   --------------------------- */
-static void emit(ir_callback_t cb, const char *action, const int *args, int nargs, void *ctx) {
-    if (cb) cb(action, args, nargs, ctx);
+#if defined(__GNUC__)
+#define BODY static inline __attribute__((always_inline))
+#else
+#define BODY static inline
+#endif
+
+#ifndef TRACE_INLINE_SINKS
+#define TRACE_INLINE_SINKS 1
+#endif
+
+// Calls `body` with a constant NULL sink when there is none
+#define WITH_SINK(body, ...) (sink ? body(__VA_ARGS__, sink) : body(__VA_ARGS__, NULL))
+
+BODY void count_step(CountingSink *s, const char *action) {
+    s->steps++;
+    if (strcmp(action, "compare") == 0) s->compares++;
+    else if (strcmp(action, "swap") == 0) s->swaps++;
+}
+
+static void counting_sink_step(TraceSink *sink, const char *action, const int *args, int nargs);
+
+BODY void emit(TraceSink *sink, const char *action, const int *args, int nargs) {
+    if (!sink) return;
+#if TRACE_INLINE_SINKS
+    if (sink->step == counting_sink_step) {
+        count_step((CountingSink *)sink, action);
+        return;
+    }
+#endif
+    sink->step(sink, action, args, nargs);
+}
+
+BODY void emit2(TraceSink *sink, const char *action, int a, int b) {
+    int args[2] = { a, b };
+    emit(sink, action, args, 2);
+}
+
+BODY void emit1(TraceSink *sink, const char *action, int a) {
+    emit(sink, action, &a, 1);
+}
+
+BODY int stop_requested(TraceSink *sink) {
+    return sink && sink->stopped && sink->stopped(sink);
+}
+
+BODY void set_lane(TraceSink *sink, int lane) {
+    if (sink && sink->lane) sink->lane(sink, lane);
 }
 
 static void swap_int(int *a, int *b) {
     int t = *a; *a = *b; *b = t;
 }
 
+/* ---------------------------
+   Sinks
+   --------------------------- */
+
+static void ir_sink_step(TraceSink *sink, const char *action, const int *args, int nargs) {
+    IRSink *s = (IRSink *)sink;
+    if (s->status) return;  // Keep the first failure; later steps would leave gaps
+    s->status = addIRWithIndices(s->ir, action, "", (int *)args, nargs);
+}
+
+static int ir_sink_stopped(TraceSink *sink) {
+    return ((IRSink *)sink)->status != 0;
+}
+
+static void ir_sink_lane(TraceSink *sink, int lane) {
+    setIRLane(((IRSink *)sink)->ir, lane);
+}
+
+void ir_sink_init(IRSink *sink, IRContext *ir) {
+    sink->base.step = ir_sink_step;
+    sink->base.stopped = ir_sink_stopped;
+    sink->base.lane = ir_sink_lane;
+    sink->ir = ir;
+    sink->status = 0;
+}
+
+static char *append_text(char *p, const char *text, size_t max) {
+    while (max-- && *text) *p++ = *text++;
+    return p;
+}
+
+static char *append_int(char *p, int value) {
+    unsigned int v = (unsigned int)value;
+    char digits[10];
+    int n = 0;
+    if (value < 0) {
+        *p++ = '-';
+        v = 0u - v;
+    }
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+// Same members as a step in writeIRToJSON. The line is formatted by hand
+// and written with one fwrite, a fraction of what fprintf per member costs.
+static void stream_sink_step(TraceSink *sink, const char *action, const int *args, int nargs) {
+    StreamSink *s = (StreamSink *)sink;
+    char line[192];
+    char *p = append_text(line, "{\"action\": \"", 16);
+    p = append_text(p, action, 64);
+    *p++ = '"';
+    if (nargs > TRACE_MAX_ARGS) nargs = TRACE_MAX_ARGS;
+    if (nargs == 1) {
+        p = append_text(p, ", \"index\": ", 16);
+        p = append_int(p, args[0]);
+    } else if (nargs > 1) {
+        p = append_text(p, ", \"indices\": [", 16);
+        for (int i = 0; i < nargs; i++) {
+            if (i) p = append_text(p, ", ", 2);
+            p = append_int(p, args[i]);
+        }
+        *p++ = ']';
+    }
+    if (s->lane >= 0) {
+        p = append_text(p, ", \"lane\": ", 16);
+        p = append_int(p, s->lane);
+    }
+    *p++ = '}';
+    *p++ = '\n';
+    fwrite(line, 1, (size_t)(p - line), s->fp);
+    s->steps++;
+}
+
+static void stream_sink_lane(TraceSink *sink, int lane) {
+    ((StreamSink *)sink)->lane = lane;
+}
+
+void stream_sink_init(StreamSink *sink, FILE *fp) {
+    sink->base.step = stream_sink_step;
+    sink->base.stopped = NULL;
+    sink->base.lane = stream_sink_lane;
+    sink->fp = fp;
+    sink->steps = 0;
+    sink->lane = -1;
+}
+
+static void counting_sink_step(TraceSink *sink, const char *action, const int *args, int nargs) {
+    (void)args;
+    (void)nargs;
+    count_step((CountingSink *)sink, action);
+}
+
+void counting_sink_init(CountingSink *sink) {
+    sink->base.step = counting_sink_step;
+    sink->base.stopped = NULL;
+    sink->base.lane = NULL;
+    sink->steps = 0;
+    sink->compares = 0;
+    sink->swaps = 0;
+}
+
 /* ---------------------------
    Sorting algorithms
-   Each sorting function receives:
-     - arr: pointer to int array
-     - n: length of array
-     - cb: optional callback (can be NULL)
-     - ctx: optional context passed to callback
-   Callbacks emit actions suitable for visualization/IR.
+   The sorts poll stop_requested() once per pass, never per step.
    --------------------------- */
 
-/* Bubble Sort */
-void bubble_sort(int *arr, int n, ir_callback_t cb, void *ctx) {
-    int comparisons = 0, swaps = 0;
-    for (int pass = 0; pass < n - 1; ++pass) {
-        for (int i = 0; i < n - pass - 1; ++i) {
-            int args_cmp[2] = { i, i+1 };
-            emit(cb, "compare", args_cmp, 2, ctx);  // compare i and i+1
-            ++comparisons;
-            if (arr[i] > arr[i+1]) {
-                int args_swap[2] = { i, i+1 };
-                swap_int(&arr[i], &arr[i+1]);
-                emit(cb, "swap", args_swap, 2, ctx); // swap indices
-                ++swaps;
+BODY int bubble_sort_body(int *arr, int n, TraceSink *sink) {
+    for (int pass = 0; pass < n - 1 && !stop_requested(sink); pass++) {
+        for (int i = 0; i < n - pass - 1; i++) {
+            emit2(sink, "compare", i, i + 1);
+            if (arr[i] > arr[i + 1]) {
+                emit2(sink, "swap", i, i + 1);
+                swap_int(&arr[i], &arr[i + 1]);
+            } else {
+                emit2(sink, "no_swap", i, i + 1);
             }
         }
-        int args_mark[1] = { n - pass - 1 };
-        emit(cb, "mark_sorted", args_mark, 1, ctx); // mark last element as sorted in this pass
+        emit1(sink, "mark_sorted", n - pass - 1);
     }
-    int summary[2] = { comparisons, swaps };
-    emit(cb, "summary_sort", summary, 2, ctx);
+    return 0;
+}
+
+int bubble_sort(int *arr, int n, TraceSink *sink) {
+    return WITH_SINK(bubble_sort_body, arr, n);
 }
 
-/* Selection Sort */
-void selection_sort(int *arr, int n, ir_callback_t cb, void *ctx) {
-    int comparisons = 0, swaps = 0;
-    for (int i = 0; i < n - 1; ++i) {
+// Shifts are shown as swaps of neighbours, which is what they amount to
+BODY int insertion_sort_body(int *arr, int n, TraceSink *sink) {
+    for (int i = 1; i < n && !stop_requested(sink); i++) {
+        int key = arr[i];
+        int j = i - 1;
+        emit2(sink, "compare", i, j);
+        while (j >= 0 && arr[j] > key) {
+            emit2(sink, "compare", j, j + 1);
+            arr[j + 1] = arr[j];
+            emit2(sink, "swap", j, j + 1);
+            j--;
+        }
+        arr[j + 1] = key;
+        emit1(sink, "mark_sorted", i);
+    }
+    return 0;
+}
+
+int insertion_sort(int *arr, int n, TraceSink *sink) {
+    return WITH_SINK(insertion_sort_body, arr, n);
+}
+
+BODY int selection_sort_body(int *arr, int n, TraceSink *sink) {
+    for (int i = 0; i < n - 1 && !stop_requested(sink); i++) {
         int min_idx = i;
-        for (int j = i + 1; j < n; ++j) {
-            int args_cmp[2] = { min_idx, j };
-            emit(cb, "compare", args_cmp, 2, ctx);
-            ++comparisons;
+        for (int j = i + 1; j < n; j++) {
+            int candidate = min_idx;
+            emit2(sink, "compare", candidate, j);
             if (arr[j] < arr[min_idx]) min_idx = j;
+            emit2(sink, "no_swap", candidate, j);
         }
         if (min_idx != i) {
-            int args_swap[2] = { i, min_idx };
+            emit2(sink, "swap", i, min_idx);
             swap_int(&arr[i], &arr[min_idx]);
-            emit(cb, "swap", args_swap, 2, ctx);
-            ++swaps;
         }
-        int args_mark[1] = { i };
-        emit(cb, "mark_sorted", args_mark, 1, ctx);
+        emit1(sink, "mark_sorted", i);
     }
-    int summary[2] = { comparisons, swaps };
-    emit(cb, "summary_sort", summary, 2, ctx);
+    return 0;
 }
 
-/* Insertion Sort */
-void insertion_sort(int *arr, int n, ir_callback_t cb, void *ctx) {
-    int comparisons = 0, shifts = 0;
-    for (int i = 1; i < n; ++i) {
+int selection_sort(int *arr, int n, TraceSink *sink) {
+    return WITH_SINK(selection_sort_body, arr, n);
+}
+
+// Insertion sorts arr[low..high), giving up once more than `limit`
+// elements have been moved (limit < 0: never). Returns 1 if it finished.
+BODY int insertion_sort_range(int *arr, int low, int high, int limit, TraceSink *sink) {
+    int moved = 0;
+    for (int i = low + 1; i < high; i++) {
         int key = arr[i];
         int j = i - 1;
-        // Compare and shift
-        while (j >= 0) {
-            int args_cmp[2] = { j, i };
-            emit(cb, "compare", args_cmp, 2, ctx);
-            ++comparisons;
-            if (arr[j] > key) {
-                arr[j + 1] = arr[j];
-                int args_shift[2] = { j, j+1 }; // from j to j+1
-                emit(cb, "shift", args_shift, 2, ctx);
-                ++shifts;
-                --j;
-            } else break;
+        while (j >= low) {
+            emit2(sink, "compare", j, j + 1);
+            if (arr[j] <= key) break;
+            arr[j + 1] = arr[j];
+            emit2(sink, "swap", j, j + 1);
+            j--;
         }
         arr[j + 1] = key;
-        int args_insert[2] = { j+1, key };
-        emit(cb, "insert", args_insert, 2, ctx); // index and value
+        moved += i - (j + 1);
+        if (limit >= 0 && moved > limit) return i + 1 == high;
     }
-    int summary[2] = { comparisons, shifts };
-    emit(cb, "summary_sort", summary, 2, ctx);
+    return 1;
 }
 
-/* Quick Sort helpers with callbacks */
-static int partition_with_cb(int *arr, int low, int high, ir_callback_t cb, void *ctx) {
+// Bottom-up merge sort. Runs of up to MERGE_RUN elements are first
+// insertion sorted in place, each announced by run {first, last}. Passes
+// then merge neighbouring runs between the array and one scratch buffer,
+// each pass writing into the other, so nothing is copied back until the
+// end. A merge shows compare {i, j} for each element it takes, then
+// scatter {position, value} for every element it moved, after which the
+// array holds the merged run. Runs already in order show a compare and a
+// no_swap of their boundary.
+#define MERGE_RUN 32
+
+// Merges src[left..mid) and src[mid..right) into dst[left..right)
+BODY void merge_runs(const int *src, int *dst, int left, int mid, int right, TraceSink *sink) {
+    const int *a = src + left, *a_end = src + mid;
+    const int *b = src + mid, *b_end = src + right;
+    int *out = dst + left;
+    if (!sink && mid - left == right - mid) {
+        // Untraced, fill from both ends at once for two independent chains
+        // of loads. Each end takes half the elements, so with equal runs
+        // neither can read past the run it drains.
+        const int *a_last = a_end - 1, *b_last = b_end - 1;
+        int *out_last = dst + right - 1;
+        for (int count = mid - left; count > 0; count--) {
+            int x = *a, y = *b;
+            int take_right = y < x;
+            *out++ = take_right ? y : x;
+            b += take_right;
+            a += !take_right;
+            int xl = *a_last, yl = *b_last;
+            int take_left = yl < xl;
+            *out_last-- = take_left ? xl : yl;
+            a_last -= take_left;
+            b_last -= !take_left;
+        }
+        return;
+    }
+    while (a < a_end && b < b_end) {
+        emit2(sink, "compare", (int)(a - src), (int)(b - src));
+        int x = *a, y = *b;
+        int take_right = y < x;
+        *out++ = take_right ? y : x;
+        b += take_right;
+        a += !take_right;
+    }
+    // With the left run used up, the rest of the right one is in place
+    int moved_end = a < a_end ? right : (int)(b - src);
+    memcpy(out, a, (size_t)(a_end - a) * sizeof(int));
+    memcpy(dst + (b - src), b, (size_t)(b_end - b) * sizeof(int));
+    if (sink) {
+        for (int p = left; p < moved_end; p++) emit2(sink, "scatter", p, dst[p]);
+    }
+}
+
+// Merges runs of `width` in arr[lo..hi), doubling the width each pass,
+// until one run is left. Passes alternate between arr and buffer[lo..hi)
+// and the result ends up in arr. `merge` merges two runs untraced.
+BODY void merge_passes(int *arr, int *buffer, int lo, int hi, int width,
+                       void (*merge)(const int *, int *, int, int, int), TraceSink *sink) {
+    int *src = arr;
+    int *dst = buffer;
+    for (; width < hi - lo && !stop_requested(sink); width *= 2) {
+        for (int left = lo; left < hi; left += 2 * width) {
+            int mid = left + width;
+            if (mid >= hi) {
+                memcpy(dst + left, src + left, (size_t)(hi - left) * sizeof(int));
+                break;
+            }
+            int right = mid + width < hi ? mid + width : hi;
+            // Merging single elements takes that one compare anyway
+            int ordered = 0;
+            if (width > 1) {
+                emit2(sink, "compare", mid - 1, mid);
+                ordered = src[mid - 1] <= src[mid];
+            }
+            if (ordered) {
+                emit2(sink, "no_swap", mid - 1, mid);
+                memcpy(dst + left, src + left, (size_t)(right - left) * sizeof(int));
+            } else if (merge && !sink) {
+                merge(src, dst, left, mid, right);
+            } else {
+                merge_runs(src, dst, left, mid, right, sink);
+            }
+        }
+        int *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != arr) memcpy(arr + lo, src + lo, (size_t)(hi - lo) * sizeof(int));
+}
+
+// Sorts arr[lo..hi) using buffer[lo..hi) as scratch
+BODY void merge_sort_range(int *arr, int *buffer, int lo, int hi, TraceSink *sink) {
+    int n = hi - lo;
+    if (n < 2) return;
+    // Small arrays keep at least two merge passes to show
+    int run = MERGE_RUN;
+    while (run > 1 && run * 4 > n) run /= 2;
+    if (run > 1) {
+        for (int low = lo; low < hi; low += run) {
+            int high = low + run < hi ? low + run : hi;
+            emit2(sink, "run", low, high - 1);
+            insertion_sort_range(arr, low, high, -1, sink);
+        }
+    }
+    merge_passes(arr, buffer, lo, hi, run, NULL, sink);
+}
+
+BODY int merge_sort_body(int *arr, int n, TraceSink *sink) {
+    if (n < 2) return 0;
+    int *buffer = (int *)malloc((size_t)n * sizeof(int));
+    if (!buffer) return -1;
+    merge_sort_range(arr, buffer, 0, n, sink);
+    free(buffer);
+    return 0;
+}
+
+int merge_sort(int *arr, int n, TraceSink *sink) {
+    return WITH_SINK(merge_sort_body, arr, n);
+}
+
+// Restores the max-heap rooted at `root` within arr[base..end). Child
+// positions are relative to base.
+BODY void sift_down(int *arr, int base, int root, int end, TraceSink *sink) {
+    emit2(sink, "sift_down", root, end);
+    for (;;) {
+        int child = base + 2 * (root - base) + 1;
+        if (child >= end) return;
+        if (child + 1 < end) {
+            emit2(sink, "compare", child, child + 1);
+            if (arr[child + 1] > arr[child]) child++;
+        }
+        emit2(sink, "compare", root, child);
+        if (arr[root] >= arr[child]) {
+            emit2(sink, "no_swap", root, child);
+            return;
+        }
+        emit2(sink, "swap", root, child);
+        swap_int(&arr[root], &arr[child]);
+        root = child;
+    }
+}
+
+// Heap sorts arr[low..high); quick sort's fallback as well as heap_sort
+BODY void heap_sort_range(int *arr, int low, int high, TraceSink *sink) {
+    for (int root = low + (high - low) / 2 - 1; root >= low; root--) {
+        sift_down(arr, low, root, high, sink);
+    }
+    for (int end = high - 1; end > low; end--) {
+        if (stop_requested(sink)) return;
+        emit2(sink, "swap", low, end);
+        swap_int(&arr[low], &arr[end]);
+        emit1(sink, "mark_sorted", end);
+        sift_down(arr, low, low, end, sink);
+    }
+    if (high > low) emit1(sink, "mark_sorted", low);
+}
+
+BODY int heap_sort_body(int *arr, int n, TraceSink *sink) {
+    heap_sort_range(arr, 0, n, sink);
+    return 0;
+}
+
+int heap_sort(int *arr, int n, TraceSink *sink) {
+    return WITH_SINK(heap_sort_body, arr, n);
+}
+
+// Quick sort. Every strategy keeps a stack of ranges still to sort,
+// continues with the smaller side of each partition and stacks the larger.
+// A stacked range is at most half the size of the one below it, so the
+// stack never holds more than log2(n) + 1 entries.
+
+#define QUICK_STACK 64
+#define QUICK_INSERTION_THRESHOLD 24
+#define QUICK_NINTHER_THRESHOLD 128
+
+typedef struct {
+    int low;
+    int high;       // Inclusive; pdq's ranges are [low, high)
+    int budget;     // Partitions left before falling back to heap sort
+    int leftmost;   // pdq: no smaller element lies before low
+} QuickRange;
+
+static int floor_log2(int n) {
+    int log = 0;
+    while (n > 1) {
+        n >>= 1;
+        log++;
+    }
+    return log;
+}
+
+// Index of the median of arr[a], arr[b], arr[c]
+BODY int median_of_three(const int *arr, int a, int b, int c, TraceSink *sink) {
+    emit2(sink, "compare", a, b);
+    if (arr[a] < arr[b]) {
+        emit2(sink, "compare", b, c);
+        if (arr[b] < arr[c]) return b;
+        emit2(sink, "compare", a, c);
+        return arr[a] < arr[c] ? c : a;
+    }
+    emit2(sink, "compare", a, c);
+    if (arr[a] < arr[c]) return a;
+    emit2(sink, "compare", b, c);
+    return arr[b] < arr[c] ? c : b;
+}
+
+// Tukey's ninther: the median of three medians of three, spread over the
+// range so that sorted, reversed and organ-pipe inputs find a good pivot
+BODY int ninther(const int *arr, int low, int high, TraceSink *sink) {
+    int size = high - low + 1;
+    int mid = low + size / 2;
+    if (size < QUICK_NINTHER_THRESHOLD) return median_of_three(arr, low, mid, high, sink);
+    int e = size / 8;
+    int a = median_of_three(arr, low, low + e, low + 2 * e, sink);
+    int b = median_of_three(arr, mid - e, mid, mid + e, sink);
+    int c = median_of_three(arr, high - 2 * e, high - e, high, sink);
+    return median_of_three(arr, a, b, c, sink);
+}
+
+BODY void swap_steps(int *arr, int a, int b, TraceSink *sink) {
+    if (a == b) return;
+    emit2(sink, "swap", a, b);
+    swap_int(&arr[a], &arr[b]);
+}
+
+// Lomuto around arr[high]; returns the pivot's final position
+BODY int partition_lomuto(int *arr, int low, int high, TraceSink *sink) {
     int pivot = arr[high];
     int i = low - 1;
-    for (int j = low; j < high; ++j) {
-        int args_cmp[2] = { j, high }; // compare arr[j] with pivot at high
-        emit(cb, "compare_pivot", args_cmp, 2, ctx);
-        if (arr[j] <= pivot) {
-            ++i;
-            if (i != j) {
-                swap_int(&arr[i], &arr[j]);
-                int args_swap[2] = { i, j };
-                emit(cb, "swap", args_swap, 2, ctx);
+    emit1(sink, "compare", high);  // The pivot
+    for (int j = low; j < high; j++) {
+        emit2(sink, "compare", j, high);
+        if (arr[j] < pivot && ++i != j) {
+            emit2(sink, "swap", i, j);
+            swap_int(&arr[i], &arr[j]);
+        } else {
+            emit2(sink, "no_swap", j, high);
+        }
+    }
+    emit2(sink, "swap", i + 1, high);
+    swap_int(&arr[i + 1], &arr[high]);
+    return i + 1;
+}
+
+// Hoare's two inward scans around arr[low], which then moves to where the
+// scans met; returns that position. The scans stop on elements equal to
+// the pivot, so runs of equal values split evenly.
+BODY int partition_hoare(int *arr, int low, int high, TraceSink *sink) {
+    int pivot = arr[low];
+    int i = low;
+    int j = high + 1;
+    emit1(sink, "compare", low);  // The pivot
+    for (;;) {
+        do {
+            if (++i > high) break;
+            emit2(sink, "compare", i, low);
+        } while (arr[i] < pivot);
+        do {
+            j--;
+            emit2(sink, "compare", j, low);
+        } while (pivot < arr[j]);
+        if (i >= j) break;
+        emit2(sink, "swap", i, j);
+        swap_int(&arr[i], &arr[j]);
+    }
+    swap_steps(arr, low, j, sink);
+    return j;
+}
+
+// Dijkstra's Dutch flag around arr[low]: afterwards arr[*lt..*gt] all
+// equal the pivot and are in their final places
+BODY void partition_three_way(int *arr, int low, int high, int *lt, int *gt, TraceSink *sink) {
+    int pivot = arr[low];
+    int l = low;
+    int g = high;
+    int i = low + 1;
+    emit1(sink, "compare", low);  // The pivot
+    while (i <= g) {
+        emit2(sink, "compare", i, l);  // arr[l] always holds the pivot value
+        if (arr[i] < pivot) {
+            emit2(sink, "swap", l, i);
+            swap_int(&arr[l], &arr[i]);
+            l++;
+            i++;
+        } else if (arr[i] > pivot) {
+            emit2(sink, "swap", i, g);
+            swap_int(&arr[i], &arr[g]);
+            g--;
+        } else {
+            emit2(sink, "no_swap", i, l);
+            i++;
+        }
+    }
+    *lt = l;
+    *gt = g;
+}
+
+// Lomuto, median-of-three, ninther, Hoare, three-way and introsort
+BODY void quick_sort_classic(int *arr, int n, int strategy, TraceSink *sink) {
+    QuickRange stack[QUICK_STACK];
+    int top = 0;
+    int low = 0;
+    int high = n - 1;
+    int budget = 2 * floor_log2(n);
+    for (;;) {
+        if (stop_requested(sink)) return;
+        if (high - low < 1) {
+            if (top == 0) return;
+            top--;
+            low = stack[top].low;
+            high = stack[top].high;
+            budget = stack[top].budget;
+            continue;
+        }
+        if (strategy == QUICK_INTRO) {
+            if (high - low + 1 < QUICK_INSERTION_THRESHOLD) {
+                insertion_sort_range(arr, low, high + 1, -1, sink);
+                high = low;
+                continue;
+            }
+            if (budget-- == 0) {
+                heap_sort_range(arr, low, high + 1, sink);  // Partitions keep going badly
+                high = low;
+                continue;
+            }
+        }
+
+        // Partition into arr[low..left] and arr[right..high]
+        int mid = low + (high - low) / 2;
+        int left, right;
+        if (strategy == QUICK_THREE_WAY) {
+            swap_steps(arr, ninther(arr, low, high, sink), low, sink);
+            partition_three_way(arr, low, high, &left, &right, sink);
+            for (int k = left; k <= right; k++) emit1(sink, "mark_sorted", k);
+            left--;
+            right++;
+        } else {
+            int pivot;
+            if (strategy == QUICK_HOARE || strategy == QUICK_INTRO) {
+                swap_steps(arr, ninther(arr, low, high, sink), low, sink);
+                pivot = partition_hoare(arr, low, high, sink);
+            } else {
+                if (strategy == QUICK_MEDIAN3) {
+                    swap_steps(arr, median_of_three(arr, low, mid, high, sink), high, sink);
+                } else if (strategy == QUICK_NINTHER) {
+                    swap_steps(arr, ninther(arr, low, high, sink), high, sink);
+                }
+                pivot = partition_lomuto(arr, low, high, sink);
             }
+            emit1(sink, "mark_sorted", pivot);
+            left = pivot - 1;
+            right = pivot + 1;
+        }
+
+        QuickRange *larger = &stack[top++];
+        larger->budget = budget;
+        if (left - low < high - right) {
+            larger->low = right;
+            larger->high = high;
+            high = left;
+        } else {
+            larger->low = low;
+            larger->high = left;
+            low = right;
         }
     }
-    if (i+1 != high) {
-        swap_int(&arr[i+1], &arr[high]);
-        int args_swap[2] = { i+1, high };
-        emit(cb, "swap", args_swap, 2, ctx);
+}
+
+// pdqsort (Orson Peters' pattern-defeating quicksort) follows, on
+// half-open ranges [begin, end)
+
+BODY void sort2(int *arr, int a, int b, TraceSink *sink) {
+    emit2(sink, "compare", a, b);
+    if (arr[b] < arr[a]) {
+        emit2(sink, "swap", a, b);
+        swap_int(&arr[a], &arr[b]);
     }
-    int pivot_idx[1] = { i+1 };
-    emit(cb, "pivot_placed", pivot_idx, 1, ctx);
-    return i + 1;
 }
 
-static void quick_sort_rec(int *arr, int low, int high, ir_callback_t cb, void *ctx) {
-    if (low < high) {
-        int pi = partition_with_cb(arr, low, high, cb, ctx);
-        quick_sort_rec(arr, low, pi - 1, cb, ctx);
-        quick_sort_rec(arr, pi + 1, high, cb, ctx);
-    } else if (low == high) {
-        int args_mark[1] = { low };
-        emit(cb, "mark_sorted", args_mark, 1, ctx);
-    }
-}
-
-void quick_sort(int *arr, int n, ir_callback_t cb, void *ctx) {
-    quick_sort_rec(arr, 0, n - 1, cb, ctx);
-    emit(cb, "summary_sort_done", NULL, 0, ctx);
-}
-
-/* Merge Sort helpers with callbacks */
-static void merge_with_cb(int *arr, int l, int m, int r, ir_callback_t cb, void *ctx) {
-    int n1 = m - l + 1;
-    int n2 = r - m;
-    int *L = (int*)malloc(sizeof(int) * n1);
-    int *R = (int*)malloc(sizeof(int) * n2);
-    for (int i = 0; i < n1; ++i) L[i] = arr[l + i];
-    for (int j = 0; j < n2; ++j) R[j] = arr[m + 1 + j];
-    int i = 0, j = 0, k = l;
-    while (i < n1 && j < n2) {
-        int args_cmp[2] = { l + i, m + 1 + j };
-        emit(cb, "compare", args_cmp, 2, ctx);
-        if (L[i] <= R[j]) {
-            arr[k++] = L[i++];
+// Puts arr[a], arr[b], arr[c] in order
+BODY void sort3(int *arr, int a, int b, int c, TraceSink *sink) {
+    sort2(arr, a, b, sink);
+    sort2(arr, b, c, sink);
+    sort2(arr, a, b, sink);
+}
+
+#define PDQ_BLOCK 64
+
+// Partitions around arr[begin], equal elements going right. Returns the
+// pivot's final position, with *already_partitioned set when nothing had
+// to move. Misplaced elements are found a block at a time by recording
+// their offsets without branching on comparisons (BlockQuicksort), then
+// swapped in pairs.
+BODY int partition_right(int *arr, int begin, int end, int *already_partitioned, TraceSink *sink) {
+    int pivot = arr[begin];
+    int first = begin;
+    int last = end;
+    emit1(sink, "compare", begin);  // The pivot
+    // sort3 left an element no smaller than the pivot at the end, so this
+    // scan needs no bound
+    do {
+        first++;
+        emit2(sink, "compare", first, begin);
+    } while (arr[first] < pivot);
+    if (first - 1 == begin) {
+        while (first < last) {
+            last--;
+            emit2(sink, "compare", last, begin);
+            if (arr[last] < pivot) break;
+        }
+    } else {
+        do {
+            last--;
+            emit2(sink, "compare", last, begin);
+        } while (!(arr[last] < pivot));
+    }
+    *already_partitioned = first >= last;
+    if (!*already_partitioned) {
+        unsigned char offsets_l[PDQ_BLOCK];
+        unsigned char offsets_r[PDQ_BLOCK];
+        swap_steps(arr, first, last, sink);
+        first++;
+        int base_l = first;
+        int base_r = last;
+        int num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+        while (first < last) {
+            int unknown = last - first;
+            int left_split = num_l == 0 ? (num_r == 0 ? unknown / 2 : unknown) : 0;
+            int right_split = num_r == 0 ? unknown - left_split : 0;
+            if (left_split > PDQ_BLOCK) left_split = PDQ_BLOCK;
+            if (right_split > PDQ_BLOCK) right_split = PDQ_BLOCK;
+            for (int i = 0; i < left_split; i++) {
+                emit2(sink, "compare", first, begin);
+                offsets_l[num_l] = (unsigned char)i;
+                num_l += !(arr[first] < pivot);
+                first++;
+            }
+            for (int i = 0; i < right_split;) {
+                last--;
+                emit2(sink, "compare", last, begin);
+                offsets_r[num_r] = (unsigned char)++i;
+                num_r += arr[last] < pivot;
+            }
+            int num = num_l < num_r ? num_l : num_r;
+            for (int i = 0; i < num; i++) {
+                swap_steps(arr, base_l + offsets_l[start_l + i], base_r - offsets_r[start_r + i], sink);
+            }
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+            if (num_l == 0) {
+                start_l = 0;
+                base_l = first;
+            }
+            if (num_r == 0) {
+                start_r = 0;
+                base_r = last;
+            }
+        }
+        // Elements still recorded on one side belong at the boundary
+        if (num_l) {
+            while (num_l--) swap_steps(arr, base_l + offsets_l[start_l + num_l], --last, sink);
+            first = last;
+        }
+        if (num_r) {
+            while (num_r--) swap_steps(arr, base_r - offsets_r[start_r + num_r], first++, sink);
+        }
+    }
+    int pivot_pos = first - 1;
+    swap_steps(arr, begin, pivot_pos, sink);
+    return pivot_pos;
+}
+
+// Partitions around arr[begin], equal elements going left. Used when the
+// pivot equals the element before the range, which makes every element
+// equal to it already sorted. Returns the pivot's final position.
+BODY int partition_left(int *arr, int begin, int end, TraceSink *sink) {
+    int pivot = arr[begin];
+    int first = begin;
+    int last = end;
+    emit1(sink, "compare", begin);  // The pivot
+    do {
+        last--;
+        emit2(sink, "compare", last, begin);
+    } while (pivot < arr[last]);
+    if (last + 1 == end) {
+        while (first < last) {
+            first++;
+            emit2(sink, "compare", first, begin);
+            if (pivot < arr[first]) break;
+        }
+    } else {
+        do {
+            first++;
+            emit2(sink, "compare", first, begin);
+        } while (!(pivot < arr[first]));
+    }
+    while (first < last) {
+        swap_steps(arr, first, last, sink);
+        do {
+            last--;
+            emit2(sink, "compare", last, begin);
+        } while (pivot < arr[last]);
+        do {
+            first++;
+            emit2(sink, "compare", first, begin);
+        } while (!(pivot < arr[first]));
+    }
+    swap_steps(arr, begin, last, sink);
+    return last;
+}
+
+// Breaks up the pattern behind an unbalanced partition by swapping a few
+// elements of each side
+BODY void pdq_shuffle(int *arr, int begin, int pivot_pos, int end, TraceSink *sink) {
+    int l_size = pivot_pos - begin;
+    int r_size = end - (pivot_pos + 1);
+    if (l_size >= QUICK_INSERTION_THRESHOLD) {
+        swap_steps(arr, begin, begin + l_size / 4, sink);
+        swap_steps(arr, pivot_pos - 1, pivot_pos - l_size / 4, sink);
+        if (l_size > QUICK_NINTHER_THRESHOLD) {
+            swap_steps(arr, begin + 1, begin + (l_size / 4 + 1), sink);
+            swap_steps(arr, begin + 2, begin + (l_size / 4 + 2), sink);
+            swap_steps(arr, pivot_pos - 2, pivot_pos - (l_size / 4 + 1), sink);
+            swap_steps(arr, pivot_pos - 3, pivot_pos - (l_size / 4 + 2), sink);
+        }
+    }
+    if (r_size >= QUICK_INSERTION_THRESHOLD) {
+        swap_steps(arr, pivot_pos + 1, pivot_pos + (1 + r_size / 4), sink);
+        swap_steps(arr, end - 1, end - r_size / 4, sink);
+        if (r_size > QUICK_NINTHER_THRESHOLD) {
+            swap_steps(arr, pivot_pos + 2, pivot_pos + (2 + r_size / 4), sink);
+            swap_steps(arr, pivot_pos + 3, pivot_pos + (3 + r_size / 4), sink);
+            swap_steps(arr, end - 2, end - (1 + r_size / 4), sink);
+            swap_steps(arr, end - 3, end - (2 + r_size / 4), sink);
+        }
+    }
+}
+
+BODY void quick_sort_pdq(int *arr, int n, TraceSink *sink) {
+    QuickRange stack[QUICK_STACK];
+    int top = 0;
+    int begin = 0;
+    int end = n;
+    int bad_allowed = floor_log2(n);
+    int leftmost = 1;
+    for (;;) {
+        if (stop_requested(sink)) return;
+        int size = end - begin;
+        if (size < QUICK_INSERTION_THRESHOLD) {
+            insertion_sort_range(arr, begin, end, -1, sink);
         } else {
-            arr[k++] = R[j++];
+            int s2 = size / 2;
+            if (size > QUICK_NINTHER_THRESHOLD) {
+                sort3(arr, begin, begin + s2, end - 1, sink);
+                sort3(arr, begin + 1, begin + (s2 - 1), end - 2, sink);
+                sort3(arr, begin + 2, begin + (s2 + 1), end - 3, sink);
+                sort3(arr, begin + (s2 - 1), begin + s2, begin + (s2 + 1), sink);
+                swap_steps(arr, begin, begin + s2, sink);
+            } else {
+                sort3(arr, begin + s2, begin, end - 1, sink);
+            }
+
+            // A pivot equal to its predecessor starts a run of equal
+            // elements: gather them left of it and carry on to the right
+            if (!leftmost) {
+                emit2(sink, "compare", begin - 1, begin);
+                if (!(arr[begin - 1] < arr[begin])) {
+                    int pivot_pos = partition_left(arr, begin, end, sink);
+                    emit1(sink, "mark_sorted", pivot_pos);
+                    begin = pivot_pos + 1;
+                    continue;
+                }
+            }
+
+            int already_partitioned;
+            int pivot_pos = partition_right(arr, begin, end, &already_partitioned, sink);
+            emit1(sink, "mark_sorted", pivot_pos);
+            int l_size = pivot_pos - begin;
+            int r_size = end - (pivot_pos + 1);
+            int finished = 0;
+            if (l_size < size / 8 || r_size < size / 8) {
+                if (--bad_allowed == 0) {
+                    heap_sort_range(arr, begin, end, sink);
+                    finished = 1;
+                } else {
+                    pdq_shuffle(arr, begin, pivot_pos, end, sink);
+                }
+            } else if (already_partitioned) {
+                // Probably (nearly) sorted: try to finish both sides cheaply
+                finished = insertion_sort_range(arr, begin, pivot_pos, 8, sink) &&
+                           insertion_sort_range(arr, pivot_pos + 1, end, 8, sink);
+            }
+            if (!finished) {
+                QuickRange *larger = &stack[top++];
+                larger->budget = bad_allowed;
+                if (l_size < r_size) {
+                    larger->low = pivot_pos + 1;
+                    larger->high = end;
+                    larger->leftmost = 0;
+                    end = pivot_pos;
+                } else {
+                    larger->low = begin;
+                    larger->high = pivot_pos;
+                    larger->leftmost = leftmost;
+                    begin = pivot_pos + 1;
+                    leftmost = 0;
+                }
+                continue;
+            }
+        }
+        if (top == 0) return;
+        top--;
+        begin = stack[top].low;
+        end = stack[top].high;
+        bad_allowed = stack[top].budget;
+        leftmost = stack[top].leftmost;
+    }
+}
+
+BODY int quick_sort_body(int *arr, int n, int strategy, TraceSink *sink) {
+    if (strategy == QUICK_PDQ) {
+        quick_sort_pdq(arr, n, sink);
+    } else {
+        quick_sort_classic(arr, n, strategy, sink);
+    }
+    return 0;
+}
+
+int quick_sort_strategy(int *arr, int n, int strategy, TraceSink *sink) {
+    return WITH_SINK(quick_sort_body, arr, n, strategy);
+}
+
+int quick_sort(int *arr, int n, TraceSink *sink) {
+    return quick_sort_strategy(arr, n, QUICK_LOMUTO, sink);
+}
+
+// Every sequence grows by at least 2x, so 32-bit sizes need fewer
+#define MAX_GAPS 40
+
+// Fills `gaps` with the sequence's gaps below n, ascending; returns how many
+static int shell_gaps(int kind, int n, int *gaps) {
+    static const int ciura[] = {1, 4, 10, 23, 57, 132, 301, 701};
+    int count = 0;
+    if (kind == SHELL_GAPS_TOKUDA) {
+        // ceil((9 * 2.25^k - 4) / 5)
+        for (double scale = 1.0; count < MAX_GAPS; scale *= 2.25) {
+            double exact = (9.0 * scale - 4.0) / 5.0;
+            long long gap = (long long)exact;
+            if (gap < exact) gap++;
+            if (gap >= n) break;
+            gaps[count++] = (int)gap;
+        }
+    } else if (kind == SHELL_GAPS_SEDGEWICK) {
+        // 9 * 4^k - 9 * 2^k + 1 interleaved with 4^(k+2) - 3 * 2^(k+2) + 1
+        for (long long p2 = 1; count < MAX_GAPS; p2 *= 2) {
+            long long gap = 9 * p2 * p2 - 9 * p2 + 1;
+            if (gap >= n) break;
+            gaps[count++] = (int)gap;
+            gap = 16 * p2 * p2 - 12 * p2 + 1;
+            if (gap >= n) break;
+            gaps[count++] = (int)gap;
+        }
+    } else {
+        // Ciura's measured gaps, extended by a factor of 2.25
+        long long gap = 1;
+        for (int k = 0; gap < n && count < MAX_GAPS; k++) {
+            gaps[count++] = (int)gap;
+            gap = k + 1 < (int)(sizeof(ciura) / sizeof(ciura[0])) ? ciura[k + 1] : gap * 9 / 4;
+        }
+    }
+    return count;
+}
+
+BODY int shell_sort_body(int *arr, int n, const int *gaps, int gap_count, TraceSink *sink) {
+    for (int g = gap_count - 1; g >= 0 && !stop_requested(sink); g--) {
+        int gap = gaps[g];
+        emit1(sink, "gap", gap);
+        for (int i = gap; i < n; i++) {
+            int key = arr[i];
+            int j = i;
+            while (j >= gap) {
+                emit2(sink, "compare", j - gap, j);
+                if (arr[j - gap] <= key) {
+                    emit2(sink, "no_swap", j - gap, j);
+                    break;
+                }
+                arr[j] = arr[j - gap];
+                emit2(sink, "swap", j - gap, j);
+                j -= gap;
+            }
+            arr[j] = key;
+        }
+    }
+    return 0;
+}
+
+int shell_sort_gaps(int *arr, int n, int gaps, TraceSink *sink) {
+    int gap_list[MAX_GAPS];
+    int gap_count = shell_gaps(gaps, n, gap_list);
+    return WITH_SINK(shell_sort_body, arr, n, gap_list, gap_count);
+}
+
+int shell_sort(int *arr, int n, TraceSink *sink) {
+    return shell_sort_gaps(arr, n, SHELL_GAPS_CIURA, sink);
+}
+
+// Flipping the sign bit orders ints correctly as unsigned keys
+#define RADIX_KEY(value) ((unsigned)(value) ^ 0x80000000u)
+
+BODY int radix_sort_body(int *arr, int n, int bits, TraceSink *sink) {
+    if (n < 2) return 0;
+    int radix = 1 << bits;
+    unsigned mask = (unsigned)radix - 1;
+    int passes = (32 + bits - 1) / bits;
+    int *buffer = (int *)malloc((size_t)n * sizeof(int));
+    int *counts = (int *)calloc((size_t)passes * (size_t)radix, sizeof(int));
+    if (!buffer || !counts) {
+        free(buffer);
+        free(counts);
+        return -1;
+    }
+    // One read of the input counts the digits of every pass
+    for (int i = 0; i < n; i++) {
+        unsigned key = RADIX_KEY(arr[i]);
+        for (int p = 0; p < passes; p++) {
+            counts[p * radix + (int)((key >> (p * bits)) & mask)]++;
+        }
+    }
+
+    int *src = arr;
+    int *dst = buffer;
+    for (int p = 0; p < passes && !stop_requested(sink); p++) {
+        int shift = p * bits;
+        int *count = counts + p * radix;
+        if (count[(RADIX_KEY(src[0]) >> shift) & mask] == n) continue;  // Would not move anything
+        if (sink) {
+            for (int i = 0; i < n; i++) {
+                emit2(sink, "histogram", i, (int)((RADIX_KEY(src[i]) >> shift) & mask));
+            }
+        }
+        // Counts become each digit's first position in the output
+        int total = 0;
+        for (int d = 0; d < radix; d++) {
+            int c = count[d];
+            count[d] = total;
+            total += c;
+        }
+        for (int i = 0; i < n; i++) {
+            int value = src[i];
+            int position = count[(RADIX_KEY(value) >> shift) & mask]++;
+            dst[position] = value;
+            emit2(sink, "scatter", position, value);
+        }
+        int *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != arr) memcpy(arr, src, (size_t)n * sizeof(int));
+    free(buffer);
+    free(counts);
+    return 0;
+}
+
+int radix_sort_digits(int *arr, int n, int digit_bits, TraceSink *sink) {
+    if (digit_bits < 1 || digit_bits > 16) digit_bits = 8;
+    return WITH_SINK(radix_sort_body, arr, n, digit_bits);
+}
+
+int radix_sort(int *arr, int n, TraceSink *sink) {
+    return radix_sort_digits(arr, n, 8, sink);
+}
+
+// TimSort, after Tim Peters' listsort and Java's TimSort: natural runs,
+// extended to a minimum length by binary insertion sort, are kept on a
+// stack and merged while the stack's lengths break the invariants below.
+// Merges gallop (exponential then binary search) once one run keeps
+// winning, so presorted data costs close to n compares.
+//
+// Steps: compares of neighbours find each run, with swaps reversing a
+// descending one; binary insertion shows its probes as compare {probe, i}
+// and its shifts as swaps. run {first, last} pushes a run. A merge starts
+// with merge {first, second run's first, last}; gallop {probe, key} shows
+// each search probe, compare {i, j} each one-at-a-time choice, and the
+// merged elements are then written back by scatter {position, value}.
+// Merge steps name elements by their position before the merge began.
+#define TIM_MIN_MERGE 32
+#define TIM_MIN_GALLOP 7
+#define TIM_MAX_RUNS 85  // Run lengths grow like Fibonacci numbers
+
+typedef struct {
+    int *arr;
+    int *tmp;          // Half the array: the shorter run of a merge
+    int min_gallop;
+    int run_base[TIM_MAX_RUNS];
+    int run_len[TIM_MAX_RUNS];
+    int runs;
+} TimState;
+
+// Length of the run starting at lo, reversed in place if descending
+BODY int tim_count_run(int *arr, int lo, int hi, TraceSink *sink) {
+    int run_hi = lo + 1;
+    if (run_hi == hi) return 1;
+    emit2(sink, "compare", lo, run_hi);
+    if (arr[run_hi++] < arr[lo]) {
+        // Strictly descending, so reversing keeps the sort stable
+        while (run_hi < hi) {
+            emit2(sink, "compare", run_hi - 1, run_hi);
+            if (!(arr[run_hi] < arr[run_hi - 1])) break;
+            run_hi++;
+        }
+        for (int i = lo, j = run_hi - 1; i < j; i++, j--) {
+            emit2(sink, "swap", i, j);
+            swap_int(&arr[i], &arr[j]);
+        }
+    } else {
+        while (run_hi < hi) {
+            emit2(sink, "compare", run_hi - 1, run_hi);
+            if (arr[run_hi] < arr[run_hi - 1]) break;
+            run_hi++;
         }
     }
-    while (i < n1) arr[k++] = L[i++];
-    while (j < n2) arr[k++] = R[j++];
-    free(L); free(R);
-    int args_merged[2] = { l, r };
-    emit(cb, "merged_segment", args_merged, 2, ctx);
+    return run_hi - lo;
 }
 
-static void merge_sort_rec(int *arr, int l, int r, ir_callback_t cb, void *ctx) {
-    if (l < r) {
-        int m = (l + r) / 2;
-        merge_sort_rec(arr, l, m, cb, ctx);
-        merge_sort_rec(arr, m + 1, r, cb, ctx);
-        merge_with_cb(arr, l, m, r, cb, ctx);
-    } else if (l == r) {
-        int args_mark[1] = { l };
-        emit(cb, "mark_sorted", args_mark, 1, ctx);
+// Sorts arr[lo..hi), of which arr[lo..start) is already sorted, by
+// binary insertion: few compares, though shifts stay quadratic
+BODY void tim_binary_sort(int *arr, int lo, int hi, int start, TraceSink *sink) {
+    for (; start < hi; start++) {
+        int pivot = arr[start];
+        int left = lo;
+        int right = start;
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            emit2(sink, "compare", mid, start);
+            if (pivot < arr[mid]) right = mid;
+            else left = mid + 1;
+        }
+        if (sink) {
+            for (int j = start - 1; j >= left; j--) emit2(sink, "swap", j, j + 1);
+        }
+        memmove(arr + left + 1, arr + left, (size_t)(start - left) * sizeof(int));
+        arr[left] = pivot;
     }
 }
 
-void merge_sort(int *arr, int n, ir_callback_t cb, void *ctx) {
-    merge_sort_rec(arr, 0, n - 1, cb, ctx);
-    emit(cb, "summary_sort_done", NULL, 0, ctx);
+// n itself below TIM_MIN_MERGE; otherwise between TIM_MIN_MERGE / 2 and
+// TIM_MIN_MERGE, chosen so that n / minrun is a power of two or just below
+static int tim_min_run(int n) {
+    int r = 0;
+    while (n >= TIM_MIN_MERGE) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+// Where key goes in run[0..len): the number of elements less than it
+// (gallop_left) or not greater than it (gallop_right). The search starts
+// at run[hint] and gallops outwards before searching in binary. run_pos
+// and key_pos are the positions shown for run[0] and the key.
+BODY int gallop_left(int key, int key_pos, const int *run, int run_pos, int len, int hint,
+                     TraceSink *sink) {
+    int last_ofs = 0;
+    int ofs = 1;
+    emit2(sink, "gallop", run_pos + hint, key_pos);
+    if (key > run[hint]) {
+        int max_ofs = len - hint;
+        while (ofs < max_ofs) {
+            emit2(sink, "gallop", run_pos + hint + ofs, key_pos);
+            if (!(key > run[hint + ofs])) break;
+            last_ofs = ofs;
+            ofs = ofs < max_ofs / 2 ? ofs * 2 + 1 : max_ofs;
+        }
+        if (ofs > max_ofs) ofs = max_ofs;
+        last_ofs += hint;
+        ofs += hint;
+    } else {
+        int max_ofs = hint + 1;
+        while (ofs < max_ofs) {
+            emit2(sink, "gallop", run_pos + hint - ofs, key_pos);
+            if (!(key <= run[hint - ofs])) break;
+            last_ofs = ofs;
+            ofs = ofs < max_ofs / 2 ? ofs * 2 + 1 : max_ofs;
+        }
+        if (ofs > max_ofs) ofs = max_ofs;
+        int t = last_ofs;
+        last_ofs = hint - ofs;
+        ofs = hint - t;
+    }
+    // run[last_ofs] < key <= run[ofs]
+    last_ofs++;
+    while (last_ofs < ofs) {
+        int m = last_ofs + (ofs - last_ofs) / 2;
+        emit2(sink, "gallop", run_pos + m, key_pos);
+        if (key > run[m]) last_ofs = m + 1;
+        else ofs = m;
+    }
+    return ofs;
+}
+
+BODY int gallop_right(int key, int key_pos, const int *run, int run_pos, int len, int hint,
+                      TraceSink *sink) {
+    int last_ofs = 0;
+    int ofs = 1;
+    emit2(sink, "gallop", run_pos + hint, key_pos);
+    if (key < run[hint]) {
+        int max_ofs = hint + 1;
+        while (ofs < max_ofs) {
+            emit2(sink, "gallop", run_pos + hint - ofs, key_pos);
+            if (!(key < run[hint - ofs])) break;
+            last_ofs = ofs;
+            ofs = ofs < max_ofs / 2 ? ofs * 2 + 1 : max_ofs;
+        }
+        if (ofs > max_ofs) ofs = max_ofs;
+        int t = last_ofs;
+        last_ofs = hint - ofs;
+        ofs = hint - t;
+    } else {
+        int max_ofs = len - hint;
+        while (ofs < max_ofs) {
+            emit2(sink, "gallop", run_pos + hint + ofs, key_pos);
+            if (key < run[hint + ofs]) break;
+            last_ofs = ofs;
+            ofs = ofs < max_ofs / 2 ? ofs * 2 + 1 : max_ofs;
+        }
+        if (ofs > max_ofs) ofs = max_ofs;
+        last_ofs += hint;
+        ofs += hint;
+    }
+    // run[last_ofs] <= key < run[ofs]
+    last_ofs++;
+    while (last_ofs < ofs) {
+        int m = last_ofs + (ofs - last_ofs) / 2;
+        emit2(sink, "gallop", run_pos + m, key_pos);
+        if (key < run[m]) ofs = m;
+        else last_ofs = m + 1;
+    }
+    return ofs;
+}
+
+// Merges arr[base1..base1+len1) with the run after it, len1 <= len2, with
+// the first run moved to tmp. arr[base2] is known to go first and
+// arr[base1 + len1 - 1] last.
+BODY void tim_merge_lo(TimState *ts, int base1, int len1, int base2, int len2, TraceSink *sink) {
+    int *arr = ts->arr;
+    int *tmp = ts->tmp;
+    memcpy(tmp, arr + base1, (size_t)len1 * sizeof(int));
+    int cursor1 = 0;       // In tmp, shown as base1 + cursor1
+    int cursor2 = base2;
+    int dest = base1;
+    arr[dest++] = arr[cursor2++];
+    if (--len2 == 0) {
+        memcpy(arr + dest, tmp + cursor1, (size_t)len1 * sizeof(int));
+        return;
+    }
+    if (len1 == 1) {
+        memmove(arr + dest, arr + cursor2, (size_t)len2 * sizeof(int));
+        arr[dest + len2] = tmp[cursor1];
+        return;
+    }
+    int min_gallop = ts->min_gallop;
+    for (;;) {
+        int count1 = 0;  // Times in a row each run won
+        int count2 = 0;
+        do {
+            emit2(sink, "compare", base1 + cursor1, cursor2);
+            if (arr[cursor2] < tmp[cursor1]) {
+                arr[dest++] = arr[cursor2++];
+                count2++;
+                count1 = 0;
+                if (--len2 == 0) goto done;
+            } else {
+                arr[dest++] = tmp[cursor1++];
+                count1++;
+                count2 = 0;
+                if (--len1 == 1) goto done;
+            }
+        } while ((count1 | count2) < min_gallop);
+
+        // One run keeps winning: gallop until neither wins by much
+        do {
+            count1 = gallop_right(arr[cursor2], cursor2, tmp + cursor1, base1 + cursor1, len1, 0, sink);
+            if (count1 != 0) {
+                memcpy(arr + dest, tmp + cursor1, (size_t)count1 * sizeof(int));
+                dest += count1;
+                cursor1 += count1;
+                len1 -= count1;
+                if (len1 <= 1) goto done;
+            }
+            arr[dest++] = arr[cursor2++];
+            if (--len2 == 0) goto done;
+
+            count2 = gallop_left(tmp[cursor1], base1 + cursor1, arr + cursor2, cursor2, len2, 0, sink);
+            if (count2 != 0) {
+                memmove(arr + dest, arr + cursor2, (size_t)count2 * sizeof(int));
+                dest += count2;
+                cursor2 += count2;
+                len2 -= count2;
+                if (len2 == 0) goto done;
+            }
+            arr[dest++] = tmp[cursor1++];
+            if (--len1 == 1) goto done;
+            min_gallop--;
+        } while (count1 >= TIM_MIN_GALLOP || count2 >= TIM_MIN_GALLOP);
+        if (min_gallop < 0) min_gallop = 0;
+        min_gallop += 2;  // Penalty for leaving galloping mode
+    }
+done:
+    ts->min_gallop = min_gallop < 1 ? 1 : min_gallop;
+    if (len1 == 1) {
+        memmove(arr + dest, arr + cursor2, (size_t)len2 * sizeof(int));
+        arr[dest + len2] = tmp[cursor1];
+    } else {
+        memcpy(arr + dest, tmp + cursor1, (size_t)len1 * sizeof(int));
+    }
+}
+
+// As tim_merge_lo from the right, for len1 > len2, with the second run
+// moved to tmp
+BODY void tim_merge_hi(TimState *ts, int base1, int len1, int base2, int len2, TraceSink *sink) {
+    int *arr = ts->arr;
+    int *tmp = ts->tmp;
+    memcpy(tmp, arr + base2, (size_t)len2 * sizeof(int));
+    int cursor1 = base1 + len1 - 1;
+    int cursor2 = len2 - 1;  // In tmp, shown as base2 + cursor2
+    int dest = base2 + len2 - 1;
+    arr[dest--] = arr[cursor1--];
+    if (--len1 == 0) {
+        memcpy(arr + dest - (len2 - 1), tmp, (size_t)len2 * sizeof(int));
+        return;
+    }
+    if (len2 == 1) {
+        dest -= len1;
+        cursor1 -= len1;
+        memmove(arr + dest + 1, arr + cursor1 + 1, (size_t)len1 * sizeof(int));
+        arr[dest] = tmp[cursor2];
+        return;
+    }
+    int min_gallop = ts->min_gallop;
+    for (;;) {
+        int count1 = 0;
+        int count2 = 0;
+        do {
+            emit2(sink, "compare", cursor1, base2 + cursor2);
+            if (tmp[cursor2] < arr[cursor1]) {
+                arr[dest--] = arr[cursor1--];
+                count1++;
+                count2 = 0;
+                if (--len1 == 0) goto done;
+            } else {
+                arr[dest--] = tmp[cursor2--];
+                count2++;
+                count1 = 0;
+                if (--len2 == 1) goto done;
+            }
+        } while ((count1 | count2) < min_gallop);
+
+        do {
+            count1 = len1 - gallop_right(tmp[cursor2], base2 + cursor2, arr + base1, base1, len1, len1 - 1, sink);
+            if (count1 != 0) {
+                dest -= count1;
+                cursor1 -= count1;
+                len1 -= count1;
+                memmove(arr + dest + 1, arr + cursor1 + 1, (size_t)count1 * sizeof(int));
+                if (len1 == 0) goto done;
+            }
+            arr[dest--] = tmp[cursor2--];
+            if (--len2 == 1) goto done;
+
+            count2 = len2 - gallop_left(arr[cursor1], cursor1, tmp, base2, len2, len2 - 1, sink);
+            if (count2 != 0) {
+                dest -= count2;
+                cursor2 -= count2;
+                len2 -= count2;
+                memcpy(arr + dest + 1, tmp + cursor2 + 1, (size_t)count2 * sizeof(int));
+                if (len2 <= 1) goto done;
+            }
+            arr[dest--] = arr[cursor1--];
+            if (--len1 == 0) goto done;
+            min_gallop--;
+        } while (count1 >= TIM_MIN_GALLOP || count2 >= TIM_MIN_GALLOP);
+        if (min_gallop < 0) min_gallop = 0;
+        min_gallop += 2;
+    }
+done:
+    ts->min_gallop = min_gallop < 1 ? 1 : min_gallop;
+    if (len2 == 1) {
+        dest -= len1;
+        cursor1 -= len1;
+        memmove(arr + dest + 1, arr + cursor1 + 1, (size_t)len1 * sizeof(int));
+        arr[dest] = tmp[cursor2];
+    } else {
+        memcpy(arr + dest - (len2 - 1), tmp, (size_t)len2 * sizeof(int));
+    }
+}
+
+// Merges stack runs i and i + 1
+BODY void tim_merge_at(TimState *ts, int i, TraceSink *sink) {
+    int *arr = ts->arr;
+    int base1 = ts->run_base[i];
+    int len1 = ts->run_len[i];
+    int base2 = ts->run_base[i + 1];
+    int len2 = ts->run_len[i + 1];
+    ts->run_len[i] = len1 + len2;
+    if (i == ts->runs - 3) {
+        ts->run_base[i + 1] = ts->run_base[i + 2];
+        ts->run_len[i + 1] = ts->run_len[i + 2];
+    }
+    ts->runs--;
+    int args[3] = { base1, base2, base2 + len2 - 1 };
+    emit(sink, "merge", args, 3);
+
+    // Elements of the first run not above the second's first are in
+    // place, as are elements of the second not below the first's last
+    int k = gallop_right(arr[base2], base2, arr + base1, base1, len1, 0, sink);
+    int first = base1 + k;
+    len1 -= k;
+    if (len1 == 0) return;
+    len2 = gallop_left(arr[base2 - 1], base2 - 1, arr + base2, base2, len2, len2 - 1, sink);
+    if (len2 == 0) return;
+    if (len1 <= len2) {
+        tim_merge_lo(ts, first, len1, base2, len2, sink);
+    } else {
+        tim_merge_hi(ts, first, len1, base2, len2, sink);
+    }
+    if (sink) {
+        for (int p = first; p < base2 + len2; p++) emit2(sink, "scatter", p, arr[p]);
+    }
+}
+
+// Merges until, from the top of the stack, each run is longer than the
+// next two together and each longer than the next
+BODY void tim_merge_collapse(TimState *ts, TraceSink *sink) {
+    while (ts->runs > 1) {
+        int n = ts->runs - 2;
+        int *len = ts->run_len;
+        if ((n > 0 && len[n - 1] <= len[n] + len[n + 1]) || (n > 1 && len[n - 2] <= len[n] + len[n - 1])) {
+            if (len[n - 1] < len[n + 1]) n--;
+        } else if (len[n] > len[n + 1]) {
+            break;
+        }
+        tim_merge_at(ts, n, sink);
+    }
+}
+
+BODY int tim_sort_body(int *arr, int n, TraceSink *sink) {
+    if (n < 2) return 0;
+    TimState ts;
+    ts.arr = arr;
+    ts.tmp = NULL;
+    ts.min_gallop = TIM_MIN_GALLOP;
+    ts.runs = 0;
+    if (n >= TIM_MIN_MERGE) {
+        ts.tmp = (int *)malloc((size_t)(n / 2 + 1) * sizeof(int));
+        if (!ts.tmp) return -1;
+    }
+    int min_run = tim_min_run(n);
+    for (int lo = 0; lo < n && !stop_requested(sink);) {
+        int len = tim_count_run(arr, lo, n, sink);
+        if (len < min_run) {
+            int force = n - lo < min_run ? n - lo : min_run;
+            tim_binary_sort(arr, lo, lo + force, lo + len, sink);
+            len = force;
+        }
+        emit2(sink, "run", lo, lo + len - 1);
+        ts.run_base[ts.runs] = lo;
+        ts.run_len[ts.runs] = len;
+        ts.runs++;
+        tim_merge_collapse(&ts, sink);
+        lo += len;
+    }
+    while (ts.runs > 1 && !stop_requested(sink)) {
+        int i = ts.runs - 2;
+        if (i > 0 && ts.run_len[i - 1] < ts.run_len[i + 1]) i--;
+        tim_merge_at(&ts, i, sink);
+    }
+    free(ts.tmp);
+    return 0;
+}
+
+int tim_sort(int *arr, int n, TraceSink *sink) {
+    return WITH_SINK(tim_sort_body, arr, n);
+}
+
+// Bitonic sort: a merge sort over blocks of 16 (or 8) elements, each first
+// sorted by a bitonic sorting network. Untraced, with AVX2 (checked at
+// run time) a network stage is a shuffle, a min, a max and a blend, and
+// merges take 8 elements at a time through a bitonic merge network. With
+// only SSE2 the network is vectorised but merges are merge sort's, which
+// beat 4-wide merges built on SSE2's compares. Traced, or on other CPUs,
+// the network runs in plain C and merges are merge sort's.
+//
+// Steps: stage {first, last, k, j} runs one stage of the network over the
+// block arr[first..last], after which the array holds its result: each
+// position i with (i - first) & j == 0 is compare-exchanged with i + j,
+// the smaller value going first when (i - first) & k == 0 and the larger
+// otherwise. A leftover of less than a block is insertion sorted, and the
+// merges are shown as in merge sort.
+#define BITONIC_BLOCK 16
+#define BITONIC_STAGES 10  // Stages in a network of BITONIC_BLOCK inputs
+
+typedef enum { BITONIC_PLAIN, BITONIC_SSE2, BITONIC_AVX2 } BitonicIsa;
+
+static BitonicIsa bitonic_isa(void) {
+#if defined(SIMD_X86)
+    if (__builtin_cpu_supports("avx2")) return BITONIC_AVX2;
+    if (__builtin_cpu_supports("sse2")) return BITONIC_SSE2;
+#endif
+    return BITONIC_PLAIN;
+}
+
+// Runs stage (k, j) of the network on the block at arr[first..first + block)
+BODY void bitonic_stage(int *arr, int first, int block, int k, int j, TraceSink *sink) {
+    int args[4] = {first, first + block - 1, k, j};
+    emit(sink, "stage", args, 4);
+    for (int i = 0; i < block; i++) {
+        if (i & j) continue;
+        int x = arr[first + i], y = arr[first + i + j];
+        int low = x < y ? x : y, high = x < y ? y : x;
+        int descending = (i & k) != 0;
+        arr[first + i] = descending ? high : low;
+        arr[first + i + j] = descending ? low : high;
+    }
+}
+
+BODY void bitonic_network(int *arr, int first, int block, TraceSink *sink) {
+    for (int k = 2; k <= block; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2) bitonic_stage(arr, first, block, k, j, sink);
+    }
+}
+
+#if defined(SIMD_X86)
+
+// Fills in each stage's distance j, and -1 in mask[stage][i] where
+// element i of a block takes the smaller of its pair. Returns the count.
+static int bitonic_masks(int block, int dist[BITONIC_STAGES], int mask[BITONIC_STAGES][BITONIC_BLOCK]) {
+    int stages = 0;
+    for (int k = 2; k <= block; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2, stages++) {
+            dist[stages] = j;
+            for (int i = 0; i < block; i++) mask[stages][i] = ((i & j) == 0) == ((i & k) == 0) ? -1 : 0;
+        }
+    }
+    return stages;
+}
+
+// Merges two sorted runs given by pointers into out
+static void merge_sorted(const int *a, const int *a_end, const int *b, const int *b_end, int *out) {
+    while (a < a_end && b < b_end) {
+        int x = *a, y = *b;
+        int take_b = y < x;
+        *out++ = take_b ? y : x;
+        b += take_b;
+        a += !take_b;
+    }
+    memcpy(out, a, (size_t)(a_end - a) * sizeof(int));
+    out += a_end - a;
+    memcpy(out, b, (size_t)(b_end - b) * sizeof(int));
+}
+
+// Finishes a vector merge: the `count` sorted elements it held back still
+// have to be merged with the rest of both runs, one of which has fewer
+// than a vector left.
+static void merge_leftovers(const int *held, int count, const int *a, const int *a_end,
+                            const int *b, const int *b_end, int *out) {
+    int small[2 * 8];
+    if (a_end - a > b_end - b) {
+        const int *p = a, *p_end = a_end;
+        a = b;
+        a_end = b_end;
+        b = p;
+        b_end = p_end;
+    }
+    merge_sorted(held, held + count, a, a_end, small);
+    merge_sorted(small, small + count + (a_end - a), b, b_end, out);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+#define SSE2 __attribute__((target("sse2")))
+
+// One stage on 8 or 16 elements held in x[0..regs)
+AVX2 static inline void stage_avx2(__m256i *x, int regs, int j, const int *mask) {
+    __m256i y[2];
+    for (int r = 0; r < regs; r++) {
+        if (j == 8) y[r] = x[r ^ 1];
+        else if (j == 4) y[r] = _mm256_permute2x128_si256(x[r], x[r], 1);
+        else if (j == 2) y[r] = _mm256_shuffle_epi32(x[r], _MM_SHUFFLE(1, 0, 3, 2));
+        else y[r] = _mm256_shuffle_epi32(x[r], _MM_SHUFFLE(2, 3, 0, 1));
+    }
+    for (int r = 0; r < regs; r++) {
+        __m256i take_min = _mm256_loadu_si256((const __m256i *)(mask + 8 * r));
+        x[r] = _mm256_blendv_epi8(_mm256_max_epi32(x[r], y[r]), _mm256_min_epi32(x[r], y[r]), take_min);
+    }
+}
+
+AVX2 static void bitonic_blocks_avx2(int *arr, int blocks, int block) {
+    int dist[BITONIC_STAGES], mask[BITONIC_STAGES][BITONIC_BLOCK];
+    int stages = bitonic_masks(block, dist, mask);
+    int regs = block / 8;
+    for (int *p = arr; p < arr + blocks * block; p += block) {
+        __m256i x[2];
+        for (int r = 0; r < regs; r++) x[r] = _mm256_loadu_si256((const __m256i *)(p + 8 * r));
+        for (int s = 0; s < stages; s++) stage_avx2(x, regs, dist[s], mask[s]);
+        for (int r = 0; r < regs; r++) _mm256_storeu_si256((__m256i *)(p + 8 * r), x[r]);
+    }
+}
+
+// Merges sorted *lo and *hi: *lo gets the 8 smallest, *hi the 8 largest
+AVX2 static inline void merge8_avx2(__m256i *lo, __m256i *hi) {
+    __m256i b = _mm256_permutevar8x32_epi32(*hi, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    __m256i x[2] = {_mm256_min_epi32(*lo, b), _mm256_max_epi32(*lo, b)};
+    for (int r = 0; r < 2; r++) {
+        __m256i y = _mm256_permute2x128_si256(x[r], x[r], 1);
+        x[r] = _mm256_blend_epi32(_mm256_min_epi32(x[r], y), _mm256_max_epi32(x[r], y), 0xF0);
+        y = _mm256_shuffle_epi32(x[r], _MM_SHUFFLE(1, 0, 3, 2));
+        x[r] = _mm256_blend_epi32(_mm256_min_epi32(x[r], y), _mm256_max_epi32(x[r], y), 0xCC);
+        y = _mm256_shuffle_epi32(x[r], _MM_SHUFFLE(2, 3, 0, 1));
+        x[r] = _mm256_blend_epi32(_mm256_min_epi32(x[r], y), _mm256_max_epi32(x[r], y), 0xAA);
+    }
+    *lo = x[0];
+    *hi = x[1];
+}
+
+// Merges src[left..mid) and src[mid..right) into dst[left..right), 8
+// elements at a time. The vector that goes in next comes from the run
+// whose next element is smaller, so everything already written is no
+// larger than what is left in either run or held in hi.
+AVX2 static void merge_runs_avx2(const int *src, int *dst, int left, int mid, int right) {
+    const int *a = src + left, *a_end = src + mid;
+    const int *b = src + mid, *b_end = src + right;
+    int *out = dst + left;
+    if (a_end - a < 8 || b_end - b < 8) {
+        merge_sorted(a, a_end, b, b_end, out);
+        return;
+    }
+    __m256i lo = _mm256_loadu_si256((const __m256i *)a);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)b);
+    a += 8;
+    b += 8;
+    for (;;) {
+        merge8_avx2(&lo, &hi);
+        _mm256_storeu_si256((__m256i *)out, lo);
+        out += 8;
+        if (a_end - a < 8 || b_end - b < 8) break;
+        int take_a = *a < *b;
+        lo = _mm256_loadu_si256((const __m256i *)(take_a ? a : b));
+        a += take_a ? 8 : 0;
+        b += take_a ? 0 : 8;
+    }
+    int held[8];
+    _mm256_storeu_si256((__m256i *)held, hi);
+    merge_leftovers(held, 8, a, a_end, b, b_end, out);
+}
+
+SSE2 static inline __m128i blend_sse2(__m128i x, __m128i y, __m128i take_y) {
+    return _mm_or_si128(_mm_and_si128(take_y, y), _mm_andnot_si128(take_y, x));
+}
+
+// One stage on 8 or 16 elements held in x[0..regs)
+SSE2 static inline void stage_sse2(__m128i *x, int regs, int j, const int *mask) {
+    __m128i y[4];
+    for (int r = 0; r < regs; r++) {
+        if (j >= 4) y[r] = x[r ^ (j / 4)];
+        else if (j == 2) y[r] = _mm_shuffle_epi32(x[r], _MM_SHUFFLE(1, 0, 3, 2));
+        else y[r] = _mm_shuffle_epi32(x[r], _MM_SHUFFLE(2, 3, 0, 1));
+    }
+    for (int r = 0; r < regs; r++) {
+        __m128i take_min = _mm_loadu_si128((const __m128i *)(mask + 4 * r));
+        __m128i greater = _mm_cmpgt_epi32(x[r], y[r]);
+        // SSE2 has no 32-bit min or max: take y where x is greater and
+        // the min is wanted, or where it is not and the max is
+        x[r] = blend_sse2(x[r], y[r], _mm_cmpeq_epi32(greater, take_min));
+    }
+}
+
+SSE2 static void bitonic_blocks_sse2(int *arr, int blocks, int block) {
+    int dist[BITONIC_STAGES], mask[BITONIC_STAGES][BITONIC_BLOCK];
+    int stages = bitonic_masks(block, dist, mask);
+    int regs = block / 4;
+    for (int *p = arr; p < arr + blocks * block; p += block) {
+        __m128i x[4];
+        for (int r = 0; r < regs; r++) x[r] = _mm_loadu_si128((const __m128i *)(p + 4 * r));
+        for (int s = 0; s < stages; s++) stage_sse2(x, regs, dist[s], mask[s]);
+        for (int r = 0; r < regs; r++) _mm_storeu_si128((__m128i *)(p + 4 * r), x[r]);
+    }
+}
+
+#undef AVX2
+#undef SSE2
+
+#endif
+
+BODY int bitonic_sort_body(int *arr, int n, int block, TraceSink *sink) {
+    if (n < 2) return 0;
+    if (block != 8) block = BITONIC_BLOCK;
+    while (block > 2 && block > n) block /= 2;
+    int full = n - n % block;
+    void (*merge)(const int *, int *, int, int, int) = NULL;
+    BitonicIsa isa = sink || block < 8 ? BITONIC_PLAIN : bitonic_isa();
+#if defined(SIMD_X86)
+    if (isa == BITONIC_AVX2) {
+        bitonic_blocks_avx2(arr, full / block, block);
+        merge = merge_runs_avx2;
+    } else if (isa == BITONIC_SSE2) {
+        bitonic_blocks_sse2(arr, full / block, block);
+    }
+#endif
+    if (isa == BITONIC_PLAIN) {
+        for (int first = 0; first < full; first += block) bitonic_network(arr, first, block, sink);
+    }
+    if (full < n) insertion_sort_range(arr, full, n, -1, sink);
+    if (n <= block) return 0;
+    int *buffer = (int *)malloc((size_t)n * sizeof(int));
+    if (!buffer) return -1;
+    merge_passes(arr, buffer, 0, n, block, merge, sink);
+    free(buffer);
+    return 0;
+}
+
+int bitonic_sort_block(int *arr, int n, int block, TraceSink *sink) {
+    return WITH_SINK(bitonic_sort_body, arr, n, block);
+}
+
+int bitonic_sort(int *arr, int n, TraceSink *sink) {
+    return bitonic_sort_block(arr, n, BITONIC_BLOCK, sink);
 }
 
 /* ---------------------------
-   Stack (LIFO) implementation
+   Parallel sorts
+   Work is split into lanes that run as tasks on a work-stealing pool, in
+   fork-join phases. Untraced, lanes work straight on the array. Traced,
+   each lane records its steps, and when a phase is over they are replayed
+   into the caller's sink one step per lane in turn, so the trace is the
+   same however the lanes were scheduled.
    --------------------------- */
 
+#define PARALLEL_LANES 4
+#define PARALLEL_MAX_LANES 256
+// A pool is only worth waking for this many elements per thread
+#define PARALLEL_GRAIN 8192
+// Sample elements taken per lane to choose splitters from
+#define SAMPLE_OVERSAMPLING 16
+
+// Threads a parallel sort called from this thread may start (0 = one per
+// CPU); never changes the lanes, so traces do not depend on it
+static _Thread_local int parallel_thread_cap = 0;
+
+void parallel_sort_threads(int threads) {
+    parallel_thread_cap = threads > 0 ? threads : 0;
+}
+
 typedef struct {
-    int *data;
+    const char *action;
+    int args[TRACE_MAX_ARGS];
+    int nargs;
+} RecordedStep;
+
+typedef struct ParallelSort ParallelSort;
+
+// Keeps a lane's steps until its phase is replayed
+typedef struct {
+    TraceSink base;
+    ParallelSort *ps;
+    RecordedStep *steps;
+    int count;
     int capacity;
-    int top; // index of top element (-1 if empty)
-    ir_callback_t cb;
-    void *ctx;
-} Stack;
-
-Stack *stack_create(int capacity, ir_callback_t cb, void *ctx) {
-    Stack *s = (Stack*)malloc(sizeof(Stack));
-    s->data = (int*)malloc(sizeof(int) * capacity);
-    s->capacity = capacity;
-    s->top = -1;
-    s->cb = cb;
-    s->ctx = ctx;
-    emit(cb, "stack_init", NULL, 0, ctx);
-    return s;
+    int reported;   // Steps already counted in ps->recorded
+    int failed;     // Out of memory; steps were lost
+} RecordSink;
+
+typedef struct {
+    ParallelSort *ps;
+    int id;                // Lane shown in the trace
+    int first, last;       // Block or bucket: [first, last)
+    const int *src;        // Merge pieces: src[a..a_end) and src[b..b_end)
+    int *dst;              // go to dst from `out`
+    int a, a_end, b, b_end, out;
+    int merged;            // Odd-even: the pair was out of order
+    RecordSink record;
+    TraceSink *sink;       // &record.base, or NULL untraced
+    int replayed;
+} Lane;
+
+struct ParallelSort {
+    int *arr;
+    int *buffer;           // n elements of scratch
+    int n;
+    int lanes;
+    int *bound;            // Block i is [bound[i], bound[i + 1])
+    Lane *lane;
+    ThreadPool *pool;      // NULL: lanes run one after another here
+    TraceSink *sink;       // The caller's, or NULL
+    atomic_llong recorded;
+    atomic_int truncated;
+    // Sample sort
+    int *splitters;
+    unsigned char *bucket_of;
+    int *counts;           // counts[lane * lanes + bucket], then offsets
+};
+
+static void record_sink_step(TraceSink *sink, const char *action, const int *args, int nargs) {
+    RecordSink *r = (RecordSink *)sink;
+    if (r->count == r->capacity) {
+        int grown = r->capacity ? r->capacity * 2 : 256;
+        RecordedStep *bigger = (RecordedStep *)realloc(r->steps, (size_t)grown * sizeof(RecordedStep));
+        if (!bigger) {
+            r->failed = 1;
+            return;
+        }
+        r->steps = bigger;
+        r->capacity = grown;
+    }
+    RecordedStep *step = &r->steps[r->count++];
+    step->action = action;
+    step->nargs = nargs > TRACE_MAX_ARGS ? TRACE_MAX_ARGS : nargs;
+    memcpy(step->args, args, (size_t)step->nargs * sizeof(int));
+}
+
+// The caller's sink may not be thread-safe, so lanes are only stopped by
+// running out of memory or past the phase's share of steps
+static int record_sink_stopped(TraceSink *sink) {
+    RecordSink *r = (RecordSink *)sink;
+    long long total = atomic_fetch_add(&r->ps->recorded, r->count - r->reported) + r->count - r->reported;
+    r->reported = r->count;
+    if (total > PARALLEL_PHASE_STEPS) atomic_store(&r->ps->truncated, 1);
+    return r->failed || total > PARALLEL_PHASE_STEPS;
 }
 
-void stack_push(Stack *s, int value) {
-    if (s->top + 1 >= s->capacity) {
-        // simple resize
-        int newcap = s->capacity * 2;
-        s->data = (int*)realloc(s->data, sizeof(int) * newcap);
-        s->capacity = newcap;
+static void parallel_end(ParallelSort *ps) {
+    threadPoolDestroy(ps->pool);
+    if (ps->lane) {
+        for (int i = 0; i < ps->lanes; i++) free(ps->lane[i].record.steps);
     }
-    s->data[++s->top] = value;
-    int args[2] = { s->top, value };
-    emit(s->cb, "push", args, 2, s->ctx);
+    free(ps->lane);
+    free(ps->bound);
+    free(ps->buffer);
+    free(ps->splitters);
+    free(ps->bucket_of);
+    free(ps->counts);
+}
+
+// Splits arr[0..n) into blocks, one per lane. n must be at least 2.
+static int parallel_begin(ParallelSort *ps, int *arr, int n, int lanes, TraceSink *sink) {
+    int cpus = threadPoolDefaultSize();
+    if (lanes <= 0) lanes = cpus;
+    if (lanes > PARALLEL_MAX_LANES) lanes = PARALLEL_MAX_LANES;
+    if (lanes > n / 2) lanes = n / 2;
+    memset(ps, 0, sizeof(*ps));
+    ps->arr = arr;
+    ps->n = n;
+    ps->lanes = lanes;
+    ps->sink = sink;
+    atomic_init(&ps->recorded, 0);
+    atomic_init(&ps->truncated, 0);
+    ps->buffer = (int *)malloc((size_t)n * sizeof(int));
+    ps->bound = (int *)malloc((size_t)(lanes + 1) * sizeof(int));
+    ps->lane = (Lane *)calloc((size_t)lanes, sizeof(Lane));
+    if (!ps->buffer || !ps->bound || !ps->lane) {
+        parallel_end(ps);
+        return -1;
+    }
+    for (int i = 0; i <= lanes; i++) {
+        ps->bound[i] = (int)((long long)n * i / lanes);
+    }
+    for (int i = 0; i < lanes; i++) {
+        Lane *lane = &ps->lane[i];
+        lane->ps = ps;
+        lane->id = i;
+        lane->first = ps->bound[i];
+        lane->last = ps->bound[i + 1];
+        lane->record.base.step = record_sink_step;
+        lane->record.base.stopped = record_sink_stopped;
+        lane->record.base.lane = NULL;
+        lane->record.ps = ps;
+        lane->sink = sink ? &lane->record.base : NULL;
+    }
+    int threads = lanes < cpus ? lanes : cpus;
+    if (parallel_thread_cap > 0 && threads > parallel_thread_cap) threads = parallel_thread_cap;
+    if (threads > n / PARALLEL_GRAIN) threads = n / PARALLEL_GRAIN;
+    // Without a pool the lanes simply run in turn
+    if (threads > 1) ps->pool = threadPoolCreate(threads);
+    return 0;
+}
+
+static int is_scatter(const RecordedStep *step) {
+    return strcmp(step->action, "scatter") == 0;
+}
+
+// Replays the first `count` lanes' steps, one from each lane in turn.
+// With `defer`, scatters wait until every other step is out, so the
+// compares of a merge split across lanes still show the values it read.
+// Returns 0, 1 if the sink stopped the sort, -1 if steps were lost to
+// running out of memory, or PARALLEL_TRUNCATED past PARALLEL_PHASE_STEPS.
+static int replay_phase(ParallelSort *ps, int count, int defer) {
+    TraceSink *sink = ps->sink;
+    for (int i = 0; i < count; i++) {
+        if (ps->lane[i].record.failed) return -1;
+    }
+    int current = -1;
+    int polled = 0;
+    for (int pass = 0; pass < (defer ? 2 : 1); pass++) {
+        for (int i = 0; i < count; i++) ps->lane[i].replayed = 0;
+        int active = 1;
+        while (active) {
+            active = 0;
+            for (int i = 0; i < count; i++) {
+                Lane *lane = &ps->lane[i];
+                RecordSink *r = &lane->record;
+                while (defer && lane->replayed < r->count && is_scatter(&r->steps[lane->replayed]) != pass) {
+                    lane->replayed++;
+                }
+                if (lane->replayed == r->count) continue;
+                active = 1;
+                if (lane->id != current) {
+                    current = lane->id;
+                    set_lane(sink, current);
+                }
+                const RecordedStep *step = &r->steps[lane->replayed++];
+                emit(sink, step->action, step->args, step->nargs);
+                if (++polled == 4096) {
+                    polled = 0;
+                    if (stop_requested(sink)) {
+                        set_lane(sink, -1);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    if (current >= 0) set_lane(sink, -1);
+    if (stop_requested(sink)) return 1;
+    return atomic_load(&ps->truncated) ? PARALLEL_TRUNCATED : 0;
+}
+
+// Runs `task` on the first `count` lanes and waits for all of them.
+// Returns as replay_phase does.
+static int run_phase(ParallelSort *ps, int count, ThreadPoolTask task, int defer) {
+    for (int i = 0; i < count; i++) {
+        Lane *lane = &ps->lane[i];
+        lane->record.count = 0;
+        lane->record.reported = 0;
+        if (ps->pool) {
+            threadPoolSubmit(ps->pool, task, lane);
+        } else {
+            task(lane);
+        }
+    }
+    if (ps->pool) threadPoolWait(ps->pool);
+    if (!ps->sink) return 0;
+    int status = replay_phase(ps, count, defer);
+    atomic_store(&ps->recorded, 0);
+    return status;
+}
+
+static void merge_block_task(void *arg) {
+    Lane *lane = (Lane *)arg;
+    TraceSink *sink = lane->sink;
+    WITH_SINK(merge_sort_range, lane->ps->arr, lane->ps->buffer, lane->first, lane->last);
+}
+
+// Merges src[a..a_end) and src[b..b_end) into dst from `out`: split
+// {first, last} of the output, compare {i, j} for each element taken while
+// both have some left, then scatter {position, value} for all of it
+BODY void merge_piece(const int *src, int *dst, int a, int a_end, int b, int b_end, int out, TraceSink *sink) {
+    int len = (a_end - a) + (b_end - b);
+    if (len == 0) return;
+    emit2(sink, "split", out, out + len - 1);
+    const int *x = src + a, *x_end = src + a_end;
+    const int *y = src + b, *y_end = src + b_end;
+    int *o = dst + out;
+    while (x < x_end && y < y_end) {
+        emit2(sink, "compare", (int)(x - src), (int)(y - src));
+        int xv = *x, yv = *y;
+        int take_right = yv < xv;
+        *o++ = take_right ? yv : xv;
+        y += take_right;
+        x += !take_right;
+    }
+    memcpy(o, x, (size_t)(x_end - x) * sizeof(int));
+    o += x_end - x;
+    memcpy(o, y, (size_t)(y_end - y) * sizeof(int));
+    if (sink) {
+        for (int p = out; p < out + len; p++) emit2(sink, "scatter", p, dst[p]);
+    }
+}
+
+static void merge_piece_task(void *arg) {
+    Lane *lane = (Lane *)arg;
+    TraceSink *sink = lane->sink;
+    WITH_SINK(merge_piece, lane->src, lane->dst, lane->a, lane->a_end, lane->b, lane->b_end, lane->out);
+}
+
+// How many of the first k merged elements of sorted a[0..la) and
+// b[0..lb) come from a, taking a's element first on ties
+static int co_rank(int k, const int *a, int la, const int *b, int lb) {
+    int low = k > lb ? k - lb : 0;
+    int high = k < la ? k : la;
+    while (low < high) {
+        int i = low + (high - low) / 2;
+        if (a[i] <= b[k - i - 1]) low = i + 1;
+        else high = i;
+    }
+    return low;
+}
+
+BODY int parallel_merge_sort_body(int *arr, int n, int lanes, TraceSink *sink) {
+    if (n < 2) return 0;
+    ParallelSort ps;
+    if (parallel_begin(&ps, arr, n, lanes, sink) != 0) return -1;
+    int status = run_phase(&ps, ps.lanes, merge_block_task, 0);
+
+    // Each level merges neighbouring runs, every merge cut into equal
+    // pieces of output so that all lanes have work
+    int *bound = ps.bound;
+    int runs = ps.lanes;
+    const int *src = arr;
+    int *dst = ps.buffer;
+    while (status == 0 && runs > 1) {
+        int pairs = runs / 2;
+        int pieces = ps.lanes / pairs;
+        int count = 0;
+        for (int p = 0; p < pairs; p++) {
+            int left = bound[2 * p], mid = bound[2 * p + 1], right = bound[2 * p + 2];
+            int from_a = 0, done = 0;
+            for (int k = 1; k <= pieces; k++) {
+                int end = (int)((long long)(right - left) * k / pieces);
+                int take_a = co_rank(end, src + left, mid - left, src + mid, right - mid);
+                Lane *lane = &ps.lane[count];
+                lane->id = count++;
+                lane->src = src;
+                lane->dst = dst;
+                lane->a = left + from_a;
+                lane->a_end = left + take_a;
+                lane->b = mid + (done - from_a);
+                lane->b_end = mid + (end - take_a);
+                lane->out = left + done;
+                from_a = take_a;
+                done = end;
+            }
+        }
+        if (runs % 2) {
+            int last = bound[runs - 1];
+            memcpy(dst + last, src + last, (size_t)(n - last) * sizeof(int));
+        }
+        status = run_phase(&ps, count, merge_piece_task, 1);
+        runs = (runs + 1) / 2;
+        for (int r = 0; r < runs; r++) bound[r] = bound[2 * r];
+        bound[runs] = n;
+        const int *swap = src;
+        src = dst;
+        dst = (int *)swap;
+    }
+    if (status == 0 && src != arr) memcpy(arr, src, (size_t)n * sizeof(int));
+    parallel_end(&ps);
+    return status < 0 ? status : 0;
+}
+
+int parallel_merge_sort_lanes(int *arr, int n, int lanes, TraceSink *sink) {
+    return WITH_SINK(parallel_merge_sort_body, arr, n, lanes);
+}
+
+int parallel_merge_sort(int *arr, int n, TraceSink *sink) {
+    return parallel_merge_sort_lanes(arr, n, PARALLEL_LANES, sink);
+}
+
+// Bucket of `value`: how many splitters are at most it
+static int find_bucket(const int *splitters, int count, int value) {
+    int low = 0, high = count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (splitters[mid] <= value) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+BODY void classify_block(Lane *lane, TraceSink *sink) {
+    ParallelSort *ps = lane->ps;
+    int *counts = ps->counts + (size_t)lane->id * ps->lanes;
+    for (int i = lane->first; i < lane->last; i++) {
+        int bucket = find_bucket(ps->splitters, ps->lanes - 1, ps->arr[i]);
+        emit2(sink, "histogram", i, bucket);
+        ps->bucket_of[i] = (unsigned char)bucket;
+        counts[bucket]++;
+    }
+}
+
+static void classify_task(void *arg) {
+    Lane *lane = (Lane *)arg;
+    TraceSink *sink = lane->sink;
+    WITH_SINK(classify_block, lane);
+}
+
+// Moves the lane's block into the buffer at its buckets' offsets
+BODY void distribute_block(Lane *lane, TraceSink *sink) {
+    ParallelSort *ps = lane->ps;
+    int *offsets = ps->counts + (size_t)lane->id * ps->lanes;
+    for (int i = lane->first; i < lane->last; i++) {
+        int position = offsets[ps->bucket_of[i]]++;
+        ps->buffer[position] = ps->arr[i];
+        emit2(sink, "scatter", position, ps->arr[i]);
+    }
+}
+
+static void distribute_task(void *arg) {
+    Lane *lane = (Lane *)arg;
+    TraceSink *sink = lane->sink;
+    WITH_SINK(distribute_block, lane);
+}
+
+BODY int sample_sort_body(int *arr, int n, int lanes, TraceSink *sink) {
+    if (n < 2) return 0;
+    ParallelSort ps;
+    if (parallel_begin(&ps, arr, n, lanes, sink) != 0) return -1;
+    int buckets = ps.lanes;
+    int status = 0;
+    if (buckets > 1) {
+        // Splitters at even ranks of an evenly spaced sample
+        int samples = buckets * SAMPLE_OVERSAMPLING < n ? buckets * SAMPLE_OVERSAMPLING : n;
+        ps.splitters = (int *)malloc((size_t)samples * sizeof(int));
+        ps.bucket_of = (unsigned char *)malloc((size_t)n);
+        ps.counts = (int *)calloc((size_t)buckets * buckets, sizeof(int));
+        if (!ps.splitters || !ps.bucket_of || !ps.counts) {
+            parallel_end(&ps);
+            return -1;
+        }
+        for (int s = 0; s < samples; s++) {
+            ps.splitters[s] = arr[(long long)n * s / samples + (long long)n / samples / 2];
+        }
+        heap_sort_range(ps.splitters, 0, samples, NULL);
+        for (int b = 1; b < buckets; b++) {
+            ps.splitters[b - 1] = ps.splitters[(long long)samples * b / buckets];
+        }
+
+        status = run_phase(&ps, buckets, classify_task, 0);
+        // Each lane's share of a bucket follows the lower lanes' shares
+        int position = 0;
+        for (int b = 0; b < buckets; b++) {
+            ps.bound[b] = position;
+            for (int l = 0; l < buckets; l++) {
+                int count = ps.counts[(size_t)l * buckets + b];
+                ps.counts[(size_t)l * buckets + b] = position;
+                position += count;
+            }
+        }
+        ps.bound[buckets] = n;
+        if (status == 0) status = run_phase(&ps, buckets, distribute_task, 0);
+        if (status == 0) memcpy(arr, ps.buffer, (size_t)n * sizeof(int));
+        for (int b = 0; b < buckets; b++) {
+            ps.lane[b].first = ps.bound[b];
+            ps.lane[b].last = ps.bound[b + 1];
+        }
+    }
+    if (status == 0) status = run_phase(&ps, buckets, merge_block_task, 0);
+    parallel_end(&ps);
+    return status < 0 ? status : 0;
+}
+
+int sample_sort_lanes(int *arr, int n, int lanes, TraceSink *sink) {
+    return WITH_SINK(sample_sort_body, arr, n, lanes);
+}
+
+int sample_sort(int *arr, int n, TraceSink *sink) {
+    return sample_sort_lanes(arr, n, PARALLEL_LANES, sink);
+}
+
+// Merges blocks [first, mid) and [mid, last) and puts the lower part
+// back in the first and the rest in the second
+BODY int merge_split(int *arr, int *buffer, int first, int mid, int last, TraceSink *sink) {
+    emit2(sink, "compare", mid - 1, mid);
+    if (arr[mid - 1] <= arr[mid]) {
+        emit2(sink, "no_swap", mid - 1, mid);
+        return 0;
+    }
+    merge_piece(arr, buffer, first, mid, mid, last, first, sink);
+    memcpy(arr + first, buffer + first, (size_t)(last - first) * sizeof(int));
+    return 1;
+}
+
+static void merge_split_task(void *arg) {
+    Lane *lane = (Lane *)arg;
+    TraceSink *sink = lane->sink;
+    lane->merged = WITH_SINK(merge_split, lane->ps->arr, lane->ps->buffer, lane->a, lane->b, lane->b_end);
+}
+
+BODY int odd_even_sort_body(int *arr, int n, int lanes, TraceSink *sink) {
+    if (n < 2) return 0;
+    ParallelSort ps;
+    if (parallel_begin(&ps, arr, n, lanes, sink) != 0) return -1;
+    int status = run_phase(&ps, ps.lanes, merge_block_task, 0);
+    // After an even and an odd round with nothing merged, every
+    // neighbouring pair of blocks is in order. Equal blocks are sorted
+    // after lanes rounds; blocks an element apart in size can take two more.
+    int quiet = 0;
+    for (int round = 0; quiet < 2 && status == 0; round++) {
+        int count = 0;
+        for (int b = round % 2; b + 1 < ps.lanes; b += 2) {
+            Lane *lane = &ps.lane[count++];
+            lane->id = b;
+            lane->a = ps.bound[b];
+            lane->b = ps.bound[b + 1];
+            lane->b_end = ps.bound[b + 2];
+        }
+        status = run_phase(&ps, count, merge_split_task, 0);
+        int merged = 0;
+        for (int i = 0; i < count; i++) merged |= ps.lane[i].merged;
+        quiet = merged ? 0 : quiet + 1;
+    }
+    parallel_end(&ps);
+    return status < 0 ? status : 0;
+}
+
+int odd_even_sort_lanes(int *arr, int n, int lanes, TraceSink *sink) {
+    return WITH_SINK(odd_even_sort_body, arr, n, lanes);
 }
 
-int stack_pop(Stack *s, int *out_value) {
-    if (s->top < 0) {
-        emit(s->cb, "pop_empty", NULL, 0, s->ctx);
-        return 0; // empty
+int odd_even_sort(int *arr, int n, TraceSink *sink) {
+    return odd_even_sort_lanes(arr, n, PARALLEL_LANES, sink);
+}
+
+/* ---------------------------
+   Growable int arrays shared by the data structures
+   --------------------------- */
+
+// Makes room for index `needed` in each of `count` parallel arrays
+static int grow_arrays(int **arrays[], int count, int *capacity, int needed) {
+    if (needed < *capacity) return 0;
+    int grown = *capacity ? *capacity : 16;
+    while (grown <= needed) grown *= 2;
+    for (int i = 0; i < count; i++) {
+        int *bigger = (int *)realloc(*arrays[i], (size_t)grown * sizeof(int));
+        if (!bigger) return -1;
+        *arrays[i] = bigger;
     }
-    int v = s->data[s->top--];
-    if (out_value) *out_value = v;
-    int args[1] = { v };
-    emit(s->cb, "pop", args, 1, s->ctx);
+    *capacity = grown;
+    return 0;
+}
+
+/* ---------------------------
+   Stack (LIFO)
+   --------------------------- */
+
+void stack_init(Stack *s) {
+    s->data = NULL;
+    s->top = -1;
+    s->capacity = 0;
+}
+
+int stack_push(Stack *s, int value, TraceSink *sink) {
+    int **arrays[1] = { &s->data };
+    if (grow_arrays(arrays, 1, &s->capacity, s->top + 1) != 0) return -1;
+    s->data[++s->top] = value;
+    emit2(sink, "push", s->top, value);
+    return 0;
+}
+
+int stack_pop(Stack *s, int *value, TraceSink *sink) {
+    if (s->top < 0) return 0;
+    int v = s->data[s->top];
+    emit2(sink, "pop", s->top, v);
+    s->top--;
+    if (value) *value = v;
     return 1;
 }
 
-int stack_peek(Stack *s, int *out_value) {
+int stack_peek(const Stack *s, int *value, TraceSink *sink) {
     if (s->top < 0) return 0;
-    if (out_value) *out_value = s->data[s->top];
-    int args[2] = { s->top, s->data[s->top] };
-    emit(s->cb, "peek", args, 2, s->ctx);
+    emit1(sink, "peek", s->top);
+    if (value) *value = s->data[s->top];
     return 1;
 }
 
 void stack_free(Stack *s) {
-    if (!s) return;
     free(s->data);
-    emit(s->cb, "stack_free", NULL, 0, s->ctx);
-    free(s);
+    stack_init(s);
 }
 
 /* ---------------------------
-   Queue (FIFO) implementation - circular buffer
+   Queue (FIFO)
    --------------------------- */
 
-typedef struct {
-    int *data;
-    int capacity;
-    int front; // index of front element
-    int size;  // number of elements
-    ir_callback_t cb;
-    void *ctx;
-} Queue;
-
-Queue *queue_create(int capacity, ir_callback_t cb, void *ctx) {
-    Queue *q = (Queue*)malloc(sizeof(Queue));
-    q->data = (int*)malloc(sizeof(int) * capacity);
-    q->capacity = capacity;
+void queue_init(Queue *q) {
+    q->data = NULL;
     q->front = 0;
-    q->size = 0;
-    q->cb = cb;
-    q->ctx = ctx;
-    emit(cb, "queue_init", NULL, 0, ctx);
-    return q;
-}
-
-void queue_enqueue(Queue *q, int value) {
-    if (q->size >= q->capacity) {
-        // resize: simple reallocation with re-indexing
-        int newcap = q->capacity * 2;
-        int *newdata = (int*)malloc(sizeof(int) * newcap);
-        for (int i = 0; i < q->size; ++i)
-            newdata[i] = q->data[(q->front + i) % q->capacity];
-        free(q->data);
-        q->data = newdata;
-        q->capacity = newcap;
-        q->front = 0;
-    }
-    int idx = (q->front + q->size) % q->capacity;
-    q->data[idx] = value;
-    ++q->size;
-    int args[2] = { idx, value };
-    emit(q->cb, "enqueue", args, 2, q->ctx);
-}
-
-int queue_dequeue(Queue *q, int *out_value) {
-    if (q->size == 0) {
-        emit(q->cb, "dequeue_empty", NULL, 0, q->ctx);
-        return 0;
-    }
-    int v = q->data[q->front];
-    q->front = (q->front + 1) % q->capacity;
-    --q->size;
-    if (out_value) *out_value = v;
-    int args[1] = { v };
-    emit(q->cb, "dequeue", args, 1, q->ctx);
-    return 1;
+    q->rear = -1;
+    q->capacity = 0;
 }
 
-int queue_peek(Queue *q, int *out_value) {
-    if (q->size == 0) return 0;
-    if (out_value) *out_value = q->data[q->front];
-    int args[2] = { q->front, q->data[q->front] };
-    emit(q->cb, "queue_peek", args, 2, q->ctx);
+int queue_enqueue(Queue *q, int value, TraceSink *sink) {
+    int **arrays[1] = { &q->data };
+    if (grow_arrays(arrays, 1, &q->capacity, q->rear + 1) != 0) return -1;
+    q->data[++q->rear] = value;
+    emit2(sink, "enqueue", q->rear, value);
+    return 0;
+}
+
+int queue_dequeue(Queue *q, int *value, TraceSink *sink) {
+    if (q->front > q->rear) return 0;
+    int v = q->data[q->front];
+    emit2(sink, "dequeue", q->front, v);
+    q->front++;
+    if (value) *value = v;
     return 1;
 }
 
 void queue_free(Queue *q) {
-    if (!q) return;
     free(q->data);
-    emit(q->cb, "queue_free", NULL, 0, q->ctx);
-    free(q);
+    queue_init(q);
 }
 
 /* ---------------------------
    Binary Search Tree (BST)
+   Iterative throughout: a tree built from sorted input is a list, and
+   recursion would go as deep as it is long.
    --------------------------- */
 
-typedef struct BSTNode {
-    int value;
-    struct BSTNode *left, *right;
-} BSTNode;
-
-BSTNode* bst_new_node(int value) {
-    BSTNode *n = (BSTNode*)malloc(sizeof(BSTNode));
-    n->value = value;
-    n->left = n->right = NULL;
-    return n;
+void bst_init(BST *t) {
+    t->values = NULL;
+    t->left = NULL;
+    t->right = NULL;
+    t->size = 0;
+    t->capacity = 0;
 }
 
-
-BSTNode* bst_insert_with_cb(BSTNode *root, int value, ir_callback_t cb, void *ctx) {
-    if (root == NULL) {
-        BSTNode *node = bst_new_node(value);
-        int args[1] = { value };
-        emit(cb, "bst_inserted", args, 1, ctx);
-        return node;
+int bst_insert(BST *t, int value, TraceSink *sink) {
+    int **arrays[3] = { &t->values, &t->left, &t->right };
+    if (grow_arrays(arrays, 3, &t->capacity, t->size) != 0) return -1;
+    int node = t->size++;
+    t->values[node] = value;
+    t->left[node] = -1;
+    t->right[node] = -1;
+    if (node == 0) {
+        int args[4] = { value, -1, -1, 0 };
+        emit(sink, "insert", args, 4);
+        return 0;
     }
-    int args_cmp[2] = { root->value, value };
-    emit(cb, "bst_compare", args_cmp, 2, ctx);
-    if (value < root->value) {
-        root->left = bst_insert_with_cb(root->left, value, cb, ctx);
-    } else {
-        root->right = bst_insert_with_cb(root->right, value, cb, ctx);
+    int parent = 0;
+    for (;;) {
+        int *child = value < t->values[parent] ? &t->left[parent] : &t->right[parent];
+        if (*child < 0) {
+            int args[4] = { value, t->values[parent], child == &t->left[parent], 0 };
+            emit(sink, "insert", args, 4);
+            *child = node;
+            return 0;
+        }
+        parent = *child;
     }
-    return root;
 }
 
-void bst_inorder_with_cb(BSTNode *root, ir_callback_t cb, void *ctx) {
-    if (!root) return;
-    bst_inorder_with_cb(root->left, cb, ctx);
-    int args[1] = { root->value };
-    emit(cb, "bst_visit", args, 1, ctx);
-    bst_inorder_with_cb(root->right, cb, ctx);
+int bst_traverse(const BST *t, BSTOrder order, TraceSink *sink) {
+    if (t->size == 0) return 0;
+    // Postorder pushes each node twice: once to expand, once to visit
+    int *pending = (int *)malloc((size_t)t->size * 2 * sizeof(int));
+    if (!pending) return -1;
+    int top = 0;
+    if (order == BST_INORDER) {
+        int node = 0;
+        while (node >= 0 || top > 0) {
+            while (node >= 0) {
+                pending[top++] = node;
+                node = t->left[node];
+            }
+            node = pending[--top];
+            emit1(sink, "visit", t->values[node]);
+            node = t->right[node];
+        }
+    } else if (order == BST_PREORDER) {
+        pending[top++] = 0;
+        while (top > 0) {
+            int node = pending[--top];
+            emit1(sink, "visit", t->values[node]);
+            if (t->right[node] >= 0) pending[top++] = t->right[node];
+            if (t->left[node] >= 0) pending[top++] = t->left[node];
+        }
+    } else {
+        // Entries are node * 2 + 1 once the node's children are stacked
+        pending[top++] = 0;
+        while (top > 0) {
+            int entry = pending[--top];
+            int node = entry >> 1;
+            if (entry & 1) {
+                emit1(sink, "visit", t->values[node]);
+                continue;
+            }
+            pending[top++] = node * 2 + 1;
+            if (t->right[node] >= 0) pending[top++] = t->right[node] * 2;
+            if (t->left[node] >= 0) pending[top++] = t->left[node] * 2;
+        }
+    }
+    free(pending);
+    return 0;
 }
 
-void bst_preorder_with_cb(BSTNode *root, ir_callback_t cb, void *ctx) {
-    if (!root) return;
-    int args[1] = { root->value };
-    emit(cb, "bst_visit", args, 1, ctx);
-    bst_preorder_with_cb(root->left, cb, ctx);
-    bst_preorder_with_cb(root->right, cb, ctx);
+void bst_free(BST *t) {
+    free(t->values);
+    free(t->left);
+    free(t->right);
+    bst_init(t);
 }
 
-void bst_postorder_with_cb(BSTNode *root, ir_callback_t cb, void *ctx) {
-    if (!root) return;
-    bst_postorder_with_cb(root->left, cb, ctx);
-    bst_postorder_with_cb(root->right, cb, ctx);
-    int args[1] = { root->value };
-    emit(cb, "bst_visit", args, 1, ctx);
-}
+/* ---------------------------
+   Graph
+   --------------------------- */
 
-void bst_free(BSTNode *root) {
-    if (!root) return;
-    bst_free(root->left);
-    bst_free(root->right);
-    free(root);
+void graph_init(Graph *g) {
+    g->edges = NULL;
+    g->edge_count = 0;
+    g->capacity = 0;
+    g->max_node = 0;
 }
 
+void graph_add_node(Graph *g, int id, TraceSink *sink) {
+    if (id > g->max_node) g->max_node = id;
+    emit1(sink, "add_node", id);
+}
 
-typedef struct AdjNode {
-    int v;
-    struct AdjNode *next;
-} AdjNode;
+int graph_add_edge(Graph *g, int u, int v, TraceSink *sink) {
+    if (g->edge_count == g->capacity) {
+        int grown = g->capacity ? g->capacity * 2 : 16;
+        int (*bigger)[2] = realloc(g->edges, (size_t)grown * sizeof(*bigger));
+        if (!bigger) return -1;
+        g->edges = bigger;
+        g->capacity = grown;
+    }
+    g->edges[g->edge_count][0] = u;
+    g->edges[g->edge_count][1] = v;
+    g->edge_count++;
+    if (u > g->max_node) g->max_node = u;
+    if (v > g->max_node) g->max_node = v;
+    emit2(sink, "add_edge", u, v);
+    return 0;
+}
 
+// Adjacency in compressed (CSR) form: node v's neighbours are
+// neighbors[offsets[v] .. offsets[v + 1]), in edge order
 typedef struct {
-    int max_nodes;
-    AdjNode **adj; // array of adjacency lists
-    int *present;  // 1 if node exists, else 0
-    ir_callback_t cb;
-    void *ctx;
-} Graph;
-
-
-Graph *graph_create(int max_nodes, ir_callback_t cb, void *ctx) {
-    Graph *g = (Graph*)malloc(sizeof(Graph));
-    g->max_nodes = max_nodes;
-    g->adj = (AdjNode**)malloc(sizeof(AdjNode*) * max_nodes);
-    g->present = (int*)malloc(sizeof(int) * max_nodes);
-    for (int i = 0; i < max_nodes; ++i) { g->adj[i] = NULL; g->present[i] = 0; }
-    g->cb = cb; g->ctx = ctx;
-    emit(cb, "graph_init", NULL, 0, ctx);
-    return g;
-}
-
-void graph_add_node(Graph *g, int id) {
-    if (id < 0 || id >= g->max_nodes) return;
-    if (!g->present[id]) {
-        g->present[id] = 1;
-        int args[1] = { id };
-        emit(g->cb, "add_node", args, 1, g->ctx);
-    }
-}
-
-void graph_add_edge(Graph *g, int u, int v) {
-    if (u < 0 || u >= g->max_nodes || v < 0 || v >= g->max_nodes) return;
-    // add u->v
-    AdjNode *n1 = (AdjNode*)malloc(sizeof(AdjNode));
-    n1->v = v; n1->next = g->adj[u]; g->adj[u] = n1;
-    // add v->u (undirected)
-    AdjNode *n2 = (AdjNode*)malloc(sizeof(AdjNode));
-    n2->v = u; n2->next = g->adj[v]; g->adj[v] = n2;
-    int args[2] = { u, v };
-    emit(g->cb, "add_edge", args, 2, g->ctx);
-}
-
-/* BFS and DFS with emissions of "visit_node" and "edge_traverse" */
-void graph_bfs(Graph *g, int start) {
-    if (!g->present[start]) return;
-    int *visited = (int*)calloc(g->max_nodes, sizeof(int));
-    int *queue = (int*)malloc(sizeof(int) * g->max_nodes);
-    int qh = 0, qt = 0;
-    queue[qt++] = start; visited[start] = 1;
-    int args_start[1] = { start }; emit(g->cb, "bfs_start", args_start, 1, g->ctx);
-    while (qh < qt) {
-        int u = queue[qh++];
-        int args_visit[1] = { u }; emit(g->cb, "visit_node", args_visit, 1, g->ctx);
-        for (AdjNode *p = g->adj[u]; p; p = p->next) {
-            int v = p->v;
-            int args_edge[2] = { u, v }; emit(g->cb, "edge_traverse", args_edge, 2, g->ctx);
-            if (!visited[v]) {
-                visited[v] = 1;
-                queue[qt++] = v;
-            }
-        }
-    }
-    free(queue); free(visited);
-    emit(g->cb, "bfs_end", NULL, 0, g->ctx);
+    int *offsets;
+    int *neighbors;
+    char *visited;
+    int *pending;    // BFS queue or DFS stack
+} Search;
+
+static void free_search(Search *s) {
+    free(s->offsets);
+    free(s->neighbors);
+    free(s->visited);
+    free(s->pending);
 }
 
-static void graph_dfs_rec(Graph *g, int u, int *visited) {
-    visited[u] = 1;
-    int args_visit[1] = { u }; emit(g->cb, "visit_node", args_visit, 1, g->ctx);
-    for (AdjNode *p = g->adj[u]; p; p = p->next) {
-        int v = p->v;
-        int args_edge[2] = { u, v }; emit(g->cb, "edge_traverse", args_edge, 2, g->ctx);
-        if (!visited[v]) graph_dfs_rec(g, v, visited);
+static int start_search(const Graph *g, int nodes, Search *s) {
+    if (nodes > GRAPH_MAX_NODE_ID + 1) return -1;
+    size_t edges = (size_t)g->edge_count;
+    s->offsets = (int *)calloc((size_t)nodes + 1, sizeof(int));
+    s->neighbors = (int *)malloc((edges * 2 + 1) * sizeof(int));
+    s->visited = (char *)calloc((size_t)nodes, 1);
+    s->pending = (int *)malloc((edges * 2 + (size_t)nodes + 1) * sizeof(int));
+    int *fill = (int *)malloc((size_t)nodes * sizeof(int));
+    if (!s->offsets || !s->neighbors || !s->visited || !s->pending || !fill) {
+        free(fill);
+        free_search(s);
+        return -1;
+    }
+    for (int i = 0; i < g->edge_count; i++) {
+        s->offsets[g->edges[i][0] + 1]++;
+        s->offsets[g->edges[i][1] + 1]++;
+    }
+    for (int v = 0; v < nodes; v++) {
+        s->offsets[v + 1] += s->offsets[v];
+    }
+    memcpy(fill, s->offsets, (size_t)nodes * sizeof(int));
+    for (int i = 0; i < g->edge_count; i++) {
+        s->neighbors[fill[g->edges[i][0]]++] = g->edges[i][1];
+        s->neighbors[fill[g->edges[i][1]]++] = g->edges[i][0];
     }
+    free(fill);
+    return 0;
 }
 
-void graph_dfs(Graph *g, int start) {
-    if (!g->present[start]) return;
-    int *visited = (int*)calloc(g->max_nodes, sizeof(int));
-    int args_start[1] = { start }; emit(g->cb, "dfs_start", args_start, 1, g->ctx);
-    graph_dfs_rec(g, start, visited);
-    free(visited);
-    emit(g->cb, "dfs_end", NULL, 0, g->ctx);
+int graph_bfs(const Graph *g, int start, TraceSink *sink) {
+    Search s;
+    int nodes = (start > g->max_node ? start : g->max_node) + 1;
+    if (start_search(g, nodes, &s) != 0) return -1;
+    emit1(sink, "bfs_start", start);
+    int head = 0, tail = 0;
+    s.visited[start] = 1;
+    s.pending[tail++] = start;
+    emit1(sink, "visit", start);
+    while (head < tail) {
+        int current = s.pending[head++];
+        for (int e = s.offsets[current]; e < s.offsets[current + 1]; e++) {
+            int next = s.neighbors[e];
+            if (!s.visited[next]) {
+                s.visited[next] = 1;
+                s.pending[tail++] = next;
+                emit1(sink, "visit", next);
+            }
+        }
+    }
+    free_search(&s);
+    return 0;
 }
 
-void graph_free(Graph *g) {
-    if (!g) return;
-    for (int i = 0; i < g->max_nodes; ++i) {
-        AdjNode *p = g->adj[i];
-        while (p) {
-            AdjNode *tmp = p; p = p->next; free(tmp);
+// Neighbours are stacked in edge order, so the last one is explored first
+int graph_dfs(const Graph *g, int start, TraceSink *sink) {
+    Search s;
+    int nodes = (start > g->max_node ? start : g->max_node) + 1;
+    if (start_search(g, nodes, &s) != 0) return -1;
+    emit1(sink, "dfs_start", start);
+    int top = 0;
+    s.pending[top++] = start;
+    while (top > 0) {
+        int current = s.pending[--top];
+        if (s.visited[current]) continue;
+        s.visited[current] = 1;
+        emit1(sink, "visit", current);
+        for (int e = s.offsets[current]; e < s.offsets[current + 1]; e++) {
+            if (!s.visited[s.neighbors[e]]) s.pending[top++] = s.neighbors[e];
         }
     }
-    free(g->adj);
-    free(g->present);
-    emit(g->cb, "graph_free", NULL, 0, g->ctx);
-    free(g);
+    free_search(&s);
+    return 0;
 }
 
-
+void graph_free(Graph *g) {
+    free(g->edges);
+    graph_init(g);
+}
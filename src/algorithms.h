@@ -0,0 +1,239 @@
+#ifndef ALGORITHMS_H
+#define ALGORITHMS_H
+
+#include <stdio.h>
+#include "ir.h"
+
+// Every built-in algorithm and data structure, written once. Each one
+// reports what it does as steps to a TraceSink, so the same code fills a
+// trace's IR, streams steps to a file, or counts them for benchmarks. With
+// a NULL sink it runs untraced at full speed: every entry point has a copy
+// specialised for NULL in which the step calls compile away.
+//
+// A step is an action and up to TRACE_MAX_ARGS integers:
+//     compare {i, j} or {i}   swap {i, j}   no_swap {i, j}   mark_sorted {i}
+//     sift_down {root, heap end}   gap {gap}
+//     histogram {i, digit or bucket}   scatter {position, value}
+//     run {first, last}   merge {first, second run's first, last}   gallop {probe, key}
+//     split {first, last}   stage {first, last, k, j}
+//     push {top, value}   pop {top, value}   peek {top}
+//     enqueue {rear, value}   dequeue {front, value}
+//     insert {value, parent, side, depth}   visit {value or node}
+//     add_node {id}   add_edge {u, v}   bfs_start {start}   dfs_start {start}
+
+#define TRACE_MAX_ARGS 4
+
+typedef struct TraceSink TraceSink;
+struct TraceSink {
+    void (*step)(TraceSink *sink, const char *action, const int *args, int nargs);
+    // Optional: polled once per pass of a sort; nonzero stops the sort early
+    int (*stopped)(TraceSink *sink);
+    // Optional: the steps that follow come from worker lane `lane` of a
+    // parallel sort (-1: from no lane)
+    void (*lane)(TraceSink *sink, int lane);
+};
+
+/* ---------------------------
+   Sinks
+   --------------------------- */
+
+// Appends each step to an IR track. A step the track cannot keep sets
+// `status` (see addIRWithIndices) and stops the run, since the trace is
+// no longer whole.
+typedef struct {
+    TraceSink base;
+    IRContext *ir;
+    int status;
+} IRSink;
+
+void ir_sink_init(IRSink *sink, IRContext *ir);
+
+// Writes each step to `fp` as it happens, one JSON object per line, so
+// memory does not grow with the trace
+typedef struct {
+    TraceSink base;
+    FILE *fp;
+    long long steps;
+    int lane;
+} StreamSink;
+
+void stream_sink_init(StreamSink *sink, FILE *fp);
+
+// Counts steps without keeping them
+typedef struct {
+    TraceSink base;
+    long long steps;
+    long long compares;
+    long long swaps;
+} CountingSink;
+
+void counting_sink_init(CountingSink *sink);
+
+/* ---------------------------
+   Sorting: arr[0..n) ascending, in place. Each returns 0, or -1 if out
+   of memory for its scratch space.
+   --------------------------- */
+
+typedef int (*sort_fn)(int *arr, int n, TraceSink *sink);
+
+int bubble_sort(int *arr, int n, TraceSink *sink);
+int insertion_sort(int *arr, int n, TraceSink *sink);
+int selection_sort(int *arr, int n, TraceSink *sink);
+int merge_sort(int *arr, int n, TraceSink *sink);
+int quick_sort(int *arr, int n, TraceSink *sink);
+int heap_sort(int *arr, int n, TraceSink *sink);
+// Natural runs, binary insertion sort and galloping merges: near-sorted
+// input takes close to n compares
+int tim_sort(int *arr, int n, TraceSink *sink);
+
+// Sorts taking a tuning option; the plain forms use the first choice
+typedef int (*tuned_sort_fn)(int *arr, int n, int option, TraceSink *sink);
+
+// Gapped insertion sort. Each gap starts with a gap step; shifts are
+// shown as swaps of elements `gap` apart.
+typedef enum { SHELL_GAPS_CIURA, SHELL_GAPS_TOKUDA, SHELL_GAPS_SEDGEWICK } ShellGaps;
+
+int shell_sort(int *arr, int n, TraceSink *sink);
+int shell_sort_gaps(int *arr, int n, int gaps, TraceSink *sink);  // gaps: a ShellGaps
+
+// Quick sort strategies. Lomuto, median-of-three and ninther partition
+// around arr[high] (the latter two move their pivot there first); Hoare
+// and three-way around a ninther moved to arr[low]. Three-way marks every
+// element equal to the pivot sorted. Intro is Hoare that insertion sorts
+// small ranges and heap sorts a range after 2 log2(n) partitions. Pdq is
+// pattern-defeating quicksort: block partitioning, equal-element runs
+// handled in one pass, and a heap sort fallback after log2(n) unbalanced
+// partitions. All sort in O(log n) extra space.
+typedef enum {
+    QUICK_LOMUTO, QUICK_MEDIAN3, QUICK_NINTHER, QUICK_HOARE, QUICK_THREE_WAY, QUICK_INTRO, QUICK_PDQ
+} QuickStrategy;
+
+int quick_sort_strategy(int *arr, int n, int strategy, TraceSink *sink);  // strategy: a QuickStrategy
+
+// LSD radix sort on digits of 8, 11 or 16 bits (any of 1 to 16 works;
+// other values mean 8), least significant first. Each pass emits a histogram step per element, then a scatter
+// step per element placing it in the pass's output; after a pass's
+// scatters the array holds that output. Passes in which every element
+// has the same digit are skipped.
+int radix_sort(int *arr, int n, TraceSink *sink);
+int radix_sort_digits(int *arr, int n, int digit_bits, TraceSink *sink);
+
+// Merge sort over blocks of 16 or 8 elements (other values mean 16), each
+// sorted first by a bitonic sorting network. Untraced, the network and the
+// merges run in AVX2 or SSE2 registers when the CPU has them. Traced, each
+// network stage is one stage step (see algorithms.c), a leftover of less
+// than a block is insertion sorted, and the merges are merge sort's.
+int bitonic_sort(int *arr, int n, TraceSink *sink);
+int bitonic_sort_block(int *arr, int n, int block, TraceSink *sink);
+
+// Parallel sorts, split into `lanes` pieces of work run on a work-stealing
+// pool with a thread per CPU (0 lanes: one per CPU; each lane gets at
+// least two elements). Traced, every lane records its steps and each
+// fork-join phase is replayed lane by lane, one step at a time, with each
+// step tagged with its lane, so the trace depends on the lane count and
+// not on scheduling. A phase buffers at most PARALLEL_PHASE_STEPS steps:
+// past that, the sort returns PARALLEL_TRUNCATED unless the sink's
+// stopped() has ended it (-1 still means out of memory). The plain forms
+// use 4 lanes.
+//
+// Parallel merge sort merge sorts one block per lane, then merges pairs
+// of blocks until one is left; each merge is split by co-rank into
+// pieces for the lanes, shown as split {first, last} of the output each
+// piece writes, its compares, then its scatters once every piece of the
+// level has compared.
+int parallel_merge_sort(int *arr, int n, TraceSink *sink);
+int parallel_merge_sort_lanes(int *arr, int n, int lanes, TraceSink *sink);
+// Sample sort picks lanes - 1 splitters from a regular sample, shows
+// histogram {i, bucket} as each lane classifies its block, scatters the
+// buckets into place and merge sorts every bucket on its own lane
+int sample_sort(int *arr, int n, TraceSink *sink);
+int sample_sort_lanes(int *arr, int n, int lanes, TraceSink *sink);
+// Odd-even transposition sort over blocks: each lane merge sorts its
+// block, then rounds alternate between even and odd neighbouring pairs,
+// merging each pair and splitting it back into its blocks (compare and
+// no_swap of the boundary when it is already in order), until an even
+// and an odd round in a row merge nothing: about lanes rounds.
+int odd_even_sort(int *arr, int n, TraceSink *sink);
+int odd_even_sort_lanes(int *arr, int n, int lanes, TraceSink *sink);
+
+#define PARALLEL_PHASE_STEPS (1 << 24)
+#define PARALLEL_TRUNCATED (-2)
+
+// Caps the threads of the parallel sorts called from the calling thread
+// (0, the default: one per CPU). Callers that already keep every CPU busy,
+// such as batch mode's workers, set 1 so that jobs do not multiply threads.
+void parallel_sort_threads(int threads);
+
+/* ---------------------------
+   Data structures. Functions returning int give -1 when out of memory.
+   --------------------------- */
+
+typedef struct {
+    int *data;
+    int top;       // -1 when empty
+    int capacity;
+} Stack;
+
+void stack_init(Stack *s);
+int stack_push(Stack *s, int value, TraceSink *sink);
+// Return 0 when the stack is empty (and emit nothing)
+int stack_pop(Stack *s, int *value, TraceSink *sink);
+int stack_peek(const Stack *s, int *value, TraceSink *sink);
+void stack_free(Stack *s);
+
+// Positions are never reused: enqueue appends at rear + 1 and dequeue
+// advances front, so steps name each element by where it was enqueued
+typedef struct {
+    int *data;
+    int front;
+    int rear;      // front - 1 when empty
+    int capacity;
+} Queue;
+
+void queue_init(Queue *q);
+int queue_enqueue(Queue *q, int value, TraceSink *sink);
+// Returns 0 when the queue is empty
+int queue_dequeue(Queue *q, int *value, TraceSink *sink);
+void queue_free(Queue *q);
+
+// Binary search tree kept as parallel arrays in insertion order, so
+// `values` doubles as the trace's array. Equal values go right.
+typedef struct {
+    int *values;
+    int *left;     // Child positions, -1 if none
+    int *right;
+    int size;
+    int capacity;
+} BST;
+
+typedef enum { BST_INORDER, BST_PREORDER, BST_POSTORDER } BSTOrder;
+
+void bst_init(BST *t);
+// Emits insert {value, parent value, 1 if left child, 0}, with parent and
+// side -1 for the root
+int bst_insert(BST *t, int value, TraceSink *sink);
+// Emits visit {value} for every node
+int bst_traverse(const BST *t, BSTOrder order, TraceSink *sink);
+void bst_free(BST *t);
+
+// Undirected graph over node ids 0..GRAPH_MAX_NODE_ID. Searches follow
+// each node's edges in the order they were added, with tables sized by the
+// largest id, so ids are capped; a search over a larger id fails.
+#define GRAPH_MAX_NODE_ID 9999999
+
+typedef struct {
+    int (*edges)[2];
+    int edge_count;
+    int capacity;
+    int max_node;
+} Graph;
+
+void graph_init(Graph *g);
+void graph_add_node(Graph *g, int id, TraceSink *sink);
+int graph_add_edge(Graph *g, int u, int v, TraceSink *sink);
+// Emit bfs_start/dfs_start {start}, then visit {node} in visiting order
+int graph_bfs(const Graph *g, int start, TraceSink *sink);
+int graph_dfs(const Graph *g, int start, TraceSink *sink);
+void graph_free(Graph *g);
+
+#endif
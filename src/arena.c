@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_MIN_BLOCK  (64 * 1024)
+#define ARENA_MAX_BLOCK  (4 * 1024 * 1024)
+#define ARENA_ALIGN      _Alignof(max_align_t)
+
+struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t capacity;
+    _Alignas(max_align_t) unsigned char data[];
+};
+
+void arenaInit(Arena *arena) {
+    arena->head = NULL;
+    arena->nextBlockSize = ARENA_MIN_BLOCK;
+    arena->allocations = 0;
+    arena->blocks = 0;
+    arena->reserved = 0;
+}
+
+static ArenaBlock *newBlock(Arena *arena, size_t capacity) {
+    ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + capacity);
+    if (!block) return NULL;
+    arena->blocks++;
+    arena->reserved += capacity;
+    block->next = NULL;
+    block->used = 0;
+    block->capacity = capacity;
+    return block;
+}
+
+void *arenaAlloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    arena->allocations++;
+    ArenaBlock *block = arena->head;
+    if (block && block->capacity - block->used >= size) {
+        void *ptr = block->data + block->used;
+        block->used += size;
+        return ptr;
+    }
+
+    if (size > arena->nextBlockSize / 2 && block) {
+        // Large request: give it a dedicated block behind the current one so
+        // the remaining space in the current block keeps being used
+        ArenaBlock *large = newBlock(arena, size);
+        if (!large) return NULL;
+        large->used = size;
+        large->next = block->next;
+        block->next = large;
+        return large->data;
+    }
+
+    size_t capacity = arena->nextBlockSize > size ? arena->nextBlockSize : size;
+    block = newBlock(arena, capacity);
+    if (!block) return NULL;
+    block->next = arena->head;
+    arena->head = block;
+    if (arena->nextBlockSize < ARENA_MAX_BLOCK) arena->nextBlockSize *= 2;
+    block->used = size;
+    return block->data;
+}
+
+char *arenaStrndup(Arena *arena, const char *s, size_t len) {
+    char *copy = (char *)arenaAlloc(arena, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char *arenaStrdup(Arena *arena, const char *s) {
+    return arenaStrndup(arena, s, strlen(s));
+}
+
+void arenaRelease(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arenaInit(arena);
+}
@@ -0,0 +1,24 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+// Bump allocator owned by one compilation. Allocations are never freed
+// individually; arenaRelease drops every block at once.
+typedef struct Arena {
+    ArenaBlock *head;      // Current block (newest first)
+    size_t nextBlockSize;  // Size of the next block to allocate
+    size_t allocations;    // arenaAlloc calls, for profiling
+    size_t blocks;         // Blocks obtained from malloc
+    size_t reserved;       // Bytes in those blocks
+} Arena;
+
+void arenaInit(Arena *arena);
+void *arenaAlloc(Arena *arena, size_t size);
+char *arenaStrndup(Arena *arena, const char *s, size_t len);
+char *arenaStrdup(Arena *arena, const char *s);
+void arenaRelease(Arena *arena);
+
+#endif
@@ -2,11 +2,18 @@
 #include <string.h>
 #include "ast.h"
 
-static ASTNode *allocateNode(NodeType type) {
-    ASTNode *node = (ASTNode *)malloc(sizeof(ASTNode));
+static void setSymbol(ASTNode *node, const Symbol *sym) {
+    node->symbol = sym;
+    node->name = sym ? sym->name : NULL;
+}
+
+static ASTNode *allocateNode(Arena *arena, NodeType type) {
+    ASTNode *node = (ASTNode *)arenaAlloc(arena, sizeof(ASTNode));
     if (!node) return NULL;
     node->type = type;
+    node->symbol = NULL;
     node->name = NULL;
+    node->method = NULL;
     node->number = 0;
     node->array_values = NULL;
     node->array_count = 0;
@@ -15,27 +22,74 @@ static ASTNode *allocateNode(NodeType type) {
     node->body = NULL;
     node->cond = NULL;
     node->inc = NULL;
+    node->rhs = NULL;
+    node->index = NULL;
+    node->op = OP_ADD;
+    node->line = 0;
     return node;
 }
 
-ASTNode *appendSequence(ASTNode *a, ASTNode *b) {
-    if (!a) return b;
-    ASTNode *curr = a;
-    while (curr->right) curr = curr->right;
-    curr->right = b;
-    return a;
+ASTList startList(ASTNode *node) {
+    ASTList list = { NULL, NULL };
+    return appendList(list, node);
+}
+
+ASTList appendList(ASTList list, ASTNode *node) {
+    if (!node) return list;
+    if (list.tail) {
+        list.tail->right = node;
+    } else {
+        list.head = node;
+    }
+    // `node` may already carry siblings; each is only stepped over once
+    while (node->right) node = node->right;
+    list.tail = node;
+    return list;
 }
 
-ASTNode *createAssignNode(char *id, ASTNode *value) {
-    ASTNode *node = allocateNode(ASSIGN_NODE);
+NumberList *appendNumber(NumberList *list, int value) {
+    if (!list) {
+        list = (NumberList *)calloc(1, sizeof(NumberList));
+        if (!list) return NULL;
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        int *values = (int *)realloc(list->values, capacity * sizeof(int));
+        if (!values) {
+            // Dropping numbers would compile a different array; give up
+            freeNumberList(list);
+            return NULL;
+        }
+        list->values = values;
+        list->capacity = capacity;
+    }
+    list->values[list->count++] = value;
+    return list;
+}
+
+void freeNumberList(NumberList *list) {
+    if (!list) return;
+    free(list->values);
+    free(list);
+}
+
+ASTNode *createAssignNode(Arena *arena, const Symbol *id, ASTNode *value) {
+    ASTNode *node = allocateNode(arena, ASSIGN_NODE);
     if (!node) return NULL;
-    node->name = _strdup(id);
+    setSymbol(node, id);
     node->left = value;
     return node;
 }
 
-ASTNode *createLoopNode(ASTNode *init, ASTNode *cond, ASTNode *inc, ASTNode *body) {
-    ASTNode *node = allocateNode(LOOP_NODE);
+ASTNode *createElementAssignNode(Arena *arena, const Symbol *array, ASTNode *index, ASTNode *value) {
+    ASTNode *node = createAssignNode(arena, array, value);
+    if (!node) return NULL;
+    node->index = index;
+    return node;
+}
+
+ASTNode *createLoopNode(Arena *arena, ASTNode *init, ASTNode *cond, ASTNode *inc, ASTNode *body) {
+    ASTNode *node = allocateNode(arena, LOOP_NODE);
     if (!node) return NULL;
     node->left = init;
     node->cond = cond;
@@ -44,62 +98,99 @@ ASTNode *createLoopNode(ASTNode *init, ASTNode *cond, ASTNode *inc, ASTNode *bod
     return node;
 }
 
-ASTNode *createIfNode(ASTNode *cond, ASTNode *body) {
-    ASTNode *node = allocateNode(IF_NODE);
+ASTNode *createIfNode(Arena *arena, ASTNode *cond, ASTNode *body, ASTNode *otherwise) {
+    ASTNode *node = allocateNode(arena, IF_NODE);
     if (!node) return NULL;
     node->cond = cond;
     node->body = body;
+    node->left = otherwise;
     return node;
 }
 
-ASTNode *createValueNode(char *val) {
-    ASTNode *node = allocateNode(VALUE_NODE);
+ASTNode *createValueNode(Arena *arena, const Symbol *val) {
+    ASTNode *node = allocateNode(arena, VALUE_NODE);
     if (!node) return NULL;
-    node->name = _strdup(val);
+    setSymbol(node, val);
     return node;
 }
 
-ASTNode *createNumberNode(int value) {
-    ASTNode *node = allocateNode(NUMBER_NODE);
+ASTNode *createNumberNode(Arena *arena, int value) {
+    ASTNode *node = allocateNode(arena, NUMBER_NODE);
     if (!node) return NULL;
     node->number = value;
     return node;
 }
 
-ASTNode *createArrayDeclNode(char *name, int *values, int count) {
-    ASTNode *node = allocateNode(ARRAY_DECL_NODE);
+ASTNode *createArrayDeclNode(Arena *arena, const Symbol *name, int *values, int count) {
+    ASTNode *node = allocateNode(arena, ARRAY_DECL_NODE);
     if (!node) return NULL;
-    node->name = _strdup(name);
+    setSymbol(node, name);
     if (values && count > 0) {
-        node->array_values = (int *)malloc(count * sizeof(int));
-        if (node->array_values) {
-            for (int i = 0; i < count; i++) {
-                node->array_values[i] = values[i];
-            }
-            node->array_count = count;
-        }
+        node->array_values = (int *)arenaAlloc(arena, count * sizeof(int));
+        if (!node->array_values) return NULL;  // Not an empty array: the caller fails the parse
+        memcpy(node->array_values, values, count * sizeof(int));
+        node->array_count = count;
     }
     return node;
 }
 
-ASTNode *createAlgorithmCallNode(char *algorithm_name, ASTNode *arg) {
-    ASTNode *node = allocateNode(ALGORITHM_CALL_NODE);
+ASTNode *createArrayInitNode(Arena *arena, const Symbol *name, ASTNode *init) {
+    ASTNode *node = allocateNode(arena, ARRAY_DECL_NODE);
     if (!node) return NULL;
-    node->name = _strdup(algorithm_name);
+    setSymbol(node, name);
+    node->left = init;
+    return node;
+}
+
+ASTNode *createStringNode(Arena *arena, const char *text) {
+    ASTNode *node = allocateNode(arena, STRING_NODE);
+    if (!node) return NULL;
+    node->name = text;
+    return node;
+}
+
+ASTNode *createIndexNode(Arena *arena, const Symbol *array, ASTNode *index) {
+    ASTNode *node = allocateNode(arena, INDEX_NODE);
+    if (!node) return NULL;
+    setSymbol(node, array);
+    node->left = index;
+    return node;
+}
+
+ASTNode *createBinaryNode(Arena *arena, BinaryOp op, ASTNode *lhs, ASTNode *rhs) {
+    ASTNode *node = allocateNode(arena, BINARY_NODE);
+    if (!node) return NULL;
+    node->op = op;
+    node->left = lhs;
+    node->rhs = rhs;
+    return node;
+}
+
+ASTNode *createNegateNode(Arena *arena, ASTNode *operand) {
+    if (operand && operand->type == NUMBER_NODE) {
+        operand->number = (int)(0u - (unsigned)operand->number);
+        return operand;
+    }
+    return createBinaryNode(arena, OP_SUB, createNumberNode(arena, 0), operand);
+}
+
+ASTNode *createAlgorithmCallNode(Arena *arena, const Symbol *algorithm, ASTNode *arg) {
+    ASTNode *node = allocateNode(arena, ALGORITHM_CALL_NODE);
+    if (!node) return NULL;
+    setSymbol(node, algorithm);
     node->left = arg;  // Use left to store the argument
     return node;
 }
 
-void freeAST(ASTNode *node) {
-    if (!node) return;
-    freeAST(node->left);
-    freeAST(node->right);
-    freeAST(node->body);
-    freeAST(node->cond);
-    freeAST(node->inc);
-    if (node->name) free(node->name);
-    if (node->array_values) free(node->array_values);
-    free(node);
+ASTNode *createMethodCallNode(Arena *arena, const Symbol *object, const Symbol *method, ASTNode *arg) {
+    ASTNode *node = createAlgorithmCallNode(arena, object, arg);
+    if (!node) return NULL;
+    node->method = method;
+    return node;
 }
 
+ASTNode *setLine(ASTNode *node, int line) {
+    if (node) node->line = line;
+    return node;
+}
 
@@ -1,6 +1,9 @@
 #ifndef AST_H
 #define AST_H
 
+#include "arena.h"
+#include "symbols.h"
+
 typedef enum {
     ASSIGN_NODE,
     LOOP_NODE,
@@ -9,33 +12,94 @@ typedef enum {
     NUMBER_NODE,
     SEQ_NODE,
     ARRAY_DECL_NODE,
-    ALGORITHM_CALL_NODE
+    ALGORITHM_CALL_NODE,
+    STRING_NODE,
+    INDEX_NODE,
+    BINARY_NODE
 } NodeType;
 
+// Operators of BINARY_NODE. Unary minus is parsed as 0 - x.
+typedef enum {
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE,
+    OP_EQ,
+    OP_NE,
+    OP_AND,     // Short-circuit
+    OP_OR
+} BinaryOp;
+
 typedef struct ASTNode {
     NodeType type;
-    char *name;              // For identifiers or string values
+    const Symbol *symbol;    // Interned identifier (variable, array, callee or object)
+    const char *name;        // symbol->name, kept for diagnostics
+    const Symbol *method;    // Method of an obj.method(args) call, else NULL
     int number;              // For numeric literals
     int *array_values;       // For array declaration values
     int array_count;         // Number of elements in array
-    struct ASTNode *left;    // Generic child (e.g., value/init)
+    struct ASTNode *left;    // Generic child (e.g., value/init, index, else branch)
     struct ASTNode *right;   // Next in sequence or generic child
     struct ASTNode *body;    // Body for loop/if
     struct ASTNode *cond;    // Condition for loop/if
     struct ASTNode *inc;     // Increment for loop
+    struct ASTNode *rhs;     // Right operand of a binary expression
+    struct ASTNode *index;   // Subscript of an element assignment arr[index] = value
+    BinaryOp op;
+    int line;                // Source line of a statement, 0 for expressions
 } ASTNode;
 
-ASTNode *appendSequence(ASTNode *a, ASTNode *b);
+// Sibling chain (linked through `right`) under construction. Tracking the
+// tail keeps each append O(1) instead of re-walking the list.
+typedef struct ASTList {
+    ASTNode *head;
+    ASTNode *tail;
+} ASTList;
+
+ASTList startList(ASTNode *node);
+ASTList appendList(ASTList list, ASTNode *node);
+
+// Growable vector for array literals while they are being parsed
+typedef struct NumberList {
+    int *values;
+    int count;
+    int capacity;
+} NumberList;
 
-ASTNode *createAssignNode(char *id, ASTNode *value);
-ASTNode *createLoopNode(ASTNode *init, ASTNode *cond, ASTNode *inc, ASTNode *body);
-ASTNode *createIfNode(ASTNode *cond, ASTNode *body);
-ASTNode *createValueNode(char *val);
-ASTNode *createNumberNode(int value);
-ASTNode *createArrayDeclNode(char *name, int *values, int count);
-ASTNode *createAlgorithmCallNode(char *algorithm_name, ASTNode *arg);
+// Frees the list and returns NULL if it cannot grow
+NumberList *appendNumber(NumberList *list, int value);
+void freeNumberList(NumberList *list);
 
-void freeAST(ASTNode *node);
+// Nodes and array values are allocated from `arena` and released together
+// with it. Symbols come from the compilation's SymbolTable, which lives in
+// the same arena.
+ASTNode *createAssignNode(Arena *arena, const Symbol *id, ASTNode *value);
+// arr[index] = value;
+ASTNode *createElementAssignNode(Arena *arena, const Symbol *array, ASTNode *index, ASTNode *value);
+// for loops; while loops have no init or inc
+ASTNode *createLoopNode(Arena *arena, ASTNode *init, ASTNode *cond, ASTNode *inc, ASTNode *body);
+// `otherwise` (may be NULL) is the else branch: a statement list or an if
+ASTNode *createIfNode(Arena *arena, ASTNode *cond, ASTNode *body, ASTNode *otherwise);
+ASTNode *createValueNode(Arena *arena, const Symbol *val);
+ASTNode *createNumberNode(Arena *arena, int value);
+// NULL if out of memory for the node or for its copy of the values
+ASTNode *createArrayDeclNode(Arena *arena, const Symbol *name, int *values, int count);
+// arr[] = init(args);  `init` is a call node evaluated by collectDSLInfo
+ASTNode *createArrayInitNode(Arena *arena, const Symbol *name, ASTNode *init);
+ASTNode *createStringNode(Arena *arena, const char *text);
+ASTNode *createIndexNode(Arena *arena, const Symbol *array, ASTNode *index);
+ASTNode *createBinaryNode(Arena *arena, BinaryOp op, ASTNode *lhs, ASTNode *rhs);
+// -operand; literals are negated in place so -5 stays a NUMBER_NODE
+ASTNode *createNegateNode(Arena *arena, ASTNode *operand);
+ASTNode *createAlgorithmCallNode(Arena *arena, const Symbol *algorithm, ASTNode *arg);
+ASTNode *createMethodCallNode(Arena *arena, const Symbol *object, const Symbol *method, ASTNode *arg);
+// Records where a statement starts, for diagnostics; returns `node`
+ASTNode *setLine(ASTNode *node, int line);
 
 #endif
 
@@ -0,0 +1,426 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include "batch.h"
+#include "algorithms.h"
+#include "compiler.h"
+#include "threadpool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <time.h>
+#endif
+
+typedef struct {
+    char *inputPath;
+    char *outputPath;
+    CompileStatus status;
+    int stepCount;
+    int cached;
+    const TraceCache *cache;
+    const VMLimits *limits;
+    double elapsedMs;
+    char message[256];
+} BatchJob;
+
+typedef struct {
+    char **items;
+    int count;
+    int capacity;
+} PathList;
+
+double monotonicMs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1000.0 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+#endif
+}
+
+static char *copyString(const char *s) {
+    size_t len = strlen(s);
+    char *copy = (char *)malloc(len + 1);
+    if (copy) memcpy(copy, s, len + 1);
+    return copy;
+}
+
+static void addPath(PathList *list, const char *dir, const char *name) {
+    if (list->count == list->capacity) {
+        int newcap = list->capacity ? list->capacity * 2 : 64;
+        char **grown = (char **)realloc(list->items, sizeof(char *) * newcap);
+        if (!grown) return;
+        list->items = grown;
+        list->capacity = newcap;
+    }
+    char *path;
+    if (dir) {
+        size_t dlen = strlen(dir), nlen = strlen(name);
+        path = (char *)malloc(dlen + nlen + 2);
+        if (!path) return;
+        memcpy(path, dir, dlen);
+        path[dlen] = '/';
+        memcpy(path + dlen + 1, name, nlen + 1);
+    } else {
+        path = copyString(name);
+        if (!path) return;
+    }
+    list->items[list->count++] = path;
+}
+
+static int isDirectory(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int hasWildcard(const char *s) {
+    return strpbrk(s, "*?") != NULL;
+}
+
+int isBatchInput(const char *path) {
+    return hasWildcard(path) || isDirectory(path);
+}
+
+// Shell-style matching of '*' and '?' against a single file name
+static int matchWildcard(const char *pattern, const char *name) {
+    const char *star = NULL, *resume = NULL;
+    while (*name) {
+        if (*pattern == '?' || *pattern == *name) {
+            pattern++;
+            name++;
+        } else if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        } else if (star) {
+            pattern = star + 1;
+            name = ++resume;
+        } else {
+            return 0;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
+
+static const char *baseName(const char *path) {
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash && (!slash || backslash > slash)) slash = backslash;
+    return slash ? slash + 1 : path;
+}
+
+static void addMatchingFiles(PathList *list, const char *dir, const char *pattern) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        if (!matchWildcard(pattern, entry->d_name)) continue;
+        size_t len = strlen(dir) + strlen(entry->d_name) + 2;
+        char *full = (char *)malloc(len);
+        if (!full) continue;
+        snprintf(full, len, "%s/%s", dir, entry->d_name);
+        if (!isDirectory(full)) addPath(list, dir, entry->d_name);
+        free(full);
+    }
+    closedir(d);
+}
+
+static void expandInput(PathList *list, const char *input) {
+    if (hasWildcard(input)) {
+        const char *name = baseName(input);
+        if (name == input) {
+            addMatchingFiles(list, ".", name);
+        } else {
+            size_t dlen = (size_t)(name - input - 1);
+            char *dir = (char *)malloc(dlen + 1);
+            if (!dir) return;
+            memcpy(dir, input, dlen);
+            dir[dlen] = '\0';
+            addMatchingFiles(list, dlen ? dir : "/", name);
+            free(dir);
+        }
+    } else if (isDirectory(input)) {
+        addMatchingFiles(list, input, "*.algo");
+    } else {
+        addPath(list, NULL, input);  // Missing files are reported per job
+    }
+}
+
+static int comparePaths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// The default summary is <outputDir>/summary.json, so an input with this
+// stem is numbered from _2 rather than have its trace overwritten
+#define SUMMARY_STEM "summary"
+
+// Output names are <stem>.json; inputs sharing a stem get _2, _3, ...
+static char *makeOutputPath(const char *outputDir, const char *input, int duplicate) {
+    const char *name = baseName(input);
+    const char *dot = strrchr(name, '.');
+    size_t stemLen = dot && dot != name ? (size_t)(dot - name) : strlen(name);
+    size_t len = strlen(outputDir) + stemLen + 32;
+    char *path = (char *)malloc(len);
+    if (!path) return NULL;
+    if (duplicate > 1) {
+        snprintf(path, len, "%s/%.*s_%d.json", outputDir, (int)stemLen, name, duplicate);
+    } else {
+        snprintf(path, len, "%s/%.*s.json", outputDir, (int)stemLen, name);
+    }
+    return path;
+}
+
+typedef struct {
+    const char *stem;
+    size_t stemLen;
+    int index;
+} StemEntry;
+
+static int compareStems(const void *a, const void *b) {
+    const StemEntry *x = (const StemEntry *)a, *y = (const StemEntry *)b;
+    size_t n = x->stemLen < y->stemLen ? x->stemLen : y->stemLen;
+    int c = memcmp(x->stem, y->stem, n);
+    if (c != 0) return c;
+    if (x->stemLen != y->stemLen) return x->stemLen < y->stemLen ? -1 : 1;
+    return x->index - y->index;
+}
+
+static void assignOutputPaths(BatchJob *jobs, int count, const char *outputDir) {
+    StemEntry *stems = (StemEntry *)malloc(sizeof(StemEntry) * (count > 0 ? count : 1));
+    if (!stems) return;
+    for (int i = 0; i < count; i++) {
+        const char *name = baseName(jobs[i].inputPath);
+        const char *dot = strrchr(name, '.');
+        stems[i].stem = name;
+        stems[i].stemLen = dot && dot != name ? (size_t)(dot - name) : strlen(name);
+        stems[i].index = i;
+    }
+    qsort(stems, count, sizeof(StemEntry), compareStems);
+    int duplicate = 1;
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && stems[i].stemLen == stems[i - 1].stemLen &&
+            memcmp(stems[i].stem, stems[i - 1].stem, stems[i].stemLen) == 0) {
+            duplicate++;
+        } else {
+            int reserved = stems[i].stemLen == strlen(SUMMARY_STEM) &&
+                           memcmp(stems[i].stem, SUMMARY_STEM, stems[i].stemLen) == 0;
+            duplicate = reserved ? 2 : 1;
+        }
+        BatchJob *job = &jobs[stems[i].index];
+        job->outputPath = makeOutputPath(outputDir, job->inputPath, duplicate);
+    }
+    free(stems);
+}
+
+static void compileJob(void *arg) {
+    BatchJob *job = (BatchJob *)arg;
+    double start = monotonicMs();
+
+    CompilerContext ctx;
+    initCompilerContext(&ctx, job->inputPath);
+    setCompilerQuiet(&ctx, 1);
+    setCompilerCache(&ctx, job->cache);
+    setCompilerLimits(&ctx, job->limits);
+    setCompilerThreads(&ctx, 1);  // The pool's workers are already busy
+    parallel_sort_threads(1);     // And so are the CPUs a parallel sort would use
+    job->status = job->outputPath ? compileFile(&ctx, job->outputPath) : COMPILE_OUTPUT_ERROR;
+    job->stepCount = job->status == COMPILE_OK ? traceStepCount(&ctx.ir) : 0;
+    job->cached = ctx.cacheHit;
+    snprintf(job->message, sizeof(job->message), "%s", compileErrorMessage(&ctx));
+    freeCompilerContext(&ctx);
+
+    job->elapsedMs = monotonicMs() - start;
+}
+
+static void writeJSONString(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', fp);
+            fputc(c, fp);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static int writeSummary(const char *path, const BatchJob *jobs, int count,
+                        int threads, int succeeded, double wallMs) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s for writing\n", path);
+        return -1;
+    }
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"files\": %d,\n", count);
+    fprintf(fp, "  \"succeeded\": %d,\n", succeeded);
+    fprintf(fp, "  \"failed\": %d,\n", count - succeeded);
+    fprintf(fp, "  \"threads\": %d,\n", threads);
+    fprintf(fp, "  \"wallTimeMs\": %.3f,\n", wallMs);
+    fprintf(fp, "  \"results\": [\n");
+    for (int i = 0; i < count; i++) {
+        const BatchJob *job = &jobs[i];
+        fprintf(fp, "    {\"input\": ");
+        writeJSONString(fp, job->inputPath);
+        fprintf(fp, ", \"output\": ");
+        writeJSONString(fp, job->outputPath ? job->outputPath : "");
+        fprintf(fp, ", \"status\": \"%s\", \"steps\": %d, \"timeMs\": %.3f",
+                compileStatusName(job->status), job->stepCount, job->elapsedMs);
+        if (job->cached) {
+            fprintf(fp, ", \"cached\": true");
+        }
+        if (job->message[0] != '\0') {
+            fprintf(fp, ", \"message\": ");
+            writeJSONString(fp, job->message);
+        }
+        fprintf(fp, "}%s\n", i < count - 1 ? "," : "");
+    }
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+static void ensureDirectory(const char *path) {
+    if (isDirectory(path)) return;
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0777);
+#endif
+}
+
+int planBatch(const char *outputDir, const char **inputs, int inputCount, BatchPlan *plan) {
+    PathList files = { NULL, 0, 0 };
+    plan->inputs = NULL;
+    plan->outputs = NULL;
+    plan->count = 0;
+    for (int i = 0; i < inputCount; i++) {
+        expandInput(&files, inputs[i]);
+    }
+    if (files.count == 0) {
+        free(files.items);
+        return 0;
+    }
+    qsort(files.items, files.count, sizeof(char *), comparePaths);
+
+    BatchJob *jobs = (BatchJob *)calloc(files.count, sizeof(BatchJob));
+    char **outputs = (char **)malloc(sizeof(char *) * files.count);
+    if (!jobs || !outputs) {
+        for (int i = 0; i < files.count; i++) free(files.items[i]);
+        free(files.items);
+        free(jobs);
+        free(outputs);
+        return -1;
+    }
+    for (int i = 0; i < files.count; i++) {
+        jobs[i].inputPath = files.items[i];
+    }
+    ensureDirectory(outputDir);
+    assignOutputPaths(jobs, files.count, outputDir);
+    for (int i = 0; i < files.count; i++) {
+        outputs[i] = jobs[i].outputPath;
+    }
+    free(jobs);
+    plan->inputs = files.items;
+    plan->outputs = outputs;
+    plan->count = files.count;
+    return files.count;
+}
+
+void freeBatchPlan(BatchPlan *plan) {
+    for (int i = 0; i < plan->count; i++) {
+        free(plan->inputs[i]);
+        free(plan->outputs[i]);
+    }
+    free(plan->inputs);
+    free(plan->outputs);
+    plan->inputs = NULL;
+    plan->outputs = NULL;
+    plan->count = 0;
+}
+
+int runBatch(const BatchOptions *options, const char **inputs, int inputCount) {
+    const char *outputDir = options->outputDir ? options->outputDir : ".";
+
+    BatchPlan plan;
+    int count = planBatch(outputDir, inputs, inputCount, &plan);
+    if (count == 0) {
+        fprintf(stderr, "Error: No input files matched\n");
+        return 1;
+    }
+    BatchJob *jobs = count > 0 ? (BatchJob *)calloc(count, sizeof(BatchJob)) : NULL;
+    if (!jobs) {
+        fprintf(stderr, "Error: Out of memory\n");
+        freeBatchPlan(&plan);
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        jobs[i].inputPath = plan.inputs[i];
+        jobs[i].outputPath = plan.outputs[i];
+        jobs[i].cache = options->cache;
+        jobs[i].limits = options->limits;
+    }
+
+    int threads = options->threads > 0 ? options->threads : threadPoolDefaultSize();
+    if (threads > count) threads = count;
+
+    printf("Batch: compiling %d file(s) on %d thread(s)...\n", count, threads);
+    double start = monotonicMs();
+    ThreadPool *pool = threadPoolCreate(threads);
+    if (pool) {
+        threads = threadPoolSize(pool);
+        for (int i = 0; i < count; i++) {
+            threadPoolSubmit(pool, compileJob, &jobs[i]);
+        }
+        threadPoolWait(pool);
+        threadPoolDestroy(pool);
+    } else {
+        threads = 1;
+        for (int i = 0; i < count; i++) {
+            compileJob(&jobs[i]);
+        }
+    }
+    double wallMs = monotonicMs() - start;
+
+    int succeeded = 0;
+    for (int i = 0; i < count; i++) {
+        if (jobs[i].status == COMPILE_OK) {
+            succeeded++;
+        } else {
+            fprintf(stderr, "  [%s] %s: %s\n", compileStatusName(jobs[i].status),
+                    jobs[i].inputPath, jobs[i].message);
+        }
+    }
+
+    char defaultSummary[1024];
+    const char *summaryPath = options->summaryPath;
+    if (!summaryPath) {
+        snprintf(defaultSummary, sizeof(defaultSummary), "%s/" SUMMARY_STEM ".json", outputDir);
+        summaryPath = defaultSummary;
+    }
+    int summaryStatus = writeSummary(summaryPath, jobs, count, threads, succeeded, wallMs);
+
+    printf("Batch: %d succeeded, %d failed in %.1f ms. Summary written to %s\n",
+           succeeded, count - succeeded, wallMs, summaryPath);
+
+    free(jobs);
+    freeBatchPlan(&plan);
+    return (succeeded == count && summaryStatus == 0) ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "tracecache.h"
+#include "vm.h"
+
+typedef struct {
+    const char *outputDir;    // Directory receiving one <name>.json per input
+    const char *summaryPath;  // Machine-readable summary (NULL = <outputDir>/summary.json)
+    int threads;              // Worker count (0 = one per CPU)
+    const TraceCache *cache;  // Shared trace cache (NULL = off)
+    const VMLimits *limits;   // Bounds on each program (NULL = defaults)
+} BatchOptions;
+
+// Inputs after expansion, sorted, each paired with the trace it writes
+typedef struct {
+    char **inputs;
+    char **outputs;
+    int count;
+} BatchPlan;
+
+// Returns 1 if `path` names a directory or contains a * / ? wildcard
+int isBatchInput(const char *path);
+
+// Expand files, directories (all *.algo inside) and wildcard patterns,
+// compile them concurrently and write the summary. Returns 0 if every
+// input compiled successfully.
+int runBatch(const BatchOptions *options, const char **inputs, int inputCount);
+
+// The expansion and <out-dir>/<stem>.json naming runBatch uses, without
+// compiling. Returns the number of files, 0 if nothing matched, -1 if out
+// of memory.
+int planBatch(const char *outputDir, const char **inputs, int inputCount, BatchPlan *plan);
+void freeBatchPlan(BatchPlan *plan);
+
+// Milliseconds on a monotonic clock, for measuring intervals
+double monotonicMs(void);
+
+#endif
@@ -0,0 +1,770 @@
+// dsa_bench: times every algorithm of the engine on generated arrays,
+// untraced and traced into each kind of sink: counting, in memory (an IR
+// track, as the compiler builds) and streaming (JSON lines to the null
+// device). It reports nanoseconds per element, what tracing costs per
+// emitted step over the untraced run, the compares and swaps the trace
+// counts and, on Linux when perf_event_open is allowed, cycles,
+// instructions, cache misses and branch misses. Results are printed as a
+// table and can also be written as CSV and JSON, so runs can be compared
+// from one version to the next.
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#elif !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "algorithms.h"
+#include "generators.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define MAX_LIST 32
+#define DEFAULT_REPEATS 5
+#define DEFAULT_WARMUP 1
+#define DEFAULT_MAX_SECONDS 10.0
+#define DEFAULT_MAX_MEMORY_MB 1024
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/* ---------------------------
+   Algorithms
+   --------------------------- */
+
+typedef struct {
+    const char *name;      // "quick_sort/pdq": the DSL name, then its option
+    sort_fn sort;
+    tuned_sort_fn tuned;   // Called with `option` when sort is NULL
+    int option;
+    int (*run)(int *arr, int n, TraceSink *sink);  // Data structures, fed arr
+} BenchAlgorithm;
+
+// Pushes every element, then pops them all
+static int runStack(int *arr, int n, TraceSink *sink) {
+    Stack s;
+    int value, status = 0;
+    stack_init(&s);
+    for (int i = 0; i < n && status == 0; i++) status = stack_push(&s, arr[i], sink);
+    while (stack_pop(&s, &value, sink)) {}
+    stack_free(&s);
+    return status;
+}
+
+static int runQueue(int *arr, int n, TraceSink *sink) {
+    Queue q;
+    int value, status = 0;
+    queue_init(&q);
+    for (int i = 0; i < n && status == 0; i++) status = queue_enqueue(&q, arr[i], sink);
+    while (queue_dequeue(&q, &value, sink)) {}
+    queue_free(&q);
+    return status;
+}
+
+// Inserts every element, then walks the tree in order
+static int runTree(int *arr, int n, TraceSink *sink) {
+    BST t;
+    int status = 0;
+    bst_init(&t);
+    for (int i = 0; i < n && status == 0; i++) status = bst_insert(&t, arr[i], sink);
+    if (status == 0) status = bst_traverse(&t, BST_INORDER, sink);
+    bst_free(&t);
+    return status;
+}
+
+// A path through nodes 0..n-1, plus an edge from each node to the node its
+// element names; then a BFS and a DFS from node 0
+static int runGraph(int *arr, int n, TraceSink *sink) {
+    Graph g;
+    int status = 0;
+    graph_init(&g);
+    for (int i = 0; i < n; i++) graph_add_node(&g, i, sink);
+    for (int i = 1; i < n && status == 0; i++) {
+        status = graph_add_edge(&g, i - 1, i, sink);
+        if (status == 0) status = graph_add_edge(&g, i, (int)((unsigned)arr[i] % (unsigned)n), sink);
+    }
+    if (status == 0) status = graph_bfs(&g, 0, sink);
+    if (status == 0) status = graph_dfs(&g, 0, sink);
+    graph_free(&g);
+    return status;
+}
+
+static const BenchAlgorithm algorithms[] = {
+    { "bubble_sort", bubble_sort, NULL, 0, NULL },
+    { "insertion_sort", insertion_sort, NULL, 0, NULL },
+    { "selection_sort", selection_sort, NULL, 0, NULL },
+    { "merge_sort", merge_sort, NULL, 0, NULL },
+    { "quick_sort/lomuto", NULL, quick_sort_strategy, QUICK_LOMUTO, NULL },
+    { "quick_sort/median3", NULL, quick_sort_strategy, QUICK_MEDIAN3, NULL },
+    { "quick_sort/ninther", NULL, quick_sort_strategy, QUICK_NINTHER, NULL },
+    { "quick_sort/hoare", NULL, quick_sort_strategy, QUICK_HOARE, NULL },
+    { "quick_sort/three_way", NULL, quick_sort_strategy, QUICK_THREE_WAY, NULL },
+    { "quick_sort/intro", NULL, quick_sort_strategy, QUICK_INTRO, NULL },
+    { "quick_sort/pdq", NULL, quick_sort_strategy, QUICK_PDQ, NULL },
+    { "heap_sort", heap_sort, NULL, 0, NULL },
+    { "shell_sort/ciura", NULL, shell_sort_gaps, SHELL_GAPS_CIURA, NULL },
+    { "shell_sort/tokuda", NULL, shell_sort_gaps, SHELL_GAPS_TOKUDA, NULL },
+    { "shell_sort/sedgewick", NULL, shell_sort_gaps, SHELL_GAPS_SEDGEWICK, NULL },
+    { "radix_sort/8", NULL, radix_sort_digits, 8, NULL },
+    { "radix_sort/11", NULL, radix_sort_digits, 11, NULL },
+    { "radix_sort/16", NULL, radix_sort_digits, 16, NULL },
+    { "tim_sort", tim_sort, NULL, 0, NULL },
+    { "bitonic_sort/16", NULL, bitonic_sort_block, 16, NULL },
+    { "bitonic_sort/8", NULL, bitonic_sort_block, 8, NULL },
+    { "parallel_merge_sort/4", NULL, parallel_merge_sort_lanes, 4, NULL },
+    { "sample_sort/4", NULL, sample_sort_lanes, 4, NULL },
+    { "odd_even_sort/4", NULL, odd_even_sort_lanes, 4, NULL },
+    { "stack", NULL, NULL, 0, runStack },
+    { "queue", NULL, NULL, 0, runQueue },
+    { "tree", NULL, NULL, 0, runTree },
+    { "graph", NULL, NULL, 0, runGraph },
+};
+
+#define ALGORITHM_COUNT ((int)(sizeof(algorithms) / sizeof(algorithms[0])))
+
+static int runAlgorithm(const BenchAlgorithm *alg, int *arr, int n, TraceSink *sink) {
+    if (alg->run) return alg->run(arr, n, sink);
+    if (alg->sort) return alg->sort(arr, n, sink);
+    return alg->tuned(arr, n, alg->option, sink);
+}
+
+// "quick_sort" selects every strategy, "quick_sort/pdq" just the one
+static int algorithmMatches(const BenchAlgorithm *alg, const char *pattern) {
+    size_t length = strlen(pattern);
+    if (strncmp(alg->name, pattern, length) != 0) return 0;
+    return alg->name[length] == '\0' || (alg->name[length] == '/' && strchr(pattern, '/') == NULL);
+}
+
+/* ---------------------------
+   Inputs: the DSL's array generators
+   --------------------------- */
+
+static const SymbolId distributions[] = {
+    SYM_RANDOM, SYM_SORTED, SYM_REVERSED, SYM_NEARLY_SORTED, SYM_FEW_UNIQUE, SYM_ORGAN_PIPE
+};
+
+#define DISTRIBUTION_COUNT ((int)(sizeof(distributions) / sizeof(distributions[0])))
+
+// Returns a malloc'd array of n values, or NULL with a message printed.
+// nearly_sorted makes n/100 swaps and few_unique draws from 16 values.
+static int *makeInput(SymbolId dist, int n, int seed) {
+    const ArrayGenerator *gen = findArrayGenerator(dist);
+    int args[GENERATOR_MAX_ARGS] = { n, seed, seed };
+    if (dist == SYM_NEARLY_SORTED) args[1] = n / 100;
+    if (dist == SYM_FEW_UNIQUE) args[1] = 16;
+    Arena arena;
+    char error[256];
+    arenaInit(&arena);
+    int *values = runArrayGenerator(gen, args, &arena, error, sizeof(error));
+    int *copy = values ? (int *)malloc((size_t)n * sizeof(int) + 1) : NULL;
+    if (copy) memcpy(copy, values, (size_t)n * sizeof(int));
+    else fprintf(stderr, "Error: %s(%d): %s\n", builtinName(dist), n, values ? "Out of memory" : error);
+    arenaRelease(&arena);
+    return copy;
+}
+
+/* ---------------------------
+   Timing and hardware counters
+   --------------------------- */
+
+static double clockNs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+typedef enum { COUNTER_CYCLES, COUNTER_INSTRUCTIONS, COUNTER_CACHE_MISSES, COUNTER_BRANCH_MISSES, COUNTER_COUNT } Counter;
+
+static const char *const counterNames[COUNTER_COUNT] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+
+// One perf event per counter, each opened on its own so a machine missing
+// one still reports the others. fd is -1 for a counter that is not there.
+typedef struct {
+    int fd[COUNTER_COUNT];
+} Counters;
+
+static void countersOpen(Counters *c, int wanted) {
+    for (int i = 0; i < COUNTER_COUNT; i++) c->fd[i] = -1;
+    if (!wanted) return;
+#ifdef __linux__
+    static const unsigned long long configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    int lastError = 0, opened = 0;
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.inherit = 1;  // Count the parallel sorts' pool threads too
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        c->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (c->fd[i] < 0) lastError = errno;
+        else opened++;
+    }
+    if (lastError) {
+        fprintf(stderr, "Note: %s hardware counters are unavailable (perf_event_open: %s)\n",
+                opened ? "some" : "the", strerror(lastError));
+    }
+#else
+    fprintf(stderr, "Note: hardware counters need Linux perf events\n");
+#endif
+}
+
+static void countersClose(Counters *c) {
+#ifdef __linux__
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (c->fd[i] >= 0) close(c->fd[i]);
+    }
+#else
+    (void)c;
+#endif
+}
+
+static void countersStart(Counters *c) {
+#ifdef __linux__
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (c->fd[i] < 0) continue;
+        ioctl(c->fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(c->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)c;
+#endif
+}
+
+// Stores each counter's count since countersStart, or -1
+static void countersStop(Counters *c, long long values[COUNTER_COUNT]) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        values[i] = -1;
+#ifdef __linux__
+        long long count;
+        if (c->fd[i] < 0) continue;
+        ioctl(c->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(c->fd[i], &count, sizeof(count)) == (ssize_t)sizeof(count)) values[i] = count;
+#else
+        (void)c;
+#endif
+    }
+}
+
+/* ---------------------------
+   Measurements
+   --------------------------- */
+
+// The sink a run traces into; the first mode is the baseline the others'
+// cost per step is measured against
+typedef enum { MODE_UNTRACED, MODE_COUNTING, MODE_MEMORY, MODE_STREAM, MODE_COUNT } Mode;
+
+static const char *const modeNames[MODE_COUNT] = { "untraced", "counting", "memory", "stream" };
+
+typedef struct {
+    const char *algorithm;
+    const char *distribution;
+    const char *mode;
+    int n;
+    int repeats;
+    int status;              // 0, -1 if the algorithm failed, 1 if skipped
+    double nsMedian;         // Per run
+    double nsMin;
+    long long steps;         // Counted by a traced run, -1 if none was
+    long long compares;
+    long long swaps;
+    double slowdown;         // Median over the untraced median, 0 if unknown
+    double nsPerStep;        // Tracing cost per step, valid when slowdown is
+    long long counters[COUNTER_COUNT];  // Medians per run, -1 if unavailable
+} Result;
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int compareLongs(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    int sizes[MAX_LIST];
+    int sizeCount;
+    SymbolId dists[MAX_LIST];
+    int distCount;
+    int selected[ALGORITHM_COUNT];
+    int modes[MODE_COUNT];
+    int repeats;
+    int warmup;
+    int seed;
+    double maxSeconds;
+    long long maxMemory;     // Bytes an in-memory trace may take
+    int counters;
+    const char *csvPath;
+    const char *jsonPath;
+} BenchOptions;
+
+// Runs `alg` warmup + repeats times on fresh copies of `input`
+static int measure(const BenchAlgorithm *alg, const int *input, int n, Mode mode,
+                   const BenchOptions *opts, Counters *counters, Result *result) {
+    int *arr = (int *)malloc((size_t)n * sizeof(int) + 1);
+    double *times = (double *)malloc(sizeof(double) * (size_t)opts->repeats);
+    long long *samples = (long long *)malloc(sizeof(long long) * (size_t)opts->repeats * COUNTER_COUNT);
+    if (!arr || !times || !samples) {
+        free(arr);
+        free(times);
+        free(samples);
+        return -1;
+    }
+    // Formatting is what a stream costs; the disk is left out of it
+    FILE *nullFile = mode == MODE_STREAM ? fopen(NULL_DEVICE, "w") : NULL;
+    int status = mode == MODE_STREAM && !nullFile ? -1 : 0;
+    for (int run = 0; run < opts->warmup + opts->repeats && status == 0; run++) {
+        CountingSink counting;
+        IRContext ir;
+        IRSink irSink;
+        StreamSink stream;
+        TraceSink *sink = NULL;
+        if (mode == MODE_COUNTING) {
+            counting_sink_init(&counting);
+            sink = &counting.base;
+        } else if (mode == MODE_MEMORY) {
+            initIR(&ir);
+            ir_sink_init(&irSink, &ir);
+            sink = &irSink.base;
+        } else if (mode == MODE_STREAM) {
+            stream_sink_init(&stream, nullFile);
+            sink = &stream.base;
+        }
+        memcpy(arr, input, (size_t)n * sizeof(int));
+        long long values[COUNTER_COUNT];
+        countersStart(counters);
+        double start = clockNs();
+        status = runAlgorithm(alg, arr, n, sink);
+        if (mode == MODE_STREAM) fflush(nullFile);
+        double elapsed = clockNs() - start;
+        countersStop(counters, values);
+        if (mode == MODE_MEMORY) resetIR(&ir);
+        if (run < opts->warmup) continue;
+        int k = run - opts->warmup;
+        times[k] = elapsed;
+        for (int i = 0; i < COUNTER_COUNT; i++) samples[i * opts->repeats + k] = values[i];
+        if (mode == MODE_COUNTING) {
+            result->steps = counting.steps;
+            result->compares = counting.compares;
+            result->swaps = counting.swaps;
+        }
+    }
+    if (status == 0) {
+        qsort(times, (size_t)opts->repeats, sizeof(double), compareDoubles);
+        result->nsMin = times[0];
+        result->nsMedian = times[opts->repeats / 2];
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            long long *counts = samples + i * opts->repeats;
+            qsort(counts, (size_t)opts->repeats, sizeof(long long), compareLongs);
+            result->counters[i] = counts[0] < 0 ? -1 : counts[opts->repeats / 2];
+        }
+    }
+    if (nullFile) fclose(nullFile);
+    free(arr);
+    free(times);
+    free(samples);
+    return status;
+}
+
+// Fills in a result's counts with an untimed counting run
+static void countSteps(const BenchAlgorithm *alg, const int *input, int n, Result *result) {
+    int *arr = (int *)malloc((size_t)n * sizeof(int) + 1);
+    CountingSink counting;
+    if (!arr) return;
+    counting_sink_init(&counting);
+    memcpy(arr, input, (size_t)n * sizeof(int));
+    if (runAlgorithm(alg, arr, n, &counting.base) == 0) {
+        result->steps = counting.steps;
+        result->compares = counting.compares;
+        result->swaps = counting.swaps;
+    }
+    free(arr);
+}
+
+// Takes the counts of the counting run when it succeeded, else counts
+static void findCounts(const BenchAlgorithm *alg, const int *input, int n, const Result *counting,
+                       Result *counts) {
+    if (counting && counting->status == 0) {
+        counts->steps = counting->steps;
+        counts->compares = counting->compares;
+        counts->swaps = counting->swaps;
+    } else {
+        countSteps(alg, input, n, counts);
+    }
+}
+
+/* ---------------------------
+   Output
+   --------------------------- */
+
+static void printPerElement(long long value, int n) {
+    if (value < 0) printf(" %10s", "-");
+    else printf(" %10.2f", (double)value / n);
+}
+
+static void printHeader(void) {
+    printf("%-22s %-13s %9s %-8s %10s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "algorithm", "input", "n",
+           "mode", "ns/elem", "x untraced", "ns/step", "steps/elem", "cmp/elem", "swap/elem", "cyc/elem",
+           "ins/elem", "cmiss/elem", "bmiss/elem");
+}
+
+static void printResult(const Result *r) {
+    printf("%-22s %-13s %9d %-8s", r->algorithm, r->distribution, r->n, r->mode);
+    if (r->status != 0) {
+        printf(" %10s\n", r->status > 0 ? "skipped" : "failed");
+        return;
+    }
+    printf(" %10.2f", r->nsMedian / r->n);
+    if (r->slowdown > 0) printf(" %10.2f %10.2f", r->slowdown, r->nsPerStep);
+    else printf(" %10s %10s", "-", "-");
+    printPerElement(r->steps, r->n);
+    printPerElement(r->compares, r->n);
+    printPerElement(r->swaps, r->n);
+    for (int i = 0; i < COUNTER_COUNT; i++) printPerElement(r->counters[i], r->n);
+    printf("\n");
+    fflush(stdout);
+}
+
+static const char *statusName(const Result *r) {
+    return r->status == 0 ? "ok" : r->status > 0 ? "skipped" : "failed";
+}
+
+// Writes ",value", or just "," when the value is missing (-1)
+static void csvValue(FILE *fp, long long value) {
+    if (value < 0) fprintf(fp, ",");
+    else fprintf(fp, ",%lld", value);
+}
+
+static void jsonValue(FILE *fp, const char *name, long long value) {
+    if (value < 0) fprintf(fp, ", \"%s\": null", name);
+    else fprintf(fp, ", \"%s\": %lld", name, value);
+}
+
+static int writeCsv(const char *path, const Result *results, int count) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    fprintf(fp, "algorithm,distribution,n,mode,status,repeats,ns_median,ns_min,ns_per_element,slowdown,ns_per_step,"
+            "steps,compares,swaps");
+    for (int i = 0; i < COUNTER_COUNT; i++) fprintf(fp, ",%s", counterNames[i]);
+    fprintf(fp, "\n");
+    for (int k = 0; k < count; k++) {
+        const Result *r = &results[k];
+        fprintf(fp, "%s,%s,%d,%s,%s,%d", r->algorithm, r->distribution, r->n, r->mode, statusName(r), r->repeats);
+        if (r->status != 0) {
+            fprintf(fp, ",,,,,,,,");
+            for (int i = 0; i < COUNTER_COUNT; i++) fprintf(fp, ",");
+            fprintf(fp, "\n");
+            continue;
+        }
+        fprintf(fp, ",%.0f,%.0f,%.3f", r->nsMedian, r->nsMin, r->nsMedian / r->n);
+        if (r->slowdown > 0) fprintf(fp, ",%.3f,%.3f", r->slowdown, r->nsPerStep);
+        else fprintf(fp, ",,");
+        csvValue(fp, r->steps);
+        csvValue(fp, r->compares);
+        csvValue(fp, r->swaps);
+        for (int i = 0; i < COUNTER_COUNT; i++) csvValue(fp, r->counters[i]);
+        fprintf(fp, "\n");
+    }
+    return fclose(fp);
+}
+
+static int writeJson(const char *path, const BenchOptions *opts, const Result *results, int count) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    fprintf(fp, "{\n  \"repeats\": %d,\n  \"warmup\": %d,\n  \"seed\": %d,\n  \"results\": [", opts->repeats,
+            opts->warmup, opts->seed);
+    for (int k = 0; k < count; k++) {
+        const Result *r = &results[k];
+        fprintf(fp, "%s\n    {\"algorithm\": \"%s\", \"distribution\": \"%s\", \"n\": %d, \"mode\": \"%s\", "
+                "\"status\": \"%s\"", k ? "," : "", r->algorithm, r->distribution, r->n, r->mode, statusName(r));
+        if (r->status == 0) {
+            fprintf(fp, ", \"ns_median\": %.0f, \"ns_min\": %.0f, \"ns_per_element\": %.3f", r->nsMedian,
+                    r->nsMin, r->nsMedian / r->n);
+            if (r->slowdown > 0) {
+                fprintf(fp, ", \"slowdown\": %.3f, \"ns_per_step\": %.3f", r->slowdown, r->nsPerStep);
+            } else {
+                fprintf(fp, ", \"slowdown\": null, \"ns_per_step\": null");
+            }
+            jsonValue(fp, "steps", r->steps);
+            jsonValue(fp, "compares", r->compares);
+            jsonValue(fp, "swaps", r->swaps);
+            for (int i = 0; i < COUNTER_COUNT; i++) jsonValue(fp, counterNames[i], r->counters[i]);
+        }
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    return fclose(fp);
+}
+
+/* ---------------------------
+   Command line
+   --------------------------- */
+
+static void printUsage(const char *progName) {
+    printf("Usage: %s [OPTIONS]\n\n", progName);
+    printf("Times every engine algorithm on generated arrays, untraced and traced into each\n");
+    printf("kind of sink, and what tracing costs per emitted step.\n\n");
+    printf("Options:\n");
+    printf("  -h, --help            Show this help message\n");
+    printf("  -a, --algorithms A,.. Algorithms to run, e.g. merge_sort,quick_sort/pdq (default: all;\n");
+    printf("                        quick_sort alone means every strategy)\n");
+    printf("  -n, --sizes N,..      Array sizes, ascending (default: 1000,100000,1000000; 1e6 works)\n");
+    printf("  -i, --inputs D,..     random, sorted, reversed, nearly_sorted, few_unique, organ_pipe\n");
+    printf("                        (default: random)\n");
+    printf("  -m, --modes M,..      untraced, counting, memory (an IR track), stream (JSON lines to\n");
+    printf("                        %s) (default: all)\n", NULL_DEVICE);
+    printf("  -r, --repeats N       Timed runs per measurement, median reported (default: %d)\n", DEFAULT_REPEATS);
+    printf("  -w, --warmup N        Untimed runs before them (default: %d)\n", DEFAULT_WARMUP);
+    printf("  -s, --seed N          Seed of the generated arrays (default: 1)\n");
+    printf("  --max-seconds S       Skip a size when the last one, scaled as n^2, predicts a run\n");
+    printf("                        longer than S seconds (default: %.0f)\n", DEFAULT_MAX_SECONDS);
+    printf("  --max-memory MB       Skip memory runs whose trace would take more (default: %d)\n",
+           DEFAULT_MAX_MEMORY_MB);
+    printf("  --no-counters         Do not read hardware counters\n");
+    printf("  --csv FILE            Also write the results as CSV\n");
+    printf("  --json FILE           Also write the results as JSON\n");
+    printf("\nExamples:\n");
+    printf("  %s -a merge_sort,bitonic_sort -n 1e7 -m untraced\n", progName);
+    printf("  %s -a quick_sort/pdq,stack -n 1e5 -m untraced,counting,memory\n", progName);
+    printf("  %s -i random,sorted,few_unique --csv bench.csv\n", progName);
+}
+
+// Splits a comma-separated list into `items` (the list is modified)
+static int splitList(char *list, char *items[], int max) {
+    int count = 0;
+    for (char *item = strtok(list, ","); item; item = strtok(NULL, ",")) {
+        if (count == max) return -1;
+        items[count++] = item;
+    }
+    return count;
+}
+
+static int parseOptions(int argc, char **argv, BenchOptions *opts) {
+    char *items[MAX_LIST];
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        int hasValue = i + 1 < argc;
+        if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            printUsage(argv[0]);
+            exit(0);
+        } else if (strcmp(arg, "--no-counters") == 0) {
+            opts->counters = 0;
+            continue;
+        } else if (!hasValue) {
+            fprintf(stderr, "Error: %s requires a value (see --help)\n", arg);
+            return -1;
+        }
+        char *value = argv[++i];
+        if (strcmp(arg, "-a") == 0 || strcmp(arg, "--algorithms") == 0) {
+            int count = splitList(value, items, MAX_LIST);
+            memset(opts->selected, 0, sizeof(opts->selected));
+            for (int k = 0; k < count; k++) {
+                int found = 0;
+                for (int a = 0; a < ALGORITHM_COUNT; a++) {
+                    if (algorithmMatches(&algorithms[a], items[k])) opts->selected[a] = found = 1;
+                }
+                if (!found) {
+                    fprintf(stderr, "Error: Unknown algorithm: %s\n", items[k]);
+                    return -1;
+                }
+            }
+        } else if (strcmp(arg, "-n") == 0 || strcmp(arg, "--sizes") == 0) {
+            opts->sizeCount = splitList(value, items, MAX_LIST);
+            for (int k = 0; k < opts->sizeCount; k++) {
+                double size = atof(items[k]);
+                if (size < 1 || size > GENERATOR_MAX_ELEMENTS) {
+                    fprintf(stderr, "Error: Size must be between 1 and %d: %s\n", GENERATOR_MAX_ELEMENTS, items[k]);
+                    return -1;
+                }
+                opts->sizes[k] = (int)size;
+            }
+        } else if (strcmp(arg, "-i") == 0 || strcmp(arg, "--inputs") == 0) {
+            opts->distCount = splitList(value, items, MAX_LIST);
+            for (int k = 0; k < opts->distCount; k++) {
+                int found = 0;
+                for (int d = 0; d < DISTRIBUTION_COUNT && !found; d++) {
+                    if (strcmp(items[k], builtinName(distributions[d])) == 0) {
+                        opts->dists[k] = distributions[d];
+                        found = 1;
+                    }
+                }
+                if (!found) {
+                    fprintf(stderr, "Error: Unknown input: %s\n", items[k]);
+                    return -1;
+                }
+            }
+        } else if (strcmp(arg, "-m") == 0 || strcmp(arg, "--modes") == 0) {
+            int count = splitList(value, items, MAX_LIST);
+            memset(opts->modes, 0, sizeof(opts->modes));
+            for (int k = 0; k < count; k++) {
+                int found = 0;
+                for (int m = 0; m < MODE_COUNT; m++) {
+                    if (strcmp(items[k], modeNames[m]) == 0) opts->modes[m] = found = 1;
+                }
+                if (!found) {
+                    fprintf(stderr, "Error: Unknown mode: %s\n", items[k]);
+                    return -1;
+                }
+            }
+        } else if (strcmp(arg, "-r") == 0 || strcmp(arg, "--repeats") == 0) {
+            opts->repeats = atoi(value);
+        } else if (strcmp(arg, "-w") == 0 || strcmp(arg, "--warmup") == 0) {
+            opts->warmup = atoi(value);
+        } else if (strcmp(arg, "-s") == 0 || strcmp(arg, "--seed") == 0) {
+            opts->seed = atoi(value);
+        } else if (strcmp(arg, "--max-seconds") == 0) {
+            opts->maxSeconds = atof(value);
+        } else if (strcmp(arg, "--max-memory") == 0) {
+            opts->maxMemory = (long long)(atof(value) * 1024 * 1024);
+        } else if (strcmp(arg, "--csv") == 0) {
+            opts->csvPath = value;
+        } else if (strcmp(arg, "--json") == 0) {
+            opts->jsonPath = value;
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", arg);
+            return -1;
+        }
+    }
+    if (opts->sizeCount <= 0 || opts->distCount <= 0) {
+        fprintf(stderr, "Error: Give 1 to %d sizes and inputs\n", MAX_LIST);
+        return -1;
+    }
+    if (opts->repeats < 1 || opts->warmup < 0) {
+        fprintf(stderr, "Error: Need at least one repeat and no negative warmup\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opts = {
+        { 1000, 100000, 1000000 }, 3, { SYM_RANDOM }, 1, { 0 }, { 1, 1, 1, 1 },
+        DEFAULT_REPEATS, DEFAULT_WARMUP, 1, DEFAULT_MAX_SECONDS, (long long)DEFAULT_MAX_MEMORY_MB * 1024 * 1024,
+        1, NULL, NULL
+    };
+    for (int a = 0; a < ALGORITHM_COUNT; a++) opts.selected[a] = 1;
+    if (parseOptions(argc, argv, &opts) != 0) return 1;
+
+    int capacity = ALGORITHM_COUNT * opts.distCount * opts.sizeCount * MODE_COUNT;
+    Result *results = (Result *)calloc((size_t)capacity, sizeof(Result));
+    if (!results) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+    int count = 0;
+    int failed = 0;
+    Counters counters;
+    countersOpen(&counters, opts.counters);
+    printHeader();
+
+    for (int d = 0; d < opts.distCount; d++) {
+        const char *distName = builtinName(opts.dists[d]);
+        for (int a = 0; a < ALGORITHM_COUNT; a++) {
+            if (!opts.selected[a]) continue;
+            const BenchAlgorithm *alg = &algorithms[a];
+            // Median seconds of the last size measured, per mode
+            double lastSeconds[MODE_COUNT] = { 0 };
+            int lastSize[MODE_COUNT] = { 0 };
+            for (int s = 0; s < opts.sizeCount; s++) {
+                int n = opts.sizes[s];
+                int *input = makeInput(opts.dists[d], n, opts.seed);
+                if (!input) return 1;
+                Result *rows[MODE_COUNT] = { NULL };
+                // What every run of this size counts, from the counting run
+                // or, when there is none, an untimed one
+                Result counts;
+                counts.steps = counts.compares = counts.swaps = -1;
+                for (int m = 0; m < MODE_COUNT; m++) {
+                    if (!opts.modes[m]) continue;
+                    Result *r = rows[m] = &results[count++];
+                    r->algorithm = alg->name;
+                    r->distribution = distName;
+                    r->mode = modeNames[m];
+                    r->n = n;
+                    r->repeats = opts.repeats;
+                    r->steps = r->compares = r->swaps = -1;
+                    // Quadratic growth is the worst any of them has, so a
+                    // size past the budget by that estimate is not run
+                    double scale = lastSize[m] ? (double)n / lastSize[m] : 0;
+                    int skip = lastSeconds[m] < 0 || lastSeconds[m] * scale * scale > opts.maxSeconds;
+                    if (!skip && m == MODE_MEMORY) {
+                        if (counts.steps < 0) findCounts(alg, input, n, rows[MODE_COUNTING], &counts);
+                        skip = counts.steps < 0 || counts.steps > opts.maxMemory / (long long)sizeof(IRNode);
+                    }
+                    if (skip) {
+                        r->status = 1;
+                        lastSeconds[m] = -1;
+                    } else {
+                        r->status = measure(alg, input, n, (Mode)m, &opts, &counters, r);
+                        lastSeconds[m] = r->status == 0 ? r->nsMedian / 1e9 : -1;
+                        lastSize[m] = n;
+                        failed |= r->status < 0;
+                    }
+                }
+                // Every mode does the same work, so each is given the same
+                // counts, and the traced ones their cost over the untraced run
+                Result *untraced = rows[MODE_UNTRACED];
+                for (int m = 0; m < MODE_COUNT; m++) {
+                    Result *r = rows[m];
+                    if (!r || r->status != 0) continue;
+                    if (counts.steps < 0) findCounts(alg, input, n, rows[MODE_COUNTING], &counts);
+                    r->steps = counts.steps;
+                    r->compares = counts.compares;
+                    r->swaps = counts.swaps;
+                    if (m != MODE_UNTRACED && untraced && untraced->status == 0 && r->steps > 0) {
+                        r->slowdown = r->nsMedian / untraced->nsMedian;
+                        r->nsPerStep = (r->nsMedian - untraced->nsMedian) / (double)r->steps;
+                    }
+                }
+                for (int m = 0; m < MODE_COUNT; m++) {
+                    if (rows[m]) printResult(rows[m]);
+                }
+                free(input);
+            }
+        }
+    }
+    countersClose(&counters);
+
+    if (opts.csvPath && writeCsv(opts.csvPath, results, count) != 0) {
+        fprintf(stderr, "Error: Cannot write %s\n", opts.csvPath);
+        failed = 1;
+    }
+    if (opts.jsonPath && writeJson(opts.jsonPath, &opts, results, count) != 0) {
+        fprintf(stderr, "Error: Cannot write %s\n", opts.jsonPath);
+        failed = 1;
+    }
+    free(results);
+    return failed;
+}
@@ -1,8 +1,14 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <signal.h>
+#include <stdatomic.h>
+#include "traceevents.h"
 
 #ifdef _WIN32
     #include <windows.h>
@@ -12,6 +18,9 @@
 #else
     #include <unistd.h>
     #include <termios.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <time.h>
     #define CLEAR_SCREEN() system("clear")
     #define GETCHAR() getchar()
 #endif
@@ -19,11 +28,50 @@
 // Global flag for clean exit
 static volatile int should_exit = 0;
 
+// Playback timing (milliseconds)
+#define INPUT_POLL_MS      10    // Granularity of input checks while waiting for a frame
+#define DEFAULT_DELAY_MS   800
+#define MIN_DELAY_MS       INPUT_POLL_MS
+#define MAX_DELAY_MS       5000
+
+// Commands produced by the input thread and consumed by the render loop
+typedef enum {
+    CMD_NONE = 0,
+    CMD_STEP,
+    CMD_TOGGLE_PAUSE,
+    CMD_FASTER,
+    CMD_SLOWER,
+    CMD_QUIT
+} PlaybackCommand;
+
+typedef struct {
+    int paused;     // 1 = advance only on key press, 0 = autoplay
+    int delay_ms;   // Delay between frames while autoplaying
+} PlaybackState;
+
+// Lock-free single-producer/single-consumer ring buffer.
+// The input thread is the only writer of command_tail, the render loop the
+// only writer of command_head; indices grow monotonically and wrap by mask.
+#define COMMAND_QUEUE_SIZE 64
+static int command_queue[COMMAND_QUEUE_SIZE];
+static atomic_uint command_head = 0;
+static atomic_uint command_tail = 0;
+static atomic_int input_running = 0;
+static atomic_int input_closed = 0;  // stdin reached EOF (e.g. redirected input)
+
 // Algorithm state tracking
 static int current_pass = 0;
 static int current_comparison = 0;
 static int total_swaps = 0;
 static int total_comparisons = 0;
+static int run_first = -1;  // Run being sorted, from the last run step
+static int run_last = -1;
+static int merge_second = -1;  // Start of the second run in a merge, or -1
+#define MAX_LANES 16
+#define LANES_PER_ROW 8
+static char lane_last[MAX_LANES][16];  // Each parallel lane's latest step
+static int lane_count = 0;             // Lanes seen so far
+static int split_lane = -1;            // Lane of the last split step
 
 // Data structure operation tracking
 static int stack_pushes = 0;
@@ -58,6 +106,212 @@ void signal_handler(int sig) {
 }
 #endif
 
+// Command queue: producer side (input thread only)
+static void pushCommand(int cmd) {
+    unsigned tail = atomic_load_explicit(&command_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&command_head, memory_order_acquire);
+    if (tail - head >= COMMAND_QUEUE_SIZE) {
+        return;  // Queue full: drop the key press rather than block input
+    }
+    command_queue[tail % COMMAND_QUEUE_SIZE] = cmd;
+    atomic_store_explicit(&command_tail, tail + 1, memory_order_release);
+}
+
+// Command queue: consumer side (render loop only)
+static int popCommand(void) {
+    unsigned head = atomic_load_explicit(&command_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&command_tail, memory_order_acquire);
+    if (head == tail) {
+        return CMD_NONE;
+    }
+    int cmd = command_queue[head % COMMAND_QUEUE_SIZE];
+    atomic_store_explicit(&command_head, head + 1, memory_order_release);
+    return cmd;
+}
+
+static int keyToCommand(int ch) {
+    switch (ch) {
+        case ' ':
+            return CMD_TOGGLE_PAUSE;
+        case '+': case '=': case 'f': case 'F':
+            return CMD_FASTER;
+        case '-': case '_': case 's': case 'S':
+            return CMD_SLOWER;
+        case 'q': case 'Q': case 27: case 3:  // ESC or Ctrl+C
+            return CMD_QUIT;
+        default:
+            return CMD_STEP;
+    }
+}
+
+static void sleepMs(int ms) {
+    #ifdef _WIN32
+    Sleep((DWORD)ms);
+    #else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+    #endif
+}
+
+static long long nowMs(void) {
+    #ifdef _WIN32
+    return (long long)GetTickCount64();
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000L;
+    #endif
+}
+
+// Input thread: reads raw key presses and feeds the command queue so the
+// render loop never blocks on the keyboard.
+#ifdef _WIN32
+static HANDLE input_thread;
+
+static DWORD WINAPI inputThreadMain(LPVOID arg) {
+    (void)arg;
+    while (atomic_load(&input_running)) {
+        if (!_kbhit()) {
+            Sleep(INPUT_POLL_MS);
+            continue;
+        }
+        int ch = _getch();
+        if (ch == 0 || ch == 0xE0) {
+            _getch();  // Extended key (arrows, F-keys): consume and treat as step
+            pushCommand(CMD_STEP);
+            continue;
+        }
+        pushCommand(keyToCommand(ch));
+    }
+    return 0;
+}
+
+static void startInputThread(void) {
+    atomic_store(&input_running, 1);
+    input_thread = CreateThread(NULL, 0, inputThreadMain, NULL, 0, NULL);
+    if (!input_thread) {
+        atomic_store(&input_running, 0);
+        atomic_store(&input_closed, 1);
+    }
+}
+
+static void stopInputThread(void) {
+    if (!atomic_exchange(&input_running, 0)) return;
+    WaitForSingleObject(input_thread, INFINITE);
+    CloseHandle(input_thread);
+}
+#else
+static pthread_t input_thread;
+static struct termios saved_termios;
+static int termios_saved = 0;
+
+static void enableRawMode(void) {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_termios) != 0) {
+        return;
+    }
+    struct termios raw = saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);  // Keep ISIG so Ctrl+C still raises SIGINT
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0) {
+        termios_saved = 1;
+    }
+}
+
+static void restoreTerminal(void) {
+    if (termios_saved) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+        termios_saved = 0;
+    }
+}
+
+static void *inputThreadMain(void *arg) {
+    (void)arg;
+    while (atomic_load(&input_running)) {
+        struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+        if (poll(&pfd, 1, INPUT_POLL_MS) <= 0) {
+            continue;  // Timeout or EINTR: re-check the running flag
+        }
+        unsigned char buf[16];
+        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+        if (n <= 0) {
+            atomic_store(&input_closed, 1);
+            break;
+        }
+        if (buf[0] == 27 && n > 1) {
+            pushCommand(CMD_STEP);  // Escape sequence (arrow key), not a lone ESC
+            continue;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (!termios_saved && buf[i] == '\n' && i > 0) continue;  // Line-buffered input
+            pushCommand(keyToCommand(buf[i]));
+        }
+    }
+    return NULL;
+}
+
+static void startInputThread(void) {
+    enableRawMode();
+    atomic_store(&input_running, 1);
+    if (pthread_create(&input_thread, NULL, inputThreadMain, NULL) != 0) {
+        atomic_store(&input_running, 0);
+        atomic_store(&input_closed, 1);
+        restoreTerminal();
+    }
+}
+
+static void stopInputThread(void) {
+    if (!atomic_exchange(&input_running, 0)) return;
+    pthread_join(input_thread, NULL);
+    restoreTerminal();
+}
+#endif
+
+// Block until the next frame is due, draining input every INPUT_POLL_MS so
+// pause/speed/quit take effect within one poll interval at any speed.
+static void waitForNextFrame(PlaybackState *pb) {
+    long long start = nowMs();
+    for (;;) {
+        if (should_exit) return;
+
+        int cmd;
+        while ((cmd = popCommand()) != CMD_NONE) {
+            switch (cmd) {
+                case CMD_QUIT:
+                    should_exit = 1;
+                    return;
+                case CMD_STEP:
+                    return;
+                case CMD_TOGGLE_PAUSE:
+                    pb->paused = !pb->paused;
+                    if (!pb->paused) return;  // Resuming shows the next frame immediately
+                    printf("\r  [Paused]                              ");
+                    fflush(stdout);
+                    break;
+                case CMD_FASTER:
+                    pb->delay_ms = pb->delay_ms / 2 < MIN_DELAY_MS ? MIN_DELAY_MS : pb->delay_ms / 2;
+                    printf("\r  [Speed] %d ms per step                ", pb->delay_ms);
+                    fflush(stdout);
+                    break;
+                case CMD_SLOWER:
+                    pb->delay_ms = pb->delay_ms * 2 > MAX_DELAY_MS ? MAX_DELAY_MS : pb->delay_ms * 2;
+                    printf("\r  [Speed] %d ms per step                ", pb->delay_ms);
+                    fflush(stdout);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (atomic_load(&input_closed) && pb->paused) return;  // No keyboard: don't hang
+        if (!pb->paused && nowMs() - start >= pb->delay_ms) return;
+
+        sleepMs(INPUT_POLL_MS);
+    }
+}
+
 // ANSI color codes (Windows 10+ supports these)
 #define RESET   "\033[0m"
 #define RED     "\033[31m"
@@ -72,6 +326,7 @@ typedef struct Step {
     char action[32];
     int indices[4];
     int index_count;
+    int lane;        // Worker lane of a parallel sort, -1 if none
     struct Step *next;
 } Step;
 
@@ -80,6 +335,9 @@ typedef struct {
     int array[256];
     int array_size;
     Step *steps;
+    int track_count;  // Tracks in the file (one per algorithm call / structure)
+    char time_complexity[64];   // From the track's metadata ("" if absent)
+    char space_complexity[64];
 } JSONData;
 
 // Helper function to extract string from JSON line
@@ -177,8 +435,24 @@ static int extractIndices(const char *line, int *indices, int *count) {
     return 0;
 }
 
-// JSON parser (improved version based on json_to_js.c)
-static JSONData *parseJSON(const char *filename) {
+// Helper function to extract an integer member; leaves *value alone if absent
+static int extractInt(const char *line, const char *key, int *value) {
+    char search_str[64];
+    snprintf(search_str, sizeof(search_str), "\"%s\"", key);
+    char *pos = strstr(line, search_str);
+    if (!pos) return 0;
+    pos = strchr(pos + strlen(search_str), ':');
+    if (!pos) return 0;
+    char *end;
+    long v = strtol(pos + 1, &end, 10);
+    if (end == pos + 1) return 0;
+    *value = (int)v;
+    return 1;
+}
+
+// JSON parser (improved version based on json_to_js.c). Track 0 is the
+// top-level object; track N is the Nth entry of "tracks".
+static JSONData *parseJSON(const char *filename, int track) {
     FILE *fp = fopen(filename, "r");
     if (!fp) return NULL;
     
@@ -200,19 +474,42 @@ static JSONData *parseJSON(const char *filename) {
     buffer[file_size] = '\0';
     fclose(fp);
     
+    // Every track object starts with its "algorithm" member
+    char *start = buffer;
+    data->track_count = 1;
+    char *tracks = strstr(buffer, "\"tracks\"");
+    for (char *p = tracks; p && (p = strstr(p + 1, "\"algorithm\"")) != NULL; ) {
+        if (data->track_count++ == track) start = p;
+    }
+    if (track < 0 || track >= data->track_count) {
+        fprintf(stderr, "Error: %s has no track %d (tracks: 0..%d)\n", filename, track, data->track_count - 1);
+        free(buffer);
+        free(data);
+        return NULL;
+    }
+    
     // Extract algorithm name
     char alg_name[64];
-    if (extractString(buffer, "algorithm", alg_name, sizeof(alg_name))) {
+    if (extractString(start, "algorithm", alg_name, sizeof(alg_name))) {
         strncpy(data->algorithm, alg_name, sizeof(data->algorithm) - 1);
     }
     
+    // Extract complexities; a track's metadata follows its steps and comes
+    // before any later track
+    char *metadata = strstr(start, "\"metadata\"");
+    if (metadata) {
+        extractString(metadata, "timeComplexity", data->time_complexity, sizeof(data->time_complexity));
+        extractString(metadata, "spaceComplexity", data->space_complexity, sizeof(data->space_complexity));
+    }
+    
     // Extract array
-    if (strstr(buffer, "\"array\"")) {
-        extractArray(buffer, data->array, 256, &data->array_size);
+    char *array_key = strstr(start, "\"array\"");
+    if (array_key) {
+        extractArray(array_key, data->array, 256, &data->array_size);
     }
     
     // Extract steps
-    char *steps_start = strstr(buffer, "\"steps\"");
+    char *steps_start = strstr(start, "\"steps\"");
     if (steps_start) {
         steps_start = strchr(steps_start, '[');
         if (steps_start) {
@@ -223,6 +520,8 @@ static JSONData *parseJSON(const char *filename) {
                 // Find next step object
                 char *obj_start = strchr(steps_start, '{');
                 if (!obj_start) break;
+                char *steps_end = strchr(steps_start, ']');
+                if (steps_end && steps_end < obj_start) break;  // End of this track's steps
                 
                 char *obj_end = strchr(obj_start, '}');
                 if (!obj_end) break;
@@ -243,6 +542,8 @@ static JSONData *parseJSON(const char *filename) {
                         if (!extractIndices(step_obj, step->indices, &step->index_count)) {
                             step->index_count = 0;
                         }
+                        step->lane = -1;
+                        extractInt(step_obj, "lane", &step->lane);
                         
                         step->next = NULL;
                         if (!data->steps) {
@@ -691,22 +992,37 @@ static void printAlgorithmStep(JSONData *data, Step *step, int *working_array) {
         }
     } else if (strncmp(alg, "Merge", 5) == 0) {
         // Merge Sort specific descriptions
-        if (strcmp(step->action, "compare") == 0 && step->index_count >= 2) {
+        if (strcmp(step->action, "run") == 0 && step->index_count >= 2) {
+            run_first = step->indices[0];
+            run_last = step->indices[1];
+            printf("\n[Run] MERGE SORT - Insertion sorting positions %d..%d\n", run_first, run_last);
+            printf("  -> Short runs are cheaper to insertion sort than to merge\n");
+        } else if (strcmp(step->action, "compare") == 0 && step->index_count >= 2) {
             int i = step->indices[0];
             int j = step->indices[1];
             current_comparison++;
-            printf("\n[Step %d] MERGE SORT - Merging two sorted subarrays\n", current_comparison);
-            printf("  -> Left subarray element: %d (position %d)\n", working_array[i], i);
-            printf("  -> Right subarray element: %d (position %d)\n", working_array[j], j);
-            printf("  -> %s\n", working_array[i] <= working_array[j] ? 
-                   "Taking from left subarray" : "Taking from right subarray");
+            if (i >= run_first && j <= run_last) {
+                printf("\n[Step %d] MERGE SORT - Insertion sorting a run\n", current_comparison);
+                printf("  -> Position %d (%d) vs Position %d (%d)\n", i, working_array[i], j, working_array[j]);
+            } else {
+                printf("\n[Step %d] MERGE SORT - Merging two sorted subarrays\n", current_comparison);
+                printf("  -> Left subarray element: %d (position %d)\n", working_array[i], i);
+                printf("  -> Right subarray element: %d (position %d)\n", working_array[j], j);
+                printf("  -> %s\n", working_array[i] <= working_array[j] ? 
+                       "Taking from left subarray" : "Taking from right subarray");
+            }
         } else if (strcmp(step->action, "swap") == 0 && step->index_count >= 2) {
-            printf("\n[Merge Step] MERGE SORT - Merging elements\n");
-            printf("  -> Combining elements from two sorted halves\n");
-        } else if (strcmp(step->action, "mark_sorted") == 0 && step->index_count >= 1) {
-            int idx = step->indices[0];
-            printf("\n[Merge Complete] MERGE SORT\n");
-            printf("  -> Subarray containing position %d is now sorted\n", idx);
+            total_swaps++;
+            printf("\n[Swap #%d] MERGE SORT - Shifting a larger element right\n", total_swaps);
+            printf("  -> Swapped positions %d and %d\n", step->indices[0], step->indices[1]);
+        } else if (strcmp(step->action, "no_swap") == 0 && step->index_count >= 2) {
+            printf("\n[Already Ordered] MERGE SORT\n");
+            printf("  -> %d (position %d) <= %d (position %d): the runs need no merging\n",
+                   working_array[step->indices[0]], step->indices[0],
+                   working_array[step->indices[1]], step->indices[1]);
+        } else if (strcmp(step->action, "scatter") == 0 && step->index_count >= 2) {
+            printf("\n[Write] MERGE SORT - Writing the merged run back\n");
+            printf("  -> Position %d becomes %d\n", step->indices[0], step->indices[1]);
         }
     } else if (strncmp(alg, "Quick", 5) == 0) {
         // Quick Sort specific descriptions
@@ -732,10 +1048,261 @@ static void printAlgorithmStep(JSONData *data, Step *step, int *working_array) {
             printf("  -> Pivot at position %d (%d) is in final position\n", 
                    idx, working_array[idx]);
             printf("  -> Elements left of pivot are smaller, right are larger\n");
+        } else if (strcmp(step->action, "sift_down") == 0 && step->index_count >= 2) {
+            // intro and pdq heap sort a range whose partitions keep going badly
+            printf("\n[Heap Fallback] QUICK SORT - Heap sorting a badly partitioned range\n");
+            printf("  -> Sinking %d from position %d within the heap ending before %d\n",
+                   working_array[step->indices[0]], step->indices[0], step->indices[1]);
+        }
+    } else if (strncmp(alg, "Heap", 4) == 0) {
+        // Heap Sort specific descriptions
+        if (strcmp(step->action, "sift_down") == 0 && step->index_count >= 2) {
+            int root = step->indices[0];
+            printf("\n[Sift Down] HEAP SORT - Restoring the max-heap\n");
+            printf("  -> Sinking %d from position %d within heap [0..%d)\n",
+                   working_array[root], root, step->indices[1]);
+        } else if (strcmp(step->action, "compare") == 0 && step->index_count >= 2) {
+            int i = step->indices[0];
+            int j = step->indices[1];
+            current_comparison++;
+            printf("\n[Step %d] HEAP SORT - %s\n", current_comparison,
+                   j == i + 1 ? "Picking the larger child" : "Comparing parent with larger child");
+            printf("  -> Position %d (%d) vs Position %d (%d)\n", i, working_array[i], j, working_array[j]);
+        } else if (strcmp(step->action, "swap") == 0 && step->index_count >= 2) {
+            int i = step->indices[0];
+            int j = step->indices[1];
+            total_swaps++;
+            int extracting = step->next && strcmp(step->next->action, "mark_sorted") == 0;
+            printf("\n[Swap #%d] HEAP SORT - %s\n", total_swaps,
+                   extracting ? "Moving the maximum to the end" : "Child is larger: moving it up");
+            printf("  -> Swapped positions %d and %d\n", i, j);
+        } else if (strcmp(step->action, "mark_sorted") == 0 && step->index_count >= 1) {
+            current_pass++;
+            int idx = step->indices[0];
+            printf("\n[Extracted %d] HEAP SORT\n", current_pass);
+            printf("  -> Position %d (%d) is in final sorted position\n", idx, working_array[idx]);
+        }
+    } else if (strncmp(alg, "Shell", 5) == 0) {
+        // Shell Sort specific descriptions
+        if (strcmp(step->action, "gap") == 0 && step->index_count >= 1) {
+            current_pass++;
+            printf("\n[Pass %d] SHELL SORT - Gap %d\n", current_pass, step->indices[0]);
+            printf("  -> Insertion sorting elements %d positions apart\n", step->indices[0]);
+        } else if (strcmp(step->action, "compare") == 0 && step->index_count >= 2) {
+            int i = step->indices[0];
+            int j = step->indices[1];
+            current_comparison++;
+            printf("\n[Step %d] SHELL SORT - Comparing elements %d apart\n", current_comparison, j - i);
+            printf("  -> Position %d (%d) vs Position %d (%d)\n", i, working_array[i], j, working_array[j]);
+        } else if (strcmp(step->action, "swap") == 0 && step->index_count >= 2) {
+            total_swaps++;
+            printf("\n[Shift #%d] SHELL SORT - Shifting %d from position %d to %d\n", total_swaps,
+                   working_array[step->indices[1]], step->indices[0], step->indices[1]);
+        }
+    } else if (strncmp(alg, "Radix", 5) == 0) {
+        // Radix Sort specific descriptions
+        if (strcmp(step->action, "histogram") == 0 && step->index_count >= 2) {
+            int i = step->indices[0];
+            if (i == 0) current_pass++;
+            current_comparison++;
+            printf("\n[Pass %d] RADIX SORT - Counting digits\n", current_pass);
+            printf("  -> Position %d (%d) has digit %d\n", i, working_array[i], step->indices[1]);
+        } else if (strcmp(step->action, "scatter") == 0 && step->index_count >= 2) {
+            printf("\n[Pass %d] RADIX SORT - Scattering by digit\n", current_pass);
+            printf("  -> %d goes to position %d\n", step->indices[1], step->indices[0]);
+        }
+    } else if (strncmp(alg, "Tim", 3) == 0) {
+        // Tim Sort specific descriptions
+        if (strcmp(step->action, "run") == 0 && step->index_count >= 2) {
+            current_pass++;
+            merge_second = -1;
+            printf("\n[Run %d] TIM SORT - Positions %d..%d are a sorted run\n", current_pass,
+                   step->indices[0], step->indices[1]);
+            printf("  -> Pushed on the run stack, to be merged with its neighbours\n");
+        } else if (strcmp(step->action, "merge") == 0 && step->index_count >= 3) {
+            merge_second = step->indices[1];
+            printf("\n[Merge] TIM SORT - Merging runs %d..%d and %d..%d\n", step->indices[0],
+                   merge_second - 1, merge_second, step->indices[2]);
+        } else if (strcmp(step->action, "gallop") == 0 && step->index_count >= 2) {
+            int probe = step->indices[0];
+            int key = step->indices[1];
+            current_comparison++;
+            printf("\n[Gallop] TIM SORT - Searching for where %d (position %d) goes\n", working_array[key], key);
+            printf("  -> Probing position %d (%d)\n", probe, working_array[probe]);
+        } else if (strcmp(step->action, "compare") == 0 && step->index_count >= 2) {
+            int i = step->indices[0];
+            int j = step->indices[1];
+            current_comparison++;
+            printf("\n[Step %d] TIM SORT - %s\n", current_comparison,
+                   merge_second >= 0 ? "Merging: first run vs second run" : "Building a run");
+            printf("  -> Position %d (%d) vs Position %d (%d)\n", i, working_array[i], j, working_array[j]);
+        } else if (strcmp(step->action, "swap") == 0 && step->index_count >= 2) {
+            int i = step->indices[0];
+            int j = step->indices[1];
+            total_swaps++;
+            printf("\n[Swap #%d] TIM SORT - %s\n", total_swaps,
+                   j == i + 1 ? "Shifting a larger element right" : "Reversing a descending run");
+            printf("  -> Swapped positions %d and %d\n", i, j);
+        } else if (strcmp(step->action, "scatter") == 0 && step->index_count >= 2) {
+            printf("\n[Write] TIM SORT - Writing the merged runs back\n");
+            printf("  -> Position %d becomes %d\n", step->indices[0], step->indices[1]);
+        }
+    } else if (strncmp(alg, "Bitonic", 7) == 0) {
+        // Bitonic Sort specific descriptions
+        if (strcmp(step->action, "stage") == 0 && step->index_count >= 4) {
+            int first = step->indices[0];
+            int k = step->indices[2];
+            int j = step->indices[3];
+            // Each block's network starts with its first stage
+            if (k == 2 && j == 1) current_pass++;
+            run_last = step->indices[1];
+            printf("\n[Block %d] BITONIC SORT - Network stage on positions %d..%d\n", current_pass,
+                   first, step->indices[1]);
+            if (k > step->indices[1] - first) {
+                printf("  -> Compare-exchanging elements %d apart, merging the block in ascending order\n", j);
+            } else {
+                printf("  -> Compare-exchanging elements %d apart, in sequences of %d that alternate up and down\n",
+                       j, k);
+            }
+        } else if (strcmp(step->action, "compare") == 0 && step->index_count >= 2) {
+            int i = step->indices[0];
+            int j = step->indices[1];
+            current_comparison++;
+            // Only the leftover lies past the last block a network sorted
+            printf("\n[Step %d] BITONIC SORT - %s\n", current_comparison,
+                   i > run_last ? "Insertion sorting the leftover" : "Merging two sorted runs");
+            printf("  -> Position %d (%d) vs Position %d (%d)\n", i, working_array[i], j, working_array[j]);
+        } else if (strcmp(step->action, "swap") == 0 && step->index_count >= 2) {
+            total_swaps++;
+            printf("\n[Swap #%d] BITONIC SORT - Shifting a larger element right\n", total_swaps);
+            printf("  -> Swapped positions %d and %d\n", step->indices[0], step->indices[1]);
+        } else if (strcmp(step->action, "no_swap") == 0 && step->index_count >= 2) {
+            printf("\n[Already Ordered] BITONIC SORT\n");
+            printf("  -> %d (position %d) <= %d (position %d): the runs need no merging\n",
+                   working_array[step->indices[0]], step->indices[0],
+                   working_array[step->indices[1]], step->indices[1]);
+        } else if (strcmp(step->action, "scatter") == 0 && step->index_count >= 2) {
+            printf("\n[Write] BITONIC SORT - Writing the merged run back\n");
+            printf("  -> Position %d becomes %d\n", step->indices[0], step->indices[1]);
+        }
+    } else if (strncmp(alg, "Parallel", 8) == 0 || strncmp(alg, "Sample", 6) == 0 ||
+               strncmp(alg, "Odd-Even", 8) == 0) {
+        // Parallel sorts: every step comes from one lane
+        const char *name = alg[0] == 'P' ? "PARALLEL MERGE SORT" : alg[0] == 'S' ? "SAMPLE SORT" : "ODD-EVEN SORT";
+        int lane = step->lane;
+        if (strcmp(step->action, "run") == 0 && step->index_count >= 2) {
+            printf("\n[Run] %s - Lane %d insertion sorts positions %d..%d\n", name, lane,
+                   step->indices[0], step->indices[1]);
+        } else if (strcmp(step->action, "split") == 0 && step->index_count >= 2) {
+            // Lanes take their turns in order, so a new phase starts
+            // when the lanes wrap around
+            if (split_lane < 0 || lane <= split_lane) current_pass++;
+            split_lane = lane;
+            printf("\n[Split] %s - Lane %d merges into positions %d..%d\n", name, lane,
+                   step->indices[0], step->indices[1]);
+            printf("  -> Each lane takes an equal share of the merged output\n");
+        } else if (strcmp(step->action, "compare") == 0 && step->index_count >= 2) {
+            int i = step->indices[0];
+            int j = step->indices[1];
+            current_comparison++;
+            printf("\n[Step %d] %s - Lane %d\n", current_comparison, name, lane);
+            printf("  -> Position %d (%d) vs Position %d (%d)\n", i, working_array[i], j, working_array[j]);
+        } else if (strcmp(step->action, "swap") == 0 && step->index_count >= 2) {
+            total_swaps++;
+            printf("\n[Swap #%d] %s - Lane %d shifts a larger element right\n", total_swaps, name, lane);
+            printf("  -> Swapped positions %d and %d\n", step->indices[0], step->indices[1]);
+        } else if (strcmp(step->action, "no_swap") == 0 && step->index_count >= 2) {
+            printf("\n[Already Ordered] %s - Lane %d\n", name, lane);
+            printf("  -> %d (position %d) <= %d (position %d): nothing to merge\n",
+                   working_array[step->indices[0]], step->indices[0],
+                   working_array[step->indices[1]], step->indices[1]);
+        } else if (strcmp(step->action, "histogram") == 0 && step->index_count >= 2) {
+            printf("\n[Classify] %s - Lane %d\n", name, lane);
+            printf("  -> %d (position %d) belongs in bucket %d\n", working_array[step->indices[0]],
+                   step->indices[0], step->indices[1]);
+        } else if (strcmp(step->action, "scatter") == 0 && step->index_count >= 2) {
+            printf("\n[Write] %s - Lane %d\n", name, lane);
+            printf("  -> Position %d becomes %d\n", step->indices[0], step->indices[1]);
+        }
+    } else {
+        // Statements the program wrote itself
+        if (strcmp(step->action, "compare") == 0 && step->index_count >= 1) {
+            int i = step->indices[0];
+            current_comparison++;
+            printf("\n[Step %d] Comparing position %d (%d)", current_comparison, i, working_array[i]);
+            if (step->index_count >= 2) {
+                printf(" with position %d (%d)", step->indices[1], working_array[step->indices[1]]);
+            }
+            printf("\n");
+        } else if (strcmp(step->action, "swap") == 0 && step->index_count >= 2) {
+            total_swaps++;
+            printf("\n[Swap #%d] Swapping positions %d and %d\n", total_swaps, step->indices[0], step->indices[1]);
+        } else if (strcmp(step->action, "set") == 0 && step->index_count >= 2) {
+            printf("\n[Store] Position %d becomes %d\n", step->indices[0], step->indices[1]);
         }
     }
 }
 
+// Sorting steps index the array, which is truncated to 256 values on load
+static int indicesInArray(const JSONData *data, const Step *step) {
+    int positions = 2;
+    if (strcmp(step->action, "gap") == 0) {
+        positions = 0;
+    } else if (strcmp(step->action, "merge") == 0) {
+        positions = 3;
+    } else if (strcmp(step->action, "set") == 0 || strcmp(step->action, "scatter") == 0 ||
+               strcmp(step->action, "histogram") == 0 || strcmp(step->action, "sift_down") == 0) {
+        positions = 1;  // Then a value, digit or heap size
+    }
+    for (int k = 0; k < step->index_count && k < positions; k++) {
+        if (step->indices[k] < 0 || step->indices[k] >= data->array_size) return 0;
+    }
+    return 1;
+}
+
+// Keeps a lane's latest step for the lane panel
+static void noteLaneStep(const Step *step) {
+    if (step->lane < 0 || step->lane >= MAX_LANES) return;
+    char *cell = lane_last[step->lane];
+    size_t size = sizeof(lane_last[0]);
+    const int *x = step->indices;
+    if (step->index_count < 2) {
+        snprintf(cell, size, "%.15s", step->action);
+    } else if (strcmp(step->action, "compare") == 0) {
+        snprintf(cell, size, "cmp %d:%d", x[0], x[1]);
+    } else if (strcmp(step->action, "swap") == 0) {
+        snprintf(cell, size, "swap %d:%d", x[0], x[1]);
+    } else if (strcmp(step->action, "no_swap") == 0) {
+        snprintf(cell, size, "ok %d:%d", x[0], x[1]);
+    } else if (strcmp(step->action, "scatter") == 0) {
+        snprintf(cell, size, "[%d]=%d", x[0], x[1]);
+    } else if (strcmp(step->action, "histogram") == 0) {
+        snprintf(cell, size, "%d -> b%d", x[0], x[1]);
+    } else {
+        snprintf(cell, size, "%.5s %d..%d", step->action, x[0], x[1]);
+    }
+    if (step->lane >= lane_count) lane_count = step->lane + 1;
+}
+
+// The lanes side by side, each under its latest step; '>' marks the lane
+// that took this one
+static void displayLanes(int current) {
+    for (int first = 0; first < lane_count; first += LANES_PER_ROW) {
+        int last = first + LANES_PER_ROW < lane_count ? first + LANES_PER_ROW : lane_count;
+        for (int l = first; l < last; l++) {
+            char label[16];
+            snprintf(label, sizeof(label), "Lane %d", l);
+            printf("%c%-15s", l == current ? '>' : ' ', label);
+        }
+        printf("\n");
+        for (int l = first; l < last; l++) {
+            printf(" %-15s", lane_last[l]);
+        }
+        printf("\n");
+    }
+    if (lane_count > 0) printf("\n");
+}
+
 // Visualize step
 static void visualizeStep(JSONData *data, Step *step, int *working_array) {
     if (should_exit) return;
@@ -752,6 +1319,8 @@ static void visualizeStep(JSONData *data, Step *step, int *working_array) {
     int is_tree = (strstr(alg, "Tree") != NULL);
     int is_graph = (strncmp(alg, "Graph", 5) == 0);
     int is_sorting = !is_stack && !is_queue && !is_tree && !is_graph;
+    if (is_sorting && step->index_count >= 1 && !indicesInArray(data, step)) return;
+    if (is_sorting) noteLaneStep(step);
     
     if (is_sorting) {
         printf("  Comparisons: %d  |  Swaps: %d  |  Pass: %d\n", 
@@ -771,9 +1340,9 @@ static void visualizeStep(JSONData *data, Step *step, int *working_array) {
     }
     printf("=============================================================\n\n");
     
-    if (strcmp(step->action, "compare") == 0 && step->index_count >= 2) {
+    if (strcmp(step->action, "compare") == 0 && step->index_count >= 1) {
         int i = step->indices[0];
-        int j = step->indices[1];
+        int j = step->index_count >= 2 ? step->indices[1] : -1;
         
         printAlgorithmStep(data, step, working_array);
         displayArray(working_array, data->array_size, i, j, -1);
@@ -790,6 +1359,66 @@ static void visualizeStep(JSONData *data, Step *step, int *working_array) {
         printAlgorithmStep(data, step, working_array);
         displayArray(working_array, data->array_size, i, j, -1);
         
+    } else if (strcmp(step->action, "set") == 0 && step->index_count >= 2) {
+        int i = step->indices[0];
+        working_array[i] = step->indices[1];
+        
+        printAlgorithmStep(data, step, working_array);
+        displayArray(working_array, data->array_size, i, -1, -1);
+        
+    } else if (strcmp(step->action, "scatter") == 0 && step->index_count >= 2) {
+        // The pass's output is written over the array; it is complete
+        // once every element has been scattered
+        int i = step->indices[0];
+        working_array[i] = step->indices[1];
+        
+        printAlgorithmStep(data, step, working_array);
+        displayArray(working_array, data->array_size, i, -1, -1);
+        
+    } else if (strcmp(step->action, "stage") == 0 && step->index_count >= 4) {
+        // A sorting network stage: every pair (i, i + j) of the block is
+        // compare-exchanged at once, descending where (i & k) is set
+        int first = step->indices[0];
+        int size = step->indices[1] - first + 1;
+        int k = step->indices[2];
+        int j = step->indices[3];
+        int exchanged = 0;
+        printAlgorithmStep(data, step, working_array);
+        for (int i = 0; i < size && j > 0; i++) {
+            if ((i & j) || i + j >= size) continue;
+            int *a = &working_array[first + i];
+            int *b = &working_array[first + i + j];
+            int descending = (i & k) != 0;
+            if (descending ? *a < *b : *a > *b) {
+                int temp = *a;
+                *a = *b;
+                *b = temp;
+                exchanged++;
+            }
+        }
+        total_swaps += exchanged;
+        printf("  -> %d pair%s exchanged\n", exchanged, exchanged == 1 ? "" : "s");
+        displayArray(working_array, data->array_size, first, first + size - 1, -1);
+        
+    } else if ((strcmp(step->action, "histogram") == 0 || strcmp(step->action, "sift_down") == 0) &&
+               step->index_count >= 2) {
+        int i = step->indices[0];
+        
+        printAlgorithmStep(data, step, working_array);
+        displayArray(working_array, data->array_size, i, -1, -1);
+        
+    } else if (strcmp(step->action, "gap") == 0 && step->index_count >= 1) {
+        printAlgorithmStep(data, step, working_array);
+        displayArray(working_array, data->array_size, -1, -1, -1);
+        
+    } else if ((strcmp(step->action, "run") == 0 || strcmp(step->action, "merge") == 0 ||
+                strcmp(step->action, "gallop") == 0 || strcmp(step->action, "split") == 0) &&
+               step->index_count >= 2) {
+        // Runs, merges and splits highlight their ends; gallop its probe and key
+        int last = step->index_count >= 3 ? step->indices[2] : step->indices[1];
+        printAlgorithmStep(data, step, working_array);
+        displayArray(working_array, data->array_size, step->indices[0], last, -1);
+        
     } else if (strcmp(step->action, "no_swap") == 0 && step->index_count >= 2) {
         int i = step->indices[0];
         int j = step->indices[1];
@@ -983,37 +1612,70 @@ static void visualizeStep(JSONData *data, Step *step, int *working_array) {
             displayArray(working_array, data->array_size, -1, -1, -1);
         }
     }
+    if (is_sorting) displayLanes(step->lane);
     
-    printf("\n[Press any key to continue... (or Ctrl+C to exit)]\n");
-    
-    // Check for exit signal before waiting for input
-    if (should_exit) {
-        return;
-    }
-    
-    #ifdef _WIN32
-    // On Windows, use _getch() which respects Ctrl+C
-    // The console handler will set should_exit when Ctrl+C is pressed
-    if (!should_exit) {
-        _getch();
-        // Check again after input
-        if (should_exit) {
-            return;
-        }
-    }
-    #else
-    // On Unix, getchar will be interrupted by signal
-    if (!should_exit) {
-        getchar();
-        if (should_exit) {
-            return;
-        }
-    }
-    #endif
+    printf("\n[Any key: step | Space: play/pause | +/-: speed | q: quit]\n");
+    fflush(stdout);
+}
+
+static const char *traceEventsPath;
+
+static void writeTraceEvents(void) {
+    traceMemory();
+    traceEventsWrite(traceEventsPath);
+}
+
+static void printUsage(const char *progName) {
+    printf("Usage: %s [OPTIONS] [trace.json]\n\n", progName);
+    printf("Options:\n");
+    printf("  -h, --help          Show this help message\n");
+    printf("  -a, --autoplay      Start playing steps automatically\n");
+    printf("  -d, --delay MS      Delay between steps while playing (default: %d)\n", DEFAULT_DELAY_MS);
+    printf("  -t, --track N       Show track N of a multi-track trace (default: 0)\n");
+    printf("  --trace-events FILE Record load and frame timings as Chrome trace events\n");
+    printf("\n");
+    printf("Controls: any key = next step, Space = play/pause, +/- = faster/slower, q/ESC = quit\n");
 }
 
 int main(int argc, char **argv) {
-    const char *inputFile = (argc > 1) ? argv[1] : "output.json";
+    const char *inputFile = "output.json";
+    PlaybackState playback = { 1, DEFAULT_DELAY_MS };
+    int track = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--autoplay") == 0) {
+            playback.paused = 0;
+        } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--delay") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s requires a delay in milliseconds\n", argv[i]);
+                return 1;
+            }
+            playback.delay_ms = atoi(argv[++i]);
+            if (playback.delay_ms < MIN_DELAY_MS) playback.delay_ms = MIN_DELAY_MS;
+            if (playback.delay_ms > MAX_DELAY_MS) playback.delay_ms = MAX_DELAY_MS;
+        } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--track") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: %s requires a track number\n", argv[i]);
+                return 1;
+            }
+            track = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trace-events") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --trace-events requires a file name\n");
+                return 1;
+            }
+            traceEventsPath = argv[++i];
+        } else if (argv[i][0] != '-') {
+            inputFile = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
     
     #ifdef _WIN32
     // Enable UTF-8 on Windows (if supported)
@@ -1030,12 +1692,20 @@ int main(int argc, char **argv) {
     #endif
     
     should_exit = 0;  // Reset exit flag
+    if (traceEventsPath) {
+        traceEventsStart();
+        atexit(writeTraceEvents);
+    }
     
     // Reset algorithm tracking
     current_pass = 0;
     current_comparison = 0;
     total_swaps = 0;
     total_comparisons = 0;
+    run_first = run_last = -1;
+    merge_second = -1;
+    lane_count = 0;
+    split_lane = -1;
     
     // Reset data structure tracking
     stack_pushes = 0;
@@ -1049,7 +1719,9 @@ int main(int argc, char **argv) {
     
     printf("Loading visualization data from %s...\n\n", inputFile);
     
-    JSONData *data = parseJSON(inputFile);
+    double start = traceNowUs();
+    JSONData *data = parseJSON(inputFile, track);
+    traceSpan("load trace", "visualizer", start, "\"array\": %d", data ? data->array_size : 0);
     if (!data) {
         fprintf(stderr, "Error: Failed to parse JSON file: %s\n", inputFile);
         return 1;
@@ -1065,6 +1737,9 @@ int main(int argc, char **argv) {
     CLEAR_SCREEN();
     printf("=============================================================\n");
     printf("  %s Visualization\n", data->algorithm);
+    if (data->track_count > 1) {
+        printf("  Track %d of 0..%d (choose another with --track N)\n", track, data->track_count - 1);
+    }
     printf("=============================================================\n\n");
     
     // Display algorithm/data-structure overview
@@ -1073,35 +1748,40 @@ int main(int argc, char **argv) {
     int is_queue = (strncmp(alg, "Queue", 5) == 0);
     int is_tree  = (strstr(alg, "Tree") != NULL);
     int is_graph = (strncmp(alg, "Graph", 5) == 0);
-    int is_sorting = !is_stack && !is_queue && !is_tree && !is_graph;
+    int is_program = (strcmp(alg, "Program") == 0);
+    int is_sorting = !is_stack && !is_queue && !is_tree && !is_graph && !is_program;
 
-    if (is_sorting) {
+    if (is_program) {
+        printf("Program Overview:\n");
+        printf("  -> The program's own loops, ifs and swaps, traced as they run\n");
+        printf("\nInitial Array State:\n");
+        displayArray(working_array, data->array_size, -1, -1, -1);
+    } else if (is_sorting) {
         printf("Algorithm Overview:\n");
         if (strncmp(alg, "Bubble", 6) == 0) {
             printf("  -> Bubble Sort: Repeatedly compares adjacent elements and swaps if out of order\n");
             printf("  -> Each pass moves the largest unsorted element to its correct position\n");
             printf("  -> Continues until no more swaps are needed\n");
-            printf("  -> Time Complexity: O(n²) | Space Complexity: O(1)\n");
         } else if (strncmp(alg, "Insertion", 9) == 0) {
             printf("  -> Insertion Sort: Builds sorted array one element at a time\n");
             printf("  -> Takes each element and inserts it into correct position in sorted portion\n");
             printf("  -> Efficient for small arrays or nearly sorted data\n");
-            printf("  -> Time Complexity: O(n²) | Space Complexity: O(1)\n");
         } else if (strncmp(alg, "Selection", 9) == 0) {
             printf("  -> Selection Sort: Finds minimum element and places it at beginning\n");
             printf("  -> Divides array into sorted and unsorted portions\n");
             printf("  -> Repeatedly selects minimum from unsorted portion\n");
-            printf("  -> Time Complexity: O(n²) | Space Complexity: O(1)\n");
         } else if (strncmp(alg, "Merge", 5) == 0) {
             printf("  -> Merge Sort: Divide and conquer algorithm\n");
             printf("  -> Divides array into halves, sorts each half, then merges them\n");
             printf("  -> Stable and has guaranteed O(n log n) time complexity\n");
-            printf("  -> Time Complexity: O(n log n) | Space Complexity: O(n)\n");
         } else if (strncmp(alg, "Quick", 5) == 0) {
             printf("  -> Quick Sort: Divide and conquer with pivot-based partitioning\n");
             printf("  -> Selects pivot, partitions array around pivot, recursively sorts partitions\n");
             printf("  -> Average case O(n log n), efficient in practice\n");
-            printf("  -> Time Complexity: O(n log n) avg, O(n²) worst | Space Complexity: O(log n)\n");
+        }
+        if (data->time_complexity[0]) {
+            printf("  -> Time Complexity: %s | Space Complexity: %s\n", data->time_complexity,
+                   data->space_complexity[0] ? data->space_complexity : "-");
         }
         printf("\nInitial Array State:\n");
         displayArray(working_array, data->array_size, -1, -1, -1);
@@ -1134,18 +1814,14 @@ int main(int argc, char **argv) {
         printf("\nInitial Graph State:\n");
         printf("  [EMPTY]\n\n");
     }
-    printf("\n[Press any key to start step-by-step visualization... (Ctrl+C to exit)]\n");
+    printf("\n[Any key: start | Space: play/pause | +/-: speed | q: quit]\n");
+    fflush(stdout);
     
-    #ifdef _WIN32
-    int ch = _getch();
-    if (ch == 3 || ch == 27) {  // Ctrl+C or ESC
-        should_exit = 1;
-    }
-    #else
-    int ch = getchar();
-    #endif
+    startInputThread();
+    waitForNextFrame(&playback);
     
     if (should_exit) {
+        stopInputThread();
         printf("\n[Exiting...]\n");
         // Cleanup
         Step *step = data->steps;
@@ -1158,15 +1834,20 @@ int main(int argc, char **argv) {
         return 0;
     }
     
-    // Visualize each step
+    // Visualize each step; input is handled concurrently by the input thread
     Step *step = data->steps;
     int step_num = 1;
     while (step && !should_exit) {
+        start = traceNowUs();
         visualizeStep(data, step, working_array);
+        traceSpan("frame", "render", start, "\"step\": %d", step_num);
+        if (should_exit) break;
+        waitForNextFrame(&playback);
         if (should_exit) break;
         step = step->next;
         step_num++;
     }
+    stopInputThread();
     
     // Final state (only if not interrupted)
     if (!should_exit) {
@@ -1178,9 +1859,21 @@ int main(int argc, char **argv) {
         int is_queue = (strncmp(alg, "Queue", 5) == 0);
         int is_tree = (strstr(alg, "Tree") != NULL);
         int is_graph = (strncmp(alg, "Graph", 5) == 0);
-        int is_sorting = !is_stack && !is_queue && !is_tree && !is_graph;
+        int is_program = (strcmp(alg, "Program") == 0);
+        int is_sorting = !is_stack && !is_queue && !is_tree && !is_graph && !is_program;
         
-        if (is_sorting) {
+        if (is_program) {
+            printf("=============================================================\n");
+            printf("  Final Array - Program Complete\n");
+            printf("=============================================================\n");
+            printf("  Total Comparisons: %d\n", current_comparison);
+            printf("  Total Swaps: %d\n", total_swaps);
+            printf("=============================================================\n\n");
+            displayArray(working_array, data->array_size, -1, -1, -1);
+            printf("[SUCCESS] Program completed successfully!\n");
+            printf("\nSummary:\n");
+            printf("  -> The array as the program's statements left it\n");
+        } else if (is_sorting) {
             // Sorting algorithm summary
             printf("=============================================================\n");
             printf("  Final Sorted Array - %s Complete\n", data->algorithm);
@@ -1193,12 +1886,8 @@ int main(int argc, char **argv) {
             printf("[SUCCESS] Algorithm completed successfully!\n");
             printf("\nSummary:\n");
             printf("  -> Array is now fully sorted\n");
-            if (strncmp(alg, "Merge", 5) == 0 || strncmp(alg, "Quick", 5) == 0) {
-                printf("  -> Time Complexity: O(n log n)\n");
-            } else {
-                printf("  -> Time Complexity: O(n²)\n");
-            }
-            printf("  -> Space Complexity: O(1) for in-place sorting\n");
+            if (data->time_complexity[0]) printf("  -> Time Complexity: %s\n", data->time_complexity);
+            if (data->space_complexity[0]) printf("  -> Space Complexity: %s\n", data->space_complexity);
         } else if (is_stack) {
             // Stack operations summary
             printf("=============================================================\n");
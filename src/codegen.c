@@ -5,303 +5,634 @@
 #include <stdarg.h>
 #include "ast.h"
 #include "ir.h"
+#include "codegen.h"
+#include "dataload.h"
+#include "generators.h"
+#include "traceevents.h"
+#include "threadpool.h"
+#include "batch.h"
+#include "algorithms.h"
 
-static void generateSequence(ASTNode *node);
-static void generateBubbleSortSteps(int n, int *array);
-static void generateInsertionSortSteps(int n, int *array);
-static void generateSelectionSortSteps(int n, int *array);
-static void generateMergeSortSteps(int n, int *array);
-static void generateQuickSortSteps(int n, int *array);
-static void generateStackOperations(ASTNode *operations);
-static void generateQueueOperations(ASTNode *operations);
-static void generateTreeOperations(ASTNode *operations);
-static void generateGraphOperations(ASTNode *operations);
-static void collectDSLInfo(ASTNode *node);
-
-static int loop_depth = 0;
-static int compare_index = 0;
-
-// Global to store array from DSL
-static int dsl_array[256];
-static int dsl_array_size = 0;
-static char algorithm_to_generate[64] = "";
+struct Builtin;
+static void generateSortSteps(CodegenContext *cg, const struct Builtin *builtin, int n, const int *array);
+static void generateStackOperations(CodegenContext *cg);
+static void generateQueueOperations(CodegenContext *cg);
+static void generateTreeOperations(CodegenContext *cg);
+static void generateGraphOperations(CodegenContext *cg);
+static int validateProgram(CodegenContext *cg);
+static void generateTrace(CodegenContext *cg);
+static void collectDSLInfo(CodegenContext *cg, ASTNode *node);
 
 // Data structure operation tracking
 typedef struct OperationNode {
-    char operation[32];
+    const Symbol *operation;
     int value;
     int value2;  // For operations like add_edge
+    int argc;    // Arguments given, checked against the method's arity
     struct OperationNode *next;
 } OperationNode;
 
-// Tree node structure for building actual binary search tree
-typedef struct TreeNode {
+// What one call site (or all method calls on one data structure) generates
+typedef struct CodegenTrack {
+    const Symbol *algorithm;       // Sorting call, or NULL (default algorithm)
+    const ASTNode *option_arg;     // Its second argument, or NULL
+    int argc;                      // Arguments given to the call
+    int option;                    // option_arg resolved by validation
+    const Symbol *structure;       // Object of method calls, or NULL
+    OperationNode *operations;
+    OperationNode *operations_tail;
+    int *array;                    // Array declared before the call (NULL = last declared)
+    int array_size;
+    VMProgram *program;            // Statements written in the program, or NULL
+    int line;                      // Where the call (or first method call) is
+} CodegenTrack;
+
+static void reportError(CodegenContext *cg, const char *format, ...);
+static void reportErrorAtLine(CodegenContext *cg, int line, const char *format, ...);
+
+// Every name the generators give meaning to. Identifiers are interned
+// with their SymbolId as id (see symbols.h), so the table is indexed
+// directly: validating, dispatching and describing a call is one load.
+// Adding an algorithm or operation is one entry here plus its SymbolId.
+typedef enum {
+    BUILTIN_NONE = 0,
+    BUILTIN_ALGORITHM,
+    BUILTIN_STRUCTURE,
+    BUILTIN_METHOD,
+    BUILTIN_INTRINSIC        // Executed with the program's statements (vm.c)
+} BuiltinKind;
+
+#define STRUCTURE_BIT(id) (1u << ((id) - SYM_STACK))
+
+// Spellings accepted for an algorithm's optional second argument. The
+// first entry is the default; the list ends with a NULL name.
+typedef struct {
+    const char *name;
     int value;
-    struct TreeNode *left;
-    struct TreeNode *right;
-} TreeNode;
-
-static OperationNode *ds_operations = NULL;
-static OperationNode *ds_operations_tail = NULL;
-static char ds_type[32] = "";  // "stack", "queue", "tree", "graph"
-
-// Error reporting
-static int has_error = 0;
-static const char *error_message = NULL;
-static int semantic_error_line = 0;
-
-// Validation functions
-static int isValidAlgorithm(const char *name);
-static int isValidDataStructure(const char *name);
-static int isValidStackOperation(const char *op);
-static int isValidQueueOperation(const char *op);
-static int isValidTreeOperation(const char *op);
-static int isValidGraphOperation(const char *op);
-static void reportError(const char *format, ...);
-static void reportErrorAtLine(int line, const char *format, ...);
-
-// Validation functions
-static int isValidAlgorithm(const char *name) {
-    if (!name || name[0] == '\0') return 0;
-    return (strcmp(name, "bubble_sort") == 0 ||
-            strcmp(name, "insertion_sort") == 0 ||
-            strcmp(name, "selection_sort") == 0 ||
-            strcmp(name, "merge_sort") == 0 ||
-            strcmp(name, "quick_sort") == 0 ||
-            strcmp(name, "quicksort") == 0);
-}
-
-static int isValidDataStructure(const char *name) {
-    if (!name || name[0] == '\0') return 0;
-    return (strcmp(name, "stack") == 0 ||
-            strcmp(name, "queue") == 0 ||
-            strcmp(name, "tree") == 0 ||
-            strcmp(name, "graph") == 0);
-}
-
-static int isValidStackOperation(const char *op) {
-    if (!op || op[0] == '\0') return 0;
-    return (strcmp(op, "push") == 0 ||
-            strcmp(op, "pop") == 0 ||
-            strcmp(op, "peek") == 0 ||
-            strcmp(op, "top") == 0);
-}
-
-static int isValidQueueOperation(const char *op) {
-    if (!op || op[0] == '\0') return 0;
-    return (strcmp(op, "enqueue") == 0 ||
-            strcmp(op, "dequeue") == 0);
-}
-
-static int isValidTreeOperation(const char *op) {
-    if (!op || op[0] == '\0') return 0;
-    return (strcmp(op, "insert") == 0 ||
-            strcmp(op, "traverse_inorder") == 0 ||
-            strcmp(op, "traverse_preorder") == 0 ||
-            strcmp(op, "traverse_postorder") == 0);
-}
-
-static int isValidGraphOperation(const char *op) {
-    if (!op || op[0] == '\0') return 0;
-    return (strcmp(op, "add_node") == 0 ||
-            strcmp(op, "add_edge") == 0 ||
-            strcmp(op, "bfs") == 0 ||
-            strcmp(op, "dfs") == 0);
-}
-
-static void reportError(const char *format, ...) {
+} SortOption;
+
+static const SortOption shell_gap_options[] = {
+    { "ciura", SHELL_GAPS_CIURA }, { "tokuda", SHELL_GAPS_TOKUDA }, { "sedgewick", SHELL_GAPS_SEDGEWICK }, { NULL, 0 }
+};
+static const SortOption bitonic_block_options[] = {
+    { "16", 16 }, { "8", 8 }, { NULL, 0 }
+};
+static const SortOption radix_digit_options[] = {
+    { "8", 8 }, { "11", 11 }, { "16", 16 }, { NULL, 0 }
+};
+static const SortOption quick_options[] = {
+    { "lomuto", QUICK_LOMUTO }, { "median3", QUICK_MEDIAN3 }, { "ninther", QUICK_NINTHER }, { "hoare", QUICK_HOARE },
+    { "three_way", QUICK_THREE_WAY }, { "intro", QUICK_INTRO }, { "pdq", QUICK_PDQ }, { NULL, 0 }
+};
+// Lanes of the parallel sorts. The trace depends on the count, so it is
+// always given rather than taken from the machine's CPUs.
+static const SortOption lane_options[] = {
+    { "4", 4 }, { "2", 2 }, { "8", 8 }, { "16", 16 }, { NULL, 0 }
+};
+
+typedef struct Builtin {
+    BuiltinKind kind;
+    const char *display;     // Trace title (algorithms and structures)
+    sort_fn sort;                            // Algorithms (algorithms.h)
+    void (*operations)(CodegenContext *cg);  // Structures
+    SymbolId canonical;      // Algorithm this one is an alias of (SYM_NONE if none)
+    unsigned structures;     // Methods: STRUCTURE_BIT of each owner
+    int arity;               // Methods: most arguments accepted
+    const char *time;        // Complexity, shown in the compile banner
+    const char *space;
+    tuned_sort_fn tuned;     // Algorithms taking an option: called instead of sort
+    const SortOption *options;
+} Builtin;
+
+static const Builtin builtins[SYM_BUILTIN_COUNT] = {
+    [SYM_BUBBLE_SORT]    = { BUILTIN_ALGORITHM, "Bubble Sort", bubble_sort, NULL, SYM_NONE, 0, 1, "O(n²)", "O(1)" },
+    [SYM_INSERTION_SORT] = { BUILTIN_ALGORITHM, "Insertion Sort", insertion_sort, NULL, SYM_NONE, 0, 1, "O(n²)", "O(1)" },
+    [SYM_SELECTION_SORT] = { BUILTIN_ALGORITHM, "Selection Sort", selection_sort, NULL, SYM_NONE, 0, 1, "O(n²)", "O(1)" },
+    [SYM_MERGE_SORT]     = { BUILTIN_ALGORITHM, "Merge Sort", merge_sort, NULL, SYM_NONE, 0, 1, "O(n log n)", "O(n)" },
+    [SYM_QUICK_SORT]     = { BUILTIN_ALGORITHM, "Quick Sort", quick_sort, NULL, SYM_NONE, 0, 2, "O(n log n) average", "O(log n)",
+                             quick_sort_strategy, quick_options },
+    [SYM_QUICKSORT]      = { BUILTIN_ALGORITHM, "Quick Sort", quick_sort, NULL, SYM_QUICK_SORT, 0, 2, "O(n log n) average", "O(log n)",
+                             quick_sort_strategy, quick_options },
+    [SYM_HEAP_SORT]      = { BUILTIN_ALGORITHM, "Heap Sort", heap_sort, NULL, SYM_NONE, 0, 1, "O(n log n)", "O(1)" },
+    [SYM_SHELL_SORT]     = { BUILTIN_ALGORITHM, "Shell Sort", shell_sort, NULL, SYM_NONE, 0, 2, "O(n^(4/3)) with these gaps", "O(1)",
+                             shell_sort_gaps, shell_gap_options },
+    [SYM_RADIX_SORT]     = { BUILTIN_ALGORITHM, "Radix Sort", radix_sort, NULL, SYM_NONE, 0, 2, "O(n * 32/d) for d-bit digits", "O(n + 2^d)",
+                             radix_sort_digits, radix_digit_options },
+    [SYM_TIM_SORT]       = { BUILTIN_ALGORITHM, "Tim Sort", tim_sort, NULL, SYM_NONE, 0, 1, "O(n log n), O(n) on presorted runs", "O(n)" },
+    [SYM_BITONIC_SORT]   = { BUILTIN_ALGORITHM, "Bitonic Sort", bitonic_sort, NULL, SYM_NONE, 0, 2, "O(n log n)", "O(n)",
+                             bitonic_sort_block, bitonic_block_options },
+    [SYM_PARALLEL_MERGE_SORT] = { BUILTIN_ALGORITHM, "Parallel Merge Sort", parallel_merge_sort, NULL, SYM_NONE, 0, 2,
+                                  "O(n log n), O((n/p) log n) per lane", "O(n)", parallel_merge_sort_lanes, lane_options },
+    [SYM_SAMPLE_SORT]    = { BUILTIN_ALGORITHM, "Sample Sort", sample_sort, NULL, SYM_NONE, 0, 2,
+                             "O(n log n), O((n/p) log n) per lane", "O(n)", sample_sort_lanes, lane_options },
+    [SYM_ODD_EVEN_SORT]  = { BUILTIN_ALGORITHM, "Odd-Even Transposition Sort", odd_even_sort, NULL, SYM_NONE, 0, 2,
+                             "O(n log n + n p), O(n) per round", "O(n)", odd_even_sort_lanes, lane_options },
+
+    [SYM_STACK] = { BUILTIN_STRUCTURE, "Stack Operations", NULL, generateStackOperations, SYM_NONE, 0, 0, "O(1) per operation", "O(n)" },
+    [SYM_QUEUE] = { BUILTIN_STRUCTURE, "Queue Operations", NULL, generateQueueOperations, SYM_NONE, 0, 0, "O(1) per operation", "O(n)" },
+    [SYM_TREE]  = { BUILTIN_STRUCTURE, "Binary Tree Operations", NULL, generateTreeOperations, SYM_NONE, 0, 0, "O(h) per insert, O(n) per traversal", "O(n)" },
+    [SYM_GRAPH] = { BUILTIN_STRUCTURE, "Graph Operations", NULL, generateGraphOperations, SYM_NONE, 0, 0, "O(V + E) per search", "O(V + E)" },
+
+    [SYM_PUSH]               = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_STACK), 1, NULL, NULL },
+    [SYM_POP]                = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_STACK), 0, NULL, NULL },
+    [SYM_PEEK]               = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_STACK), 0, NULL, NULL },
+    [SYM_TOP]                = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_STACK), 0, NULL, NULL },
+    [SYM_ENQUEUE]            = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_QUEUE), 1, NULL, NULL },
+    [SYM_DEQUEUE]            = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_QUEUE), 0, NULL, NULL },
+    [SYM_INSERT]             = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_TREE), 1, NULL, NULL },
+    [SYM_TRAVERSE_INORDER]   = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_TREE), 0, NULL, NULL },
+    [SYM_TRAVERSE_PREORDER]  = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_TREE), 0, NULL, NULL },
+    [SYM_TRAVERSE_POSTORDER] = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_TREE), 0, NULL, NULL },
+    [SYM_ADD_NODE]           = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_GRAPH), 1, NULL, NULL },
+    [SYM_ADD_EDGE]           = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_GRAPH), 2, NULL, NULL },
+    [SYM_BFS]                = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_GRAPH), 1, NULL, NULL },
+    [SYM_DFS]                = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_GRAPH), 1, NULL, NULL },
+    [SYM_LOAD]               = { BUILTIN_METHOD, NULL, NULL, NULL, SYM_NONE, STRUCTURE_BIT(SYM_GRAPH), 1, NULL, NULL },
+
+    [SYM_SWAP] = { BUILTIN_INTRINSIC, NULL, NULL, NULL, SYM_NONE, 0, 2, NULL, NULL },
+    [SYM_LEN]  = { BUILTIN_INTRINSIC, NULL, NULL, NULL, SYM_NONE, 0, 1, NULL, NULL },
+};
+
+// NULL unless `sym` is a built-in of the given kind
+static const Builtin *findBuiltin(const Symbol *sym, BuiltinKind kind) {
+    if (!sym || sym->id <= SYM_NONE || sym->id >= SYM_BUILTIN_COUNT) return NULL;
+    const Builtin *builtin = &builtins[sym->id];
+    return builtin->kind == kind ? builtin : NULL;
+}
+
+// "a, b, c" for the built-ins of one kind (and owner), for diagnostics
+static const char *listBuiltins(BuiltinKind kind, unsigned structure, char *out, size_t size) {
+    size_t len = 0;
+    out[0] = '\0';
+    for (int id = 1; id < SYM_BUILTIN_COUNT && len < size; id++) {
+        const Builtin *builtin = &builtins[id];
+        if (builtin->kind != kind || builtin->canonical != SYM_NONE) continue;
+        if (structure && !(builtin->structures & structure)) continue;
+        len += (size_t)snprintf(out + len, size - len, "%s%s", len ? ", " : "", builtinName((SymbolId)id));
+    }
+    return out;
+}
+
+static void recordError(CodegenContext *cg, int line, const char *format, va_list args) {
+    char message[224];  // Leaves room for the "line N: " prefix in error_message
+    vsnprintf(message, sizeof(message), format, args);
+    if (!cg->has_error) {
+        if (line > 0) {
+            snprintf(cg->error_message, sizeof(cg->error_message), "line %d: %s", line, message);
+        } else {
+            snprintf(cg->error_message, sizeof(cg->error_message), "%s", message);
+        }
+    }
+    if (!cg->quiet) {
+        if (line > 0) {
+            fprintf(stderr, "Semantic Error at line %d: %s\n", line, message);
+        } else {
+            fprintf(stderr, "Semantic Error: %s\n", message);
+        }
+    }
+    cg->has_error = 1;
+}
+
+static void reportError(CodegenContext *cg, const char *format, ...) {
     va_list args;
     va_start(args, format);
-    if (semantic_error_line > 0) {
-        fprintf(stderr, "Semantic Error at line %d: ", semantic_error_line);
-    } else {
-        fprintf(stderr, "Semantic Error: ");
-    }
-    vfprintf(stderr, format, args);
-    fprintf(stderr, "\n");
+    recordError(cg, cg->semantic_error_line, format, args);
     va_end(args);
-    has_error = 1;
 }
 
-static void reportErrorAtLine(int line, const char *format, ...) {
+static void reportErrorAtLine(CodegenContext *cg, int line, const char *format, ...) {
     va_list args;
     va_start(args, format);
-    fprintf(stderr, "Semantic Error at line %d: ", line);
-    vfprintf(stderr, format, args);
-    fprintf(stderr, "\n");
+    recordError(cg, line, format, args);
     va_end(args);
-    has_error = 1;
-    semantic_error_line = line;
-}
-
-void generateCode(ASTNode *node) {
-    loop_depth = 0;
-    compare_index = 0;
-    dsl_array_size = 0;
-    algorithm_to_generate[0] = '\0';
-    ds_type[0] = '\0';
-    ds_operations = NULL;
-    ds_operations_tail = NULL;
-    has_error = 0;
-    error_message = NULL;
-    
-    // Default values
-    int default_array[] = {5, 3, 8, 4, 2};
-    int array_size = 5;
-    strcpy(algorithm_to_generate, "");
+    cg->semantic_error_line = line;
+}
+
+static void freeTracks(CodegenContext *cg) {
+    for (int i = 0; i < cg->track_count; i++) {
+        OperationNode *op = cg->tracks[i].operations;
+        while (op) {
+            OperationNode *next = op->next;
+            free(op);
+            op = next;
+        }
+        vmFree(cg->tracks[i].program);
+    }
+    free(cg->tracks);
+    cg->tracks = NULL;
+    cg->track_count = 0;
+    cg->track_capacity = 0;
+}
+
+static CodegenTrack *addTrack(CodegenContext *cg) {
+    if (cg->track_count == cg->track_capacity) {
+        int grown = cg->track_capacity ? cg->track_capacity * 2 : 4;
+        CodegenTrack *bigger = (CodegenTrack *)realloc(cg->tracks, (size_t)grown * sizeof(CodegenTrack));
+        if (!bigger) {
+            reportError(cg, "Out of memory for %d trace tracks", grown);
+            return NULL;
+        }
+        cg->tracks = bigger;
+        cg->track_capacity = grown;
+    }
+    CodegenTrack *track = &cg->tracks[cg->track_count++];
+    memset(track, 0, sizeof(*track));
+    track->line = cg->line;
+    return track;
+}
+
+// All method calls on one data structure share its track
+static CodegenTrack *structureTrack(CodegenContext *cg, const Symbol *structure) {
+    for (int i = 0; i < cg->track_count; i++) {
+        if (cg->tracks[i].structure == structure) return &cg->tracks[i];
+    }
+    CodegenTrack *track = addTrack(cg);
+    if (track) track->structure = structure;
+    return track;
+}
+
+void initCodegen(CodegenContext *cg, IRContext *ir, Arena *arena, SymbolTable *symbols,
+                 const char *source_path) {
+    memset(cg, 0, sizeof(*cg));
+    cg->ir = ir;
+    cg->arena = arena;
+    cg->symbols = symbols;
+    cg->source_path = source_path;
+    cg->track_threads = threadPoolDefaultSize();
+    cg->limits.instructions = VM_DEFAULT_MAX_INSTRUCTIONS;
+    cg->limits.steps = VM_DEFAULT_MAX_STEPS;
+    cg->limits.timeoutMs = VM_DEFAULT_TIMEOUT_MS;
+}
+
+// Shown when the program declares no array
+static const int default_array[] = {5, 3, 8, 4, 2};
+
+// Loops, ifs and swaps the program writes itself run on the bytecode
+// interpreter; when they touch array elements they become track 0
+static int compileStatements(CodegenContext *cg, ASTNode *node) {
+    VMProgram *program = NULL;
+    VMError error;
+    double start = traceNowUs();
+    if (vmCompile(node, cg->symbols, &program, &error) != 0) {
+        reportErrorAtLine(cg, error.line, "%s", error.message);
+        return -1;
+    }
+    if (!program) return 0;
+    traceSpan("compile statements", "compile", start, "\"instructions\": %d", program->codeSize);
+    if (!addTrack(cg)) {
+        vmFree(program);
+        return -1;
+    }
+    memmove(&cg->tracks[1], &cg->tracks[0], (size_t)(cg->track_count - 1) * sizeof(CodegenTrack));
+    memset(&cg->tracks[0], 0, sizeof(CodegenTrack));
+    cg->tracks[0].program = program;
+    return 0;
+}
+
+int analyzeProgram(CodegenContext *cg, ASTNode *node) {
+    cg->dsl_array = NULL;
+    cg->dsl_array_size = 0;
+    cg->loaded_files = NULL;
+    freeTracks(cg);
+    cg->has_error = 0;
+    cg->error_message[0] = '\0';
+    cg->semantic_error_line = 0;
+    cg->line = 0;
+    cg->node_count = 0;
     
     // First pass: collect array declarations, algorithm calls, and data structure operations
-    collectDSLInfo(node);
-    
-    // Check if we have data structure operations
-    if (ds_operations && ds_type[0] != '\0') {
-        // Validate data structure type
-        if (!isValidDataStructure(ds_type)) {
-            reportError("Unknown data structure: '%s'. Valid options are: stack, queue, tree, graph", ds_type);
-            return;
+    double start = traceNowUs();
+    collectDSLInfo(cg, node);
+    traceSpan("collectDSLInfo", "compile", start, "\"nodes\": %d", cg->node_count);
+    if (cg->has_error || compileStatements(cg, node) != 0) {
+        freeTracks(cg);
+        return -1;
+    }
+    // A program without calls sorts its array with the default algorithm
+    if (cg->track_count == 0 && !addTrack(cg)) return -1;
+    for (int i = 0; i < cg->track_count; i++) {
+        CodegenTrack *track = &cg->tracks[i];
+        if (!track->structure && !track->program && !track->array) {
+            track->array = cg->dsl_array;
+            track->array_size = cg->dsl_array_size;
         }
-        
-        // Validate all operations
-        OperationNode *op = ds_operations;
-        while (op) {
-            int valid = 0;
-            if (strcmp(ds_type, "stack") == 0) {
-                valid = isValidStackOperation(op->operation);
-                if (!valid) {
-                    reportError("Invalid stack operation: '%s'. Valid operations are: push, pop, peek, top", op->operation);
-                }
-            } else if (strcmp(ds_type, "queue") == 0) {
-                valid = isValidQueueOperation(op->operation);
-                if (!valid) {
-                    reportError("Invalid queue operation: '%s'. Valid operations are: enqueue, dequeue", op->operation);
-                }
-            } else if (strcmp(ds_type, "tree") == 0) {
-                valid = isValidTreeOperation(op->operation);
-                if (!valid) {
-                    reportError("Invalid tree operation: '%s'. Valid operations are: insert, traverse_inorder, traverse_preorder, traverse_postorder", op->operation);
-                }
-            } else if (strcmp(ds_type, "graph") == 0) {
-                valid = isValidGraphOperation(op->operation);
-                if (!valid) {
-                    reportError("Invalid graph operation: '%s'. Valid operations are: add_node, add_edge, bfs, dfs", op->operation);
-                }
+    }
+    start = traceNowUs();
+    int status = validateProgram(cg);
+    if (status != 0) freeTracks(cg);
+    traceSpan("validate", "compile", start, NULL);
+    return status;
+}
+
+// Sets track->option from the call's second argument: a name, a number
+// or a string naming one of the builtin's options
+static int resolveSortOption(CodegenContext *cg, CodegenTrack *track, const Builtin *builtin) {
+    const ASTNode *arg = track->option_arg;
+    const char *given = NULL;
+    char number[16];
+    track->option = builtin->options[0].value;
+    if (!arg) return 0;
+    if (arg->type == NUMBER_NODE) {
+        snprintf(number, sizeof(number), "%d", arg->number);
+        given = number;
+    } else if (arg->type == VALUE_NODE && arg->symbol) {
+        given = arg->symbol->name;
+    } else if (arg->type == STRING_NODE) {
+        given = arg->name;
+    }
+    for (const SortOption *option = builtin->options; given && option->name; option++) {
+        if (strcmp(option->name, given) == 0) {
+            track->option = option->value;
+            return 0;
+        }
+    }
+    char valid[128];
+    size_t len = 0;
+    valid[0] = '\0';
+    for (const SortOption *option = builtin->options; option->name && len < sizeof(valid); option++) {
+        len += (size_t)snprintf(valid + len, sizeof(valid) - len, "%s%s", len ? ", " : "", option->name);
+    }
+    reportError(cg, "Invalid %s option '%s'. Valid options are: %s", track->algorithm->name,
+                given ? given : "(expression)", valid);
+    return -1;
+}
+
+// Second pass: check each track's calls and operations against what the
+// generators support
+static int validateTrack(CodegenContext *cg, CodegenTrack *track) {
+    char valid[256];
+    const Builtin *builtin;
+    if (track->program) {
+        if (!cg->quiet) {
+            printf("  Program: %d bytecode instructions, %d registers\n", track->program->codeSize,
+                   track->program->registerCount);
+        }
+        return 0;
+    }
+    if (track->structure) {
+        const Symbol *structure = track->structure;
+        builtin = findBuiltin(structure, BUILTIN_STRUCTURE);
+        if (!builtin) {
+            reportError(cg, "Unknown data structure: '%s'. Valid options are: %s", structure->name,
+                        listBuiltins(BUILTIN_STRUCTURE, 0, valid, sizeof(valid)));
+            return -1;
+        }
+        unsigned owner = STRUCTURE_BIT(structure->id);
+        for (const OperationNode *op = track->operations; op; op = op->next) {
+            const Builtin *method = findBuiltin(op->operation, BUILTIN_METHOD);
+            if (!method || !(method->structures & owner)) {
+                reportError(cg, "Invalid %s operation: '%s'. Valid operations are: %s", structure->name,
+                            op->operation->name, listBuiltins(BUILTIN_METHOD, owner, valid, sizeof(valid)));
+                return -1;
+            }
+            if (op->argc > method->arity) {
+                reportError(cg, "%s.%s takes %d argument%s, got %d", structure->name, op->operation->name,
+                            method->arity, method->arity == 1 ? "" : "s", op->argc);
+                return -1;
             }
-            if (has_error) {
-                // Free operations list before returning
-                while (ds_operations) {
-                    OperationNode *next = ds_operations->next;
-                    free(ds_operations);
-                    ds_operations = next;
+        }
+    } else {
+        const Symbol *algorithm = track->algorithm;
+        builtin = algorithm ? findBuiltin(algorithm, BUILTIN_ALGORITHM) : &builtins[SYM_BUBBLE_SORT];
+        if (!builtin) {
+            reportError(cg, "Unknown algorithm: '%s'. Valid algorithms are: %s", algorithm->name,
+                        listBuiltins(BUILTIN_ALGORITHM, 0, valid, sizeof(valid)));
+            if (!cg->quiet) fprintf(stderr, "Did you mean: bubble_sort?\n");
+            return -1;
+        }
+        if (track->argc > builtin->arity) {
+            reportError(cg, "%s takes %d argument%s, got %d", algorithm->name, builtin->arity,
+                        builtin->arity == 1 ? "" : "s", track->argc);
+            return -1;
+        }
+        if (builtin->options && resolveSortOption(cg, track, builtin) != 0) return -1;
+    }
+    if (!cg->quiet) {
+        printf("  %s: time %s, space %s\n", builtin->display, builtin->time, builtin->space);
+    }
+    return 0;
+}
+
+static int validateProgram(CodegenContext *cg) {
+    for (int i = 0; i < cg->track_count; i++) {
+        cg->semantic_error_line = cg->tracks[i].line;
+        if (validateTrack(cg, &cg->tracks[i]) != 0) return -1;
+    }
+    return 0;
+}
+
+// Mixes 32-bit words into two independent 64-bit lanes (128-bit key)
+typedef struct {
+    unsigned long long a, b;
+} KeyHash;
+
+static void hashWord(KeyHash *h, unsigned int word) {
+    h->a = (h->a ^ word) * 0x100000001b3ull;
+    h->b = (h->b ^ word) * 0x9e3779b97f4a7c15ull;
+    h->b ^= h->b >> 29;
+}
+
+static unsigned long long finishLane(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
+void programKey(const CodegenContext *cg, char key[PROGRAM_KEY_SIZE]) {
+    KeyHash h = { 0xcbf29ce484222325ull, 0x6a09e667f3bcc909ull };
+    hashWord(&h, CODEGEN_OUTPUT_VERSION);
+    hashWord(&h, (unsigned int)cg->track_count);
+    for (int i = 0; i < cg->track_count; i++) {
+        const CodegenTrack *track = &cg->tracks[i];
+        if (track->program) {
+            const VMProgram *program = track->program;
+            hashWord(&h, SYM_NONE);
+            hashWord(&h, (unsigned int)program->registerCount);
+            hashWord(&h, (unsigned int)program->traced);
+            for (int j = 0; j < program->codeSize; j++) {
+                const VMInstruction *ins = &program->code[j];
+                hashWord(&h, (unsigned int)ins->op);
+                hashWord(&h, (unsigned int)ins->a);
+                hashWord(&h, (unsigned int)ins->b);
+                hashWord(&h, (unsigned int)ins->c);
+            }
+            for (int j = 0; j < program->arrayCount; j++) {
+                hashWord(&h, (unsigned int)program->arrays[j].size);
+                for (int k = 0; k < program->arrays[j].size; k++) {
+                    hashWord(&h, (unsigned int)program->arrays[j].values[k]);
                 }
-                return;
             }
-            op = op->next;
+            continue;
         }
-        
-        // Generate data structure visualization
-        if (strcmp(ds_type, "stack") == 0) {
-            setAlgorithmName("Stack Operations");
-            setDetectedAlgorithm("stack");
-            generateStackOperations(node);
-        } else if (strcmp(ds_type, "queue") == 0) {
-            setAlgorithmName("Queue Operations");
-            setDetectedAlgorithm("queue");
-            generateQueueOperations(node);
-        } else if (strcmp(ds_type, "tree") == 0) {
-            setAlgorithmName("Binary Tree Operations");
-            setDetectedAlgorithm("tree");
-            generateTreeOperations(node);
-        } else if (strcmp(ds_type, "graph") == 0) {
-            setAlgorithmName("Graph Operations");
-            setDetectedAlgorithm("graph");
-            generateGraphOperations(node);
+        if (track->structure) {
+            hashWord(&h, (unsigned int)track->structure->id);
+            for (const OperationNode *op = track->operations; op; op = op->next) {
+                hashWord(&h, (unsigned int)op->operation->id);
+                hashWord(&h, (unsigned int)op->value);
+                hashWord(&h, (unsigned int)op->value2);
+            }
+            continue;
         }
-        
-        // Free operations list
-        while (ds_operations) {
-            OperationNode *next = ds_operations->next;
-            free(ds_operations);
-            ds_operations = next;
+        // Aliases (quicksort) produce the same trace as their algorithm
+        int id = track->algorithm ? track->algorithm->id : SYM_BUBBLE_SORT;
+        if (builtins[id].canonical != SYM_NONE) id = builtins[id].canonical;
+        hashWord(&h, (unsigned int)id);
+        hashWord(&h, (unsigned int)track->option);
+        const int *array = track->array_size > 0 ? track->array : default_array;
+        int size = track->array_size > 0 ? track->array_size : (int)(sizeof(default_array) / sizeof(default_array[0]));
+        hashWord(&h, (unsigned int)size);
+        for (int j = 0; j < size; j++) {
+            hashWord(&h, (unsigned int)array[j]);
         }
+    }
+    snprintf(key, PROGRAM_KEY_SIZE, "%016llx%016llx", finishLane(h.a), finishLane(h.b));
+}
+
+// Runs on a private copy of the context, so tracks can generate on
+// separate threads
+static void generateTrack(void *arg) {
+    CodegenContext *cg = (CodegenContext *)arg;
+    double start = traceNowUs();
+    generateTrace(cg);
+    if (traceEventsActive()) {
+        char name[80];
+        snprintf(name, sizeof(name), "generate %s", cg->ir->detectedAlgorithm);
+        traceSpan(name, "generate", start, "\"steps\": %d", cg->ir->stepCount);
+    }
+}
+
+void generateSteps(CodegenContext *cg) {
+    int count = cg->track_count;
+    if (count == 0) return;
+    CodegenContext *jobs = (CodegenContext *)malloc((size_t)count * sizeof(CodegenContext));
+    IRContext *extra = count > 1 ? addTracks(cg->ir, count - 1) : NULL;
+    if (!jobs || (count > 1 && !extra)) {
+        free(jobs);
+        reportError(cg, "Out of memory for %d trace tracks", count);
         return;
     }
-    
-    // Use DSL array if available, otherwise use default
-    if (dsl_array_size > 0) {
-        setArray(dsl_array, dsl_array_size);
-        array_size = dsl_array_size;
-    } else {
-        setArray(default_array, array_size);
-        for (int i = 0; i < array_size; i++) {
-            dsl_array[i] = default_array[i];
+    // One deadline for every track, however many run at once
+    cg->deadline_ms = cg->limits.timeoutMs > 0 ? monotonicMs() + cg->limits.timeoutMs : 0;
+    for (int i = 0; i < count; i++) {
+        const CodegenTrack *track = &cg->tracks[i];
+        CodegenContext *local = &jobs[i];
+        *local = *cg;
+        local->ir = i == 0 ? cg->ir : &extra[i - 1];
+        local->algorithm_to_generate = track->algorithm;
+        local->sort_option = track->option;
+        local->ds_type = track->structure;
+        local->ds_operations = track->operations;
+        local->program = track->program;
+        local->dsl_array = track->array;
+        local->dsl_array_size = track->array_size;
+        local->semantic_error_line = track->line;
+    }
+
+    // Tracks are independent; a pool is only worth starting for several
+    ThreadPool *pool = NULL;
+    int threads = count < cg->track_threads ? count : cg->track_threads;
+    if (threads > 1) pool = threadPoolCreate(threads);
+    for (int i = 0; i < count; i++) {
+        if (pool) {
+            threadPoolSubmit(pool, generateTrack, &jobs[i]);
+        } else {
+            generateTrack(&jobs[i]);
         }
-        dsl_array_size = array_size;
     }
-    
-    // Determine algorithm name and display name
-    char display_name[64] = "Algorithm";
-    if (algorithm_to_generate[0] != '\0') {
-        // Validate algorithm name
-        if (!isValidAlgorithm(algorithm_to_generate)) {
-            reportError("Unknown algorithm: '%s'. Valid algorithms are: bubble_sort, insertion_sort, selection_sort, merge_sort, quick_sort", algorithm_to_generate);
-            fprintf(stderr, "Did you mean: bubble_sort?\n");
-            return;
+    if (pool) {
+        threadPoolWait(pool);
+        threadPoolDestroy(pool);
+    }
+
+    // Keep the first failure in program order
+    for (int i = 0; i < count && !cg->has_error; i++) {
+        const CodegenContext *local = &jobs[i];
+        if (local->has_error) {
+            cg->has_error = 1;
+            cg->semantic_error_line = local->semantic_error_line;
+            memcpy(cg->error_message, local->error_message, sizeof(cg->error_message));
         }
-        
-        // Map algorithm names to display names
-        if (strcmp(algorithm_to_generate, "bubble_sort") == 0) {
-            strcpy(display_name, "Bubble Sort");
-        } else if (strcmp(algorithm_to_generate, "insertion_sort") == 0) {
-            strcpy(display_name, "Insertion Sort");
-        } else if (strcmp(algorithm_to_generate, "selection_sort") == 0) {
-            strcpy(display_name, "Selection Sort");
-        } else if (strcmp(algorithm_to_generate, "merge_sort") == 0) {
-            strcpy(display_name, "Merge Sort");
-        } else if (strcmp(algorithm_to_generate, "quick_sort") == 0 || strcmp(algorithm_to_generate, "quicksort") == 0) {
-            strcpy(display_name, "Quick Sort");
+    }
+    free(jobs);
+}
+
+static void generateTrace(CodegenContext *cg) {
+    if (cg->program) {
+        VMError error;
+        setAlgorithmName(cg->ir, "Program");
+        setDetectedAlgorithm(cg->ir, "program");
+        if (vmRun(cg->program, &cg->limits, cg->deadline_ms, cg->ir, &error) != 0) {
+            reportErrorAtLine(cg, error.line, "%s", error.message);
         }
-        setAlgorithmName(display_name);
-        setDetectedAlgorithm(algorithm_to_generate);
-    } else {
-        strcpy(display_name, "Bubble Sort");
-        setAlgorithmName(display_name);
-        setDetectedAlgorithm("bubble_sort");
+        return;
+    }
+    if (cg->ds_type) {
+        // Generate data structure visualization
+        const Builtin *structure = &builtins[cg->ds_type->id];
+        setAlgorithmName(cg->ir, structure->display);
+        setDetectedAlgorithm(cg->ir, cg->ds_type->name);
+        setComplexity(cg->ir, structure->time, structure->space);
+        structure->operations(cg);
+        return;
     }
     
-    int *array_to_use = dsl_array_size > 0 ? dsl_array : default_array;
+    // Use DSL array if available, otherwise use default
+    const int *array_to_use = default_array;
+    int array_size = (int)(sizeof(default_array) / sizeof(default_array[0]));
+    if (cg->dsl_array_size > 0) {
+        array_to_use = cg->dsl_array;
+        array_size = cg->dsl_array_size;
+    }
+    if (setArray(cg->ir, array_to_use, array_size) != 0) {
+        reportError(cg, "Out of memory for a %d-element array", array_size);
+        return;
+    }
     
-    // Generate steps based on detected algorithm
-    if (strcmp(algorithm_to_generate, "bubble_sort") == 0 || algorithm_to_generate[0] == '\0') {
-        generateBubbleSortSteps(array_size, array_to_use);
-    } else if (strcmp(algorithm_to_generate, "insertion_sort") == 0) {
-        generateInsertionSortSteps(array_size, array_to_use);
-    } else if (strcmp(algorithm_to_generate, "selection_sort") == 0) {
-        generateSelectionSortSteps(array_size, array_to_use);
-    } else if (strcmp(algorithm_to_generate, "merge_sort") == 0) {
-        generateMergeSortSteps(array_size, array_to_use);
-    } else if (strcmp(algorithm_to_generate, "quick_sort") == 0 || strcmp(algorithm_to_generate, "quicksort") == 0) {
-        generateQuickSortSteps(array_size, array_to_use);
+    const Symbol *algorithm = cg->algorithm_to_generate;
+    const Builtin *builtin = &builtins[algorithm ? algorithm->id : SYM_BUBBLE_SORT];
+    setAlgorithmName(cg->ir, builtin->display);
+    setComplexity(cg->ir, builtin->time, builtin->space);
+    generateSortSteps(cg, builtin, array_size, array_to_use);
+    setDetectedAlgorithm(cg->ir, algorithm ? algorithm->name : "bubble_sort");
+}
+
+void generateCode(CodegenContext *cg, ASTNode *node) {
+    if (analyzeProgram(cg, node) == 0) {
+        generateSteps(cg);
     }
 }
 
+void freeCodegen(CodegenContext *cg) {
+    freeTracks(cg);
+}
+
 // Get error status
-int hasGenerationError(void) {
-    return has_error;
+int hasGenerationError(const CodegenContext *cg) {
+    return cg->has_error;
 }
 
-static void addOperation(const char *op, int val, int val2) {
+// A lost operation would leave a hole in the structure's trace, so running
+// out of memory is an error. Returns 0, or -1 after reporting it.
+static int addOperation(CodegenContext *cg, CodegenTrack *track, const Symbol *op, int argc, int val, int val2) {
     OperationNode *node = (OperationNode *)calloc(1, sizeof(OperationNode));
-    if (!node) return;
-    strncpy(node->operation, op, sizeof(node->operation) - 1);
+    if (!node) {
+        reportErrorAtLine(cg, cg->line, "Out of memory recording the %s operation", op->name);
+        return -1;
+    }
+    node->operation = op;
     node->value = val;
     node->value2 = val2;
+    node->argc = argc;
     node->next = NULL;
-    if (!ds_operations) {
-        ds_operations = ds_operations_tail = node;
+    if (!track->operations) {
+        track->operations = track->operations_tail = node;
     } else {
-        ds_operations_tail->next = node;
-        ds_operations_tail = node;
+        track->operations_tail->next = node;
+        track->operations_tail = node;
     }
+    return 0;
 }
 
 static int extractNumberFromAST(ASTNode *node) {
@@ -316,669 +647,378 @@ static int extractNumberFromAST(ASTNode *node) {
     return 0;
 }
 
-static void collectDSLInfo(ASTNode *node) {
+// Remembers a path load() named, so watch mode can recompile when the file
+// appears or changes, even if it could not be read this time
+static void recordLoadedFile(CodegenContext *cg, const char *path) {
+    for (const LoadedFile *file = cg->loaded_files; file; file = file->next) {
+        if (strcmp(file->path, path) == 0) return;
+    }
+    LoadedFile *file = (LoadedFile *)arenaAlloc(cg->arena, sizeof(LoadedFile));
+    char *copy = arenaStrdup(cg->arena, path);
+    if (!file || !copy) return;
+    file->path = copy;
+    file->next = cg->loaded_files;
+    cg->loaded_files = file;
+}
+
+// Reads load("file") for the current statement; NULL after reporting an error
+static int *loadDataset(CodegenContext *cg, ASTNode *args, int *count) {
+    if (!args || args->type != STRING_NODE || args->right) {
+        reportErrorAtLine(cg, cg->line, "load expects one file name: load(\"data.csv\")");
+        return NULL;
+    }
+    char path[1024];
+    char reason[160];
+    int *values = NULL;
+    resolveDataPath(path, sizeof(path), cg->source_path, args->name);
+    recordLoadedFile(cg, path);
+    double start = traceNowUs();
+    int status = loadIntegers(path, cg->arena, &values, count, reason, sizeof(reason));
+    traceSpan("load data", "compile", start, "\"values\": %d", status == 0 ? *count : 0);
+    if (status != 0) {
+        reportErrorAtLine(cg, cg->line, "Cannot load '%s': %s", args->name, reason);
+        return NULL;
+    }
+    return values;
+}
+
+// random(n, seed) and friends; NULL after reporting an error
+static int *generateDataset(CodegenContext *cg, const ArrayGenerator *gen, ASTNode *args, int *count) {
+    int values[GENERATOR_MAX_ARGS];
+    int argc = 0;
+    for (ASTNode *arg = args; arg; arg = arg->right) {
+        if (arg->type != NUMBER_NODE || argc == gen->arity) {
+            argc = -1;
+            break;
+        }
+        values[argc++] = arg->number;
+    }
+    if (argc != gen->arity) {
+        reportErrorAtLine(cg, cg->line, "Expected %s with integer arguments", gen->usage);
+        return NULL;
+    }
+    char reason[160];
+    int *out = runArrayGenerator(gen, values, cg->arena, reason, sizeof(reason));
+    if (!out) {
+        reportErrorAtLine(cg, cg->line, "Invalid %s: %s", gen->usage, reason);
+        return NULL;
+    }
+    *count = values[0];
+    return out;
+}
+
+// arr[] = init(args); the values are kept on the declaration for vmCompile
+static void evaluateArrayInit(CodegenContext *cg, ASTNode *decl) {
+    ASTNode *init = decl->left;
+    int count = 0;
+    int *values = NULL;
+    const ArrayGenerator *gen = init->symbol ? findArrayGenerator(init->symbol->id) : NULL;
+    if (gen) {
+        values = generateDataset(cg, gen, init->left, &count);
+    } else if (init->symbol && init->symbol->id == SYM_LOAD) {
+        values = loadDataset(cg, init->left, &count);
+    } else {
+        reportErrorAtLine(cg, cg->line, "Unknown array initializer: '%s'. Valid initializers are: "
+                          "load, random, sorted, reversed, nearly_sorted, few_unique, organ_pipe",
+                          init->name ? init->name : "");
+        return;
+    }
+    if (!values) return;
+    if (count == 0) {
+        reportErrorAtLine(cg, cg->line, "Array initializer '%s' produced no values", init->name);
+        return;
+    }
+    decl->array_values = values;
+    decl->array_count = count;
+    cg->dsl_array = values;
+    cg->dsl_array_size = count;
+}
+
+// graph.load("edges.csv"): consecutive value pairs become add_edge operations
+static void loadGraphEdges(CodegenContext *cg, CodegenTrack *track, ASTNode *args) {
+    int count = 0;
+    int *values = loadDataset(cg, args, &count);
+    if (!values) return;
+    if (count % 2 != 0) {
+        reportErrorAtLine(cg, cg->line, "Edge list '%s' has an odd number of values (%d)", args->name, count);
+        return;
+    }
+    const Symbol *add_edge = internSymbol(cg->symbols, "add_edge", strlen("add_edge"));
+    if (!add_edge) {
+        reportErrorAtLine(cg, cg->line, "Out of memory loading '%s'", args->name);
+        return;
+    }
+    for (int i = 0; i < count; i += 2) {
+        if (addOperation(cg, track, add_edge, 2, values[i], values[i + 1]) != 0) return;
+    }
+}
+
+static void collectDSLInfo(CodegenContext *cg, ASTNode *node) {
     if (!node) return;
     
-    static int node_count = 0;  // Track node position as proxy for line
-    
     for (ASTNode *curr = node; curr != NULL; curr = curr->right) {
-        node_count++;
+        cg->node_count++;
+        if (curr->line) cg->line = curr->line;
         
         switch (curr->type) {
             case ARRAY_DECL_NODE:
-                // Extract array values
-                if (curr->array_values && curr->array_count > 0) {
-                    dsl_array_size = curr->array_count;
-                    for (int i = 0; i < curr->array_count && i < 256; i++) {
-                        dsl_array[i] = curr->array_values[i];
-                    }
+                // Extract array values (literal values already live in the arena)
+                if (curr->left) {
+                    evaluateArrayInit(cg, curr);
+                } else if (curr->array_values && curr->array_count > 0) {
+                    cg->dsl_array = curr->array_values;
+                    cg->dsl_array_size = curr->array_count;
                 }
                 // Validate array declaration
                 if (!curr->name || curr->name[0] == '\0') {
-                    reportErrorAtLine(node_count, "Invalid array declaration: missing array name");
+                    reportErrorAtLine(cg, cg->line, "Invalid array declaration: missing array name");
                 }
                 break;
             case ALGORITHM_CALL_NODE:
+                if (findBuiltin(curr->symbol, BUILTIN_INTRINSIC) && !curr->method) break;  // See compileStatements
                 // Check if it's a data structure operation (obj.method format)
-                if (curr->name && strchr(curr->name, '.')) {
-                    // Parse as data_structure.operation
-                    char ds_name[64];
-                    char op_name[64];
-                    if (sscanf(curr->name, "%[^.].%s", ds_name, op_name) == 2) {
-                        strncpy(ds_type, ds_name, sizeof(ds_type) - 1);
-                        
-                        // Extract argument values (arguments are linked via 'right')
-                        int val = 0, val2 = 0;
-                        ASTNode *arg = curr->left;
-                        if (arg) {
-                            val = extractNumberFromAST(arg);
-                            // Second argument if exists
-                            if (arg->right) {
-                                val2 = extractNumberFromAST(arg->right);
-                            }
+                if (curr->symbol && curr->method) {
+                    CodegenTrack *track = structureTrack(cg, curr->symbol);
+                    if (!track) break;
+                    if (curr->symbol->id == SYM_GRAPH && curr->method->id == SYM_LOAD) {
+                        loadGraphEdges(cg, track, curr->left);
+                        break;
+                    }
+                    
+                    // Extract argument values (arguments are linked via 'right')
+                    int val = 0, val2 = 0, argc = 0;
+                    ASTNode *arg = curr->left;
+                    if (arg) {
+                        val = extractNumberFromAST(arg);
+                        // Second argument if exists
+                        if (arg->right) {
+                            val2 = extractNumberFromAST(arg->right);
                         }
-                        
-                        addOperation(op_name, val, val2);
-                    } else {
-                        reportErrorAtLine(node_count, "Invalid data structure operation format: expected 'structure.operation(args)'");
                     }
-                } else if (curr->name) {
-                    // Regular algorithm call - validate it has an argument
-                    strncpy(algorithm_to_generate, curr->name, sizeof(algorithm_to_generate) - 1);
-                    algorithm_to_generate[sizeof(algorithm_to_generate) - 1] = '\0';
+                    for (; arg; arg = arg->right) argc++;
+                    
+                    addOperation(cg, track, curr->method, argc, val, val2);
+                } else if (curr->symbol) {
+                    // Regular algorithm call: a track of its own, sorting
+                    // the array declared so far
+                    CodegenTrack *track = addTrack(cg);
+                    if (!track) break;
+                    track->algorithm = curr->symbol;
+                    for (ASTNode *arg = curr->left; arg; arg = arg->right) track->argc++;
+                    if (curr->left) track->option_arg = curr->left->right;
+                    if (cg->dsl_array_size > 0) {
+                        track->array = cg->dsl_array;
+                        track->array_size = cg->dsl_array_size;
+                    }
                     
                     // Validate that array exists for algorithm calls
-                    if (dsl_array_size == 0 && curr->left == NULL) {
-                        reportErrorAtLine(node_count, "Algorithm '%s' called without array argument. Use: %s(array_var)", 
+                    if (cg->dsl_array_size == 0 && curr->left == NULL) {
+                        reportErrorAtLine(cg, cg->line, "Algorithm '%s' called without array argument. Use: %s(array_var)", 
                                         curr->name, curr->name);
                     }
                 } else {
-                    reportErrorAtLine(node_count, "Invalid function call: missing function name");
+                    reportErrorAtLine(cg, cg->line, "Invalid function call: missing function name");
                 }
                 break;
             case ASSIGN_NODE:
                 // Validate assignment
                 if (!curr->name || curr->name[0] == '\0') {
-                    reportErrorAtLine(node_count, "Invalid assignment: missing variable name");
+                    reportErrorAtLine(cg, cg->line, "Invalid assignment: missing variable name");
                 }
                 break;
             default:
                 // Recursively process children
-                if (curr->body) collectDSLInfo(curr->body);
-                if (curr->left) collectDSLInfo(curr->left);
+                if (curr->body) collectDSLInfo(cg, curr->body);
+                if (curr->left) collectDSLInfo(cg, curr->left);
                 break;
         }
         
-        if (has_error) break;  // Stop on first error
+        if (cg->has_error) break;  // Stop on first error
     }
 }
 
-static void generateBubbleSortSteps(int n, int *array) {
-    int working_array[256];
-    for (int k = 0; k < n; k++) {
-        working_array[k] = array[k];
-    }
-    
-    for (int pass = 0; pass < n - 1; pass++) {
-        for (int i = 0; i < n - pass - 1; i++) {
-            int j = i + 1;
-            int compare_indices[2] = {i, j};
-            addIRWithIndices("compare", "", compare_indices, 2);
-            
-            if (working_array[i] > working_array[j]) {
-                addIRWithIndices("swap", "", compare_indices, 2);
-                int temp = working_array[i];
-                working_array[i] = working_array[j];
-                working_array[j] = temp;
-            } else {
-                addIRWithIndices("no_swap", "", compare_indices, 2);
-            }
-        }
-        int sorted_index = n - pass - 1;
-        addIRWithIndices("mark_sorted", "", &sorted_index, 1);
+// Generators sort a private copy so the declared array stays intact
+static int *copyWorkingArray(CodegenContext *cg, const int *array, int n) {
+    int *copy = (int *)malloc((size_t)(n > 0 ? n : 1) * sizeof(int));
+    if (!copy) {
+        reportError(cg, "Out of memory for a %d-element array", n);
+        return NULL;
     }
+    if (n > 0) memcpy(copy, array, (size_t)n * sizeof(int));
+    return copy;
 }
 
-static void generateInsertionSortSteps(int n, int *array) {
-    int working_array[256];
-    for (int k = 0; k < n; k++) {
-        working_array[k] = array[k];
+// Checked by the sorting generators once per pass, so a huge array cannot
+// run away with the step limit or the clock. Reports the error.
+static int pastLimits(CodegenContext *cg) {
+    if (cg->limits.steps > 0 && cg->ir->stepCount > cg->limits.steps) {
+        reportError(cg, "%s produced more than %d steps", cg->ir->algorithmName, cg->limits.steps);
+        return 1;
     }
-    
-    for (int i = 1; i < n; i++) {
-        int key = working_array[i];
-        int j = i - 1;
-        
-        // Show current element being inserted
-        int current_indices[2] = {i, j};
-        addIRWithIndices("compare", "", current_indices, 2);
-        
-        while (j >= 0 && working_array[j] > key) {
-            int compare_indices[2] = {j, j + 1};
-            addIRWithIndices("compare", "", compare_indices, 2);
-            
-            // Shift element
-            working_array[j + 1] = working_array[j];
-            int shift_indices[2] = {j, j + 1};
-            addIRWithIndices("swap", "", shift_indices, 2);
-            j--;
-        }
-        
-        working_array[j + 1] = key;
-        
-        // Mark sorted position
-        int sorted_index = i;
-        addIRWithIndices("mark_sorted", "", &sorted_index, 1);
+    if (cg->deadline_ms > 0 && monotonicMs() >= cg->deadline_ms) {
+        reportError(cg, "%s did not finish within %.0f ms", cg->ir->algorithmName, cg->limits.timeoutMs);
+        return 1;
     }
+    return 0;
 }
 
-static void generateSelectionSortSteps(int n, int *array) {
-    int working_array[256];
-    for (int k = 0; k < n; k++) {
-        working_array[k] = array[k];
-    }
-    
-    for (int i = 0; i < n - 1; i++) {
-        int min_idx = i;
-        
-        // Find minimum element
-        for (int j = i + 1; j < n; j++) {
-            int compare_indices[2] = {min_idx, j};
-            addIRWithIndices("compare", "", compare_indices, 2);
-            
-            if (working_array[j] < working_array[min_idx]) {
-                min_idx = j;
-                addIRWithIndices("no_swap", "", compare_indices, 2);
-            } else {
-                addIRWithIndices("no_swap", "", compare_indices, 2);
-            }
-        }
-        
-        // Swap minimum with current position
-        if (min_idx != i) {
-            int swap_indices[2] = {i, min_idx};
-            addIRWithIndices("swap", "", swap_indices, 2);
-            int temp = working_array[i];
-            working_array[i] = working_array[min_idx];
-            working_array[min_idx] = temp;
-        }
-        
-        // Mark sorted position
-        addIRWithIndices("mark_sorted", "", &i, 1);
+// A step the track could not keep leaves a trace with a hole in it, so it
+// fails the compile. Reports the error.
+static int recordFailed(CodegenContext *cg, const IRSink *sink) {
+    if (sink->status == IR_TOO_MANY_ACTIONS) {
+        reportError(cg, "%s used more than %d distinct actions", cg->ir->algorithmName, IR_MAX_ACTIONS);
+    } else if (sink->status != 0) {
+        reportError(cg, "Out of memory recording the steps of %s", cg->ir->algorithmName);
     }
+    return sink->status != 0;
 }
 
-static void generateMergeSortSteps(int n, int *array) {
-    int working_array[256];
-    for (int k = 0; k < n; k++) {
-        working_array[k] = array[k];
-    }
-    
-    // Merge sort visualization - top-down approach
-    // For visualization, we'll show the divide and merge steps
-    int step = 1;
-    while (step < n) {
-        for (int left = 0; left < n - step; left += 2 * step) {
-            int mid = left + step - 1;
-            int right = (left + 2 * step - 1 < n) ? (left + 2 * step - 1) : (n - 1);
-            
-            // Merge the two halves
-            int temp[256];
-            int i = left, j = mid + 1, k = 0;
-            
-            while (i <= mid && j <= right) {
-                int compare_indices[2] = {i, j};
-                addIRWithIndices("compare", "", compare_indices, 2);
-                
-                if (working_array[i] <= working_array[j]) {
-                    temp[k++] = working_array[i++];
-                    addIRWithIndices("no_swap", "", compare_indices, 2);
-                } else {
-                    temp[k++] = working_array[j++];
-                    addIRWithIndices("swap", "", compare_indices, 2);
-                }
-            }
-            
-            while (i <= mid) {
-                temp[k++] = working_array[i++];
-            }
-            
-            while (j <= right) {
-                temp[k++] = working_array[j++];
-            }
-            
-            // Copy merged array back
-            for (i = left, k = 0; i <= right; i++, k++) {
-                working_array[i] = temp[k];
-            }
-        }
-        step *= 2;
-    }
+// Lets the engine's sorts stop at the step limit and the clock
+typedef struct {
+    IRSink sink;
+    CodegenContext *cg;
+} CodegenSink;
+
+static int codegenSinkStopped(TraceSink *sink) {
+    CodegenSink *s = (CodegenSink *)sink;
+    return s->sink.status != 0 || pastLimits(s->cg);
 }
 
-static void generateQuickSortSteps(int n, int *array) {
-    int working_array[256];
-    for (int k = 0; k < n; k++) {
-        working_array[k] = array[k];
+static void generateSortSteps(CodegenContext *cg, const Builtin *builtin, int n, const int *array) {
+    int *working_array = copyWorkingArray(cg, array, n);
+    if (!working_array) return;
+    CodegenSink sink;
+    ir_sink_init(&sink.sink, cg->ir);
+    sink.sink.base.stopped = codegenSinkStopped;
+    sink.cg = cg;
+    int status = builtin->tuned ? builtin->tuned(working_array, n, cg->sort_option, &sink.sink.base)
+                                : builtin->sort(working_array, n, &sink.sink.base);
+    // A step the track could not keep stops the sort, which then returns 0
+    if (recordFailed(cg, &sink.sink)) {
+        free(working_array);
+        return;
     }
-    
-    // Quick sort visualization - using iterative approach with stack
-    typedef struct { int low; int high; } Range;
-    Range stack[256];
-    int top = 0;
-    
-    stack[top].low = 0;
-    stack[top].high = n - 1;
-    top++;
-    
-    while (top > 0) {
-        top--;
-        int low = stack[top].low;
-        int high = stack[top].high;
-        
-        if (low < high) {
-            // Partition
-            int pivot = working_array[high];
-            int i = low - 1;
-            
-            // Show pivot selection
-            int pivot_index = high;
-            addIRWithIndices("compare", "", &pivot_index, 1);
-            
-            for (int j = low; j < high; j++) {
-                int compare_indices[2] = {j, high};
-                addIRWithIndices("compare", "", compare_indices, 2);
-                
-                if (working_array[j] < pivot) {
-                    i++;
-                    if (i != j) {
-                        int swap_indices[2] = {i, j};
-                        addIRWithIndices("swap", "", swap_indices, 2);
-                        int temp = working_array[i];
-                        working_array[i] = working_array[j];
-                        working_array[j] = temp;
-                    } else {
-                        addIRWithIndices("no_swap", "", compare_indices, 2);
-                    }
-                } else {
-                    addIRWithIndices("no_swap", "", compare_indices, 2);
-                }
-            }
-            
-            // Place pivot in correct position
-            int swap_indices[2] = {i + 1, high};
-            addIRWithIndices("swap", "", swap_indices, 2);
-            int temp = working_array[i + 1];
-            working_array[i + 1] = working_array[high];
-            working_array[high] = temp;
-            
-            int pivot_pos = i + 1;
-            addIRWithIndices("mark_sorted", "", &pivot_pos, 1);
-            
-            // Push sub-arrays to stack
-            if (i + 1 + 1 < high) {
-                stack[top].low = i + 2;
-                stack[top].high = high;
-                top++;
-            }
-            if (low < i + 1 - 1) {
-                stack[top].low = low;
-                stack[top].high = i;
-                top++;
-            }
-        }
+    if (status == PARALLEL_TRUNCATED) {
+        reportError(cg, "%s produced more than %d steps in one parallel phase", cg->ir->algorithmName,
+                    PARALLEL_PHASE_STEPS);
+    } else if (status != 0) {
+        reportError(cg, "Out of memory for a %d-element array", n);
     }
+    free(working_array);
 }
 
-static void generateStackOperations(ASTNode *operations) {
-    // Stack visualization: LIFO operations
-    int stack[256];
-    int top = -1;
-    int step = 0;
-    
-    OperationNode *op = ds_operations;
-    while (op) {
-        if (strcmp(op->operation, "push") == 0) {
-            top++;
-            stack[top] = op->value;
-            // Push action: element added at top
-            int indices[2] = {top, op->value};
-            addIRWithIndices("push", "", indices, 2);
-        } else if (strcmp(op->operation, "pop") == 0) {
-            if (top >= 0) {
-                int val = stack[top];
-                int indices[2] = {top, val};
-                addIRWithIndices("pop", "", indices, 2);
-                top--;
-            }
-        } else if (strcmp(op->operation, "peek") == 0 || strcmp(op->operation, "top") == 0) {
-            if (top >= 0) {
-                int indices[1] = {top};
-                addIRWithIndices("peek", "", indices, 1);
+// The structure generators replay the recorded operations through the
+// engine, which writes the steps. The limits are checked after every
+// operation: one operation's steps are bounded by the structure's size, so
+// a long run of them (a loaded graph searched again and again) stops
+// within one operation of the limit.
+
+static void generateStackOperations(CodegenContext *cg) {
+    IRSink sink;
+    Stack stack;
+    ir_sink_init(&sink, cg->ir);
+    stack_init(&stack);
+    for (OperationNode *op = cg->ds_operations; op; op = op->next) {
+        if (op->operation->id == SYM_PUSH) {
+            if (stack_push(&stack, op->value, &sink.base) != 0) {
+                reportError(cg, "Out of memory for %d stack elements", stack.top + 2);
+                break;
             }
+        } else if (op->operation->id == SYM_POP) {
+            stack_pop(&stack, NULL, &sink.base);
+        } else if (op->operation->id == SYM_PEEK || op->operation->id == SYM_TOP) {
+            stack_peek(&stack, NULL, &sink.base);
         }
-        op = op->next;
+        if (recordFailed(cg, &sink) || pastLimits(cg)) break;
     }
+    stack_free(&stack);
 }
 
-static void generateQueueOperations(ASTNode *operations) {
-    // Queue visualization: FIFO operations
-    int queue[256];
-    int front = 0;
-    int rear = -1;
-    int size = 0;
-    
-    OperationNode *op = ds_operations;
-    while (op) {
-        if (strcmp(op->operation, "enqueue") == 0) {
-            rear++;
-            queue[rear] = op->value;
-            size++;
-            int indices[2] = {rear, op->value};
-            addIRWithIndices("enqueue", "", indices, 2);
-        } else if (strcmp(op->operation, "dequeue") == 0) {
-            if (size > 0) {
-                int val = queue[front];
-                int indices[2] = {front, val};
-                addIRWithIndices("dequeue", "", indices, 2);
-                front++;
-                size--;
+static void generateQueueOperations(CodegenContext *cg) {
+    IRSink sink;
+    Queue queue;
+    ir_sink_init(&sink, cg->ir);
+    queue_init(&queue);
+    for (OperationNode *op = cg->ds_operations; op; op = op->next) {
+        if (op->operation->id == SYM_ENQUEUE) {
+            if (queue_enqueue(&queue, op->value, &sink.base) != 0) {
+                reportError(cg, "Out of memory for %d queue elements", queue.rear + 2);
+                break;
             }
+        } else if (op->operation->id == SYM_DEQUEUE) {
+            queue_dequeue(&queue, NULL, &sink.base);
         }
-        op = op->next;
+        if (recordFailed(cg, &sink) || pastLimits(cg)) break;
     }
+    queue_free(&queue);
 }
 
-// Helper function to insert into BST and return tree structure info
-static TreeNode* insertTreeNode(TreeNode *root, int value, int *parent_val, int *is_left) {
-    if (root == NULL) {
-        TreeNode *new_node = (TreeNode *)malloc(sizeof(TreeNode));
-        new_node->value = value;
-        new_node->left = NULL;
-        new_node->right = NULL;
-        return new_node;
-    }
-    
-    *parent_val = root->value;
-    if (value < root->value) {
-        *is_left = 1;
-        root->left = insertTreeNode(root->left, value, parent_val, is_left);
-    } else {
-        *is_left = 0;
-        root->right = insertTreeNode(root->right, value, parent_val, is_left);
-    }
-    return root;
-}
-
-// Helper function for inorder traversal
-static void inorderTraversal(TreeNode *root, int *result, int *index) {
-    if (root == NULL) return;
-    inorderTraversal(root->left, result, index);
-    result[(*index)++] = root->value;
-    inorderTraversal(root->right, result, index);
-}
-
-// Helper function for preorder traversal
-static void preorderTraversal(TreeNode *root, int *result, int *index) {
-    if (root == NULL) return;
-    result[(*index)++] = root->value;
-    preorderTraversal(root->left, result, index);
-    preorderTraversal(root->right, result, index);
-}
-
-// Helper function for postorder traversal
-static void postorderTraversal(TreeNode *root, int *result, int *index) {
-    if (root == NULL) return;
-    postorderTraversal(root->left, result, index);
-    postorderTraversal(root->right, result, index);
-    result[(*index)++] = root->value;
-}
-
-// Helper to free tree
-static void freeTree(TreeNode *root) {
-    if (root == NULL) return;
-    freeTree(root->left);
-    freeTree(root->right);
-    free(root);
-}
-
-static void generateTreeOperations(ASTNode *operations) {
-    // Binary tree operations - build actual BST
-    TreeNode *root = NULL;
-    int tree_values[256];
-    int tree_size = 0;
-    
-    OperationNode *op = ds_operations;
-    while (op) {
-        if (strcmp(op->operation, "insert") == 0) {
-            int parent_val = -1;
-            int is_left = -1;
-            if (root == NULL) {
-                // Root insertion
-                int indices[4] = {op->value, -1, -1, 0}; // value, parent (none), side (none), depth
-                addIRWithIndices("insert", "", indices, 4);
-            } else {
-                // Find where to insert by simulating
-                int temp_parent = -1, temp_side = -1;
-                TreeNode *temp = root;
-                while (1) {
-                    if (op->value < temp->value) {
-                        if (temp->left == NULL) {
-                            temp_parent = temp->value;
-                            temp_side = 1;
-                            break;
-                        }
-                        temp = temp->left;
-                    } else {
-                        if (temp->right == NULL) {
-                            temp_parent = temp->value;
-                            temp_side = 0;
-                            break;
-                        }
-                        temp = temp->right;
-                    }
-                }
-                int indices[4] = {op->value, temp_parent, temp_side, 0};
-                addIRWithIndices("insert", "", indices, 4);
-            }
-            // Actually insert into tree
-            root = insertTreeNode(root, op->value, &parent_val, &is_left);
-            tree_values[tree_size++] = op->value;
-        } else if (strcmp(op->operation, "traverse_inorder") == 0) {
-            int result[256];
-            int count = 0;
-            inorderTraversal(root, result, &count);
-            for (int i = 0; i < count; i++) {
-                int indices[1] = {result[i]};
-                addIRWithIndices("visit", "", indices, 1);
-            }
-        } else if (strcmp(op->operation, "traverse_preorder") == 0) {
-            int result[256];
-            int count = 0;
-            preorderTraversal(root, result, &count);
-            for (int i = 0; i < count; i++) {
-                int indices[1] = {result[i]};
-                addIRWithIndices("visit", "", indices, 1);
-            }
-        } else if (strcmp(op->operation, "traverse_postorder") == 0) {
-            int result[256];
-            int count = 0;
-            postorderTraversal(root, result, &count);
-            for (int i = 0; i < count; i++) {
-                int indices[1] = {result[i]};
-                addIRWithIndices("visit", "", indices, 1);
-            }
+static void generateTreeOperations(CodegenContext *cg) {
+    IRSink sink;
+    BST tree;
+    ir_sink_init(&sink, cg->ir);
+    bst_init(&tree);
+    for (OperationNode *op = cg->ds_operations; op; op = op->next) {
+        int status = 0;
+        switch (op->operation->id) {
+            case SYM_INSERT: status = bst_insert(&tree, op->value, &sink.base); break;
+            case SYM_TRAVERSE_INORDER: status = bst_traverse(&tree, BST_INORDER, &sink.base); break;
+            case SYM_TRAVERSE_PREORDER: status = bst_traverse(&tree, BST_PREORDER, &sink.base); break;
+            case SYM_TRAVERSE_POSTORDER: status = bst_traverse(&tree, BST_POSTORDER, &sink.base); break;
+            default: break;
+        }
+        if (status != 0) {
+            reportError(cg, "Out of memory for %d tree nodes", tree.size + 1);
+            break;
         }
-        op = op->next;
+        if (recordFailed(cg, &sink) || pastLimits(cg)) break;
     }
     
     // Store tree values in array for visualization
-    if (tree_size > 0) {
-        setArray(tree_values, tree_size);
+    if (tree.size > 0 && !cg->has_error) {
+        setArray(cg->ir, tree.values, tree.size);
     }
-    
-    freeTree(root);
+    bst_free(&tree);
 }
 
-static void generateGraphOperations(ASTNode *operations) {
-    // Graph operations: nodes, edges, and traversals
-    int nodes[256];
-    int node_count = 0;
-    int edges[256][2];
-    int edge_count = 0;
-    
-    OperationNode *op = ds_operations;
-    while (op) {
-        if (strcmp(op->operation, "add_node") == 0) {
-            nodes[node_count++] = op->value;
-            int indices[1] = {op->value};
-            addIRWithIndices("add_node", "", indices, 1);
-        } else if (strcmp(op->operation, "add_edge") == 0) {
-            edges[edge_count][0] = op->value;
-            edges[edge_count][1] = op->value2;
-            edge_count++;
-            int indices[2] = {op->value, op->value2};
-            addIRWithIndices("add_edge", "", indices, 2);
-        } else if (strcmp(op->operation, "bfs") == 0) {
-            // BFS traversal starting from op->value
-            int start = op->value;
-            int indices[1] = {start};
-            addIRWithIndices("bfs_start", "", indices, 1);
-            
-            // Simulate BFS: visit nodes level by level
-            int visited[256] = {0};
-            int queue[256];
-            int q_front = 0, q_rear = -1;
-            
-            visited[start] = 1;
-            queue[++q_rear] = start;
-            addIRWithIndices("visit", "", indices, 1);
-            
-            while (q_front <= q_rear) {
-                int current = queue[q_front++];
-                
-                // Visit neighbors
-                for (int i = 0; i < edge_count; i++) {
-                    if (edges[i][0] == current && !visited[edges[i][1]]) {
-                        visited[edges[i][1]] = 1;
-                        queue[++q_rear] = edges[i][1];
-                        int visit_indices[1] = {edges[i][1]};
-                        addIRWithIndices("visit", "", visit_indices, 1);
-                    } else if (edges[i][1] == current && !visited[edges[i][0]]) {
-                        visited[edges[i][0]] = 1;
-                        queue[++q_rear] = edges[i][0];
-                        int visit_indices[1] = {edges[i][0]};
-                        addIRWithIndices("visit", "", visit_indices, 1);
-                    }
-                }
-            }
-        } else if (strcmp(op->operation, "dfs") == 0) {
-            // DFS traversal starting from op->value
-            int start = op->value;
-            int indices[1] = {start};
-            addIRWithIndices("dfs_start", "", indices, 1);
-            
-            // Simulate DFS using recursive approach (iterative with stack)
-            int visited[256] = {0};
-            int stack[256];
-            int top = -1;
-            
-            stack[++top] = start;
-            
-            while (top >= 0) {
-                int current = stack[top--];
-                if (!visited[current]) {
-                    visited[current] = 1;
-                    int visit_indices[1] = {current};
-                    addIRWithIndices("visit", "", visit_indices, 1);
-                    
-                    // Push neighbors
-                    for (int i = 0; i < edge_count; i++) {
-                        if (edges[i][0] == current && !visited[edges[i][1]]) {
-                            stack[++top] = edges[i][1];
-                        } else if (edges[i][1] == current && !visited[edges[i][0]]) {
-                            stack[++top] = edges[i][0];
-                        }
-                    }
-                }
+static void generateGraphOperations(CodegenContext *cg) {
+    // Node ids index the engine's adjacency tables, which are sized by the
+    // largest id, so they must lie in 0..GRAPH_MAX_NODE_ID
+    for (OperationNode *op = cg->ds_operations; op; op = op->next) {
+        int ids[2] = {op->value, op->value2};
+        int n = op->operation->id == SYM_ADD_EDGE ? 2 : 1;
+        for (int k = 0; k < n; k++) {
+            if (ids[k] < 0 || ids[k] > GRAPH_MAX_NODE_ID) {
+                reportError(cg, "Invalid graph node %d: node ids must be between 0 and %d", ids[k],
+                            GRAPH_MAX_NODE_ID);
+                return;
             }
         }
-        op = op->next;
     }
-}
 
-static void extractExprString(ASTNode *node, char *buffer, size_t bufSize) {
-    if (!node) {
-        buffer[0] = '\0';
-        return;
-    }
-    switch (node->type) {
-        case VALUE_NODE:
-            if (node->name) {
-                strncpy(buffer, node->name, bufSize - 1);
-                buffer[bufSize - 1] = '\0';
-            }
-            break;
-        case NUMBER_NODE:
-            snprintf(buffer, bufSize, "%d", node->number);
+    IRSink sink;
+    Graph graph;
+    ir_sink_init(&sink, cg->ir);
+    graph_init(&graph);
+    for (OperationNode *op = cg->ds_operations; op; op = op->next) {
+        int status = 0;
+        switch (op->operation->id) {
+            case SYM_ADD_NODE: graph_add_node(&graph, op->value, &sink.base); break;
+            case SYM_ADD_EDGE: status = graph_add_edge(&graph, op->value, op->value2, &sink.base); break;
+            case SYM_BFS: status = graph_bfs(&graph, op->value, &sink.base); break;
+            case SYM_DFS: status = graph_dfs(&graph, op->value, &sink.base); break;
+            default: break;
+        }
+        if (status != 0 && op->operation->id == SYM_ADD_EDGE) {
+            reportError(cg, "Out of memory for %d graph edges", graph.edge_count + 1);
             break;
-        default:
-            buffer[0] = '\0';
+        }
+        if (status != 0) {
+            reportError(cg, "Out of memory searching a graph of %d nodes and %d edges", graph.max_node + 1,
+                        graph.edge_count);
             break;
-    }
-}
-
-static void generateSequence(ASTNode *node) {
-    for (ASTNode *curr = node; curr != NULL; curr = curr->right) {
-        switch (curr->type) {
-            case ASSIGN_NODE: {
-                // Check if it's a swap call
-                if (curr->name && (strcmp(curr->name, "swap") == 0)) {
-                    // Generate swap action with current indices
-                    // Note: compare_index is managed by IF_NODE
-                    int indices[2] = {compare_index, compare_index + 1};
-                    addIRWithIndices("swap", "", indices, 2);
-                }
-                break;
-            }
-            case LOOP_NODE: {
-                loop_depth++;
-                compare_index = 0;  // Reset for new loop iteration
-                if (curr->body) generateSequence(curr->body);
-                
-                // After loop ends, mark last element as sorted
-                if (loop_depth > 0) {
-                    // Use array length - loop_depth as the sorted index
-                    int index = 4 - loop_depth;  // Simplified - would need actual array size
-                    if (index >= 0) {
-                        addIRWithIndices("mark_sorted", "", &index, 1);
-                    }
-                }
-                
-                loop_depth--;
-                break;
-            }
-            case IF_NODE: {
-                // IF condition - generate compare action
-                if (loop_depth > 0) {
-                    int indices[2] = {compare_index, compare_index + 1};
-                    addIRWithIndices("compare", "", indices, 2);
-                }
-                
-                // Process body (which will contain swap or no_swap)
-                int had_swap = 0;
-                if (curr->body) {
-                    // Check if body contains swap
-                    for (ASTNode *body_node = curr->body; body_node; body_node = body_node->right) {
-                        if (body_node->type == ASSIGN_NODE && 
-                            body_node->name && strcmp(body_node->name, "swap") == 0) {
-                            had_swap = 1;
-                break;
-                        }
-                    }
-                    generateSequence(curr->body);
-                }
-                
-                // If no swap happened, add no_swap
-                if (!had_swap && loop_depth > 0) {
-                    int indices[2] = {compare_index, compare_index + 1};
-                    addIRWithIndices("no_swap", "", indices, 2);
-                }
-                
-                // Increment compare_index after processing this if block
-                if (loop_depth > 0) {
-                    compare_index++;
-                }
-                break;
-            }
-            case VALUE_NODE:
-            case NUMBER_NODE:
-            case SEQ_NODE:
-            default:
-                // No direct IR action
-                break;
         }
+        if (recordFailed(cg, &sink) || pastLimits(cg)) break;
     }
+    graph_free(&graph);
 }
-
-
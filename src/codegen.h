@@ -1,10 +1,74 @@
 #ifndef CODEGEN_H
 #define CODEGEN_H
 
+#include "arena.h"
 #include "ast.h"
+#include "ir.h"
+#include "symbols.h"
+#include "vm.h"
 
-void generateCode(ASTNode *node);
-int hasGenerationError(void);
+struct OperationNode;
+struct CodegenTrack;
 
-#endif
+// A file the program read with load(), as resolved against the source
+typedef struct LoadedFile {
+    const char *path;
+    struct LoadedFile *next;
+} LoadedFile;
+
+// Semantic analysis and step-generation state for one compilation
+typedef struct CodegenContext {
+    IRContext *ir;                      // Destination for generated steps
+    Arena *arena;                       // Compilation arena (loaded datasets)
+    SymbolTable *symbols;               // Compilation symbol table
+    const char *source_path;            // For resolving load("file") paths
+    LoadedFile *loaded_files;           // Every load() analysed, readable or not (arena-owned)
+    int *dsl_array;                     // Array declared in the DSL (arena-owned)
+    int dsl_array_size;
+    struct CodegenTrack *tracks;        // One per algorithm call or data structure
+    int track_count;
+    int track_capacity;
+    int track_threads;                  // Generate tracks on this many threads
+    // The track being validated or generated
+    const Symbol *algorithm_to_generate;  // Algorithm called, or NULL
+    int sort_option;                    // Its option (shell_sort gaps, radix_sort digit bits)
+    struct OperationNode *ds_operations;
+    const Symbol *ds_type;              // Object of the method calls
+    const VMProgram *program;           // The program's own statements
+    VMLimits limits;                    // Bounds on generating the steps
+    double deadline_ms;                 // monotonicMs() at which generation stops (0 = none)
+    int quiet;                          // Record diagnostics without printing them
+    int has_error;
+    char error_message[256];            // First semantic error, for summaries
+    int semantic_error_line;
+    int line;                           // Source line of the statement being analysed
+    int node_count;                     // Nodes visited by the analysis
+} CodegenContext;
+
+// `arena` and `symbols` are the compilation's; `source_path` may be NULL
+void initCodegen(CodegenContext *cg, IRContext *ir, Arena *arena, SymbolTable *symbols,
+                 const char *source_path);
+void generateCode(CodegenContext *cg, ASTNode *node);
+int hasGenerationError(const CodegenContext *cg);
+
+// generateCode in two stages, so callers can act on the analysed program
+// before paying for step generation. analyzeProgram collects and validates
+// what to generate (returns 0, or -1 after reporting an error);
+// generateSteps then emits the steps into the IR, one track per algorithm
+// call or data structure, generated concurrently.
+int analyzeProgram(CodegenContext *cg, ASTNode *node);
+void generateSteps(CodegenContext *cg);
+void freeCodegen(CodegenContext *cg);
 
+// Bump whenever a generator's output changes, so cached traces keyed by
+// programKey stop matching
+#define CODEGEN_OUTPUT_VERSION 5
+#define PROGRAM_KEY_SIZE 33
+
+// 32 hex digits identifying the analysed program by what it generates:
+// each track's algorithm and input array, data structure operations, or
+// statement bytecode and arrays.
+// Programs differing only in layout, names or dead statements share a key.
+void programKey(const CodegenContext *cg, char key[PROGRAM_KEY_SIZE]);
+
+#endif
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "compiler.h"
+#include "traceevents.h"
+
+void initCompilerContext(CompilerContext *ctx, const char *filename) {
+    ctx->filename = filename;
+    arenaInit(&ctx->arena);
+    initSymbolTable(&ctx->symbols, &ctx->arena);  // parseFile reports a failure
+    ctx->root = NULL;
+    ctx->column = 1;
+    ctx->quiet = 0;
+    ctx->errorMessage[0] = '\0';
+    ctx->cache = NULL;
+    ctx->cacheHit = 0;
+    ctx->tokenCount = 0;
+    ctx->lexUs = 0.0;
+    initIR(&ctx->ir);
+    initCodegen(&ctx->codegen, &ctx->ir, &ctx->arena, &ctx->symbols, filename);
+}
+
+void freeCompilerContext(CompilerContext *ctx) {
+    // The whole AST goes with the arena; no per-node walk
+    freeCodegen(&ctx->codegen);
+    freeSymbolTable(&ctx->symbols);
+    arenaRelease(&ctx->arena);
+    ctx->root = NULL;
+    resetIR(&ctx->ir);
+}
+
+void setCompilerQuiet(CompilerContext *ctx, int quiet) {
+    ctx->quiet = quiet;
+    ctx->codegen.quiet = quiet;
+}
+
+void setCompilerCache(CompilerContext *ctx, const TraceCache *cache) {
+    ctx->cache = cache;
+}
+
+void setCompilerThreads(CompilerContext *ctx, int threads) {
+    ctx->codegen.track_threads = threads > 0 ? threads : 1;
+}
+
+void setCompilerLimits(CompilerContext *ctx, const VMLimits *limits) {
+    if (limits) ctx->codegen.limits = *limits;
+}
+
+void reportCompileError(CompilerContext *ctx, const char *format, ...) {
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (ctx->errorMessage[0] == '\0') {
+        snprintf(ctx->errorMessage, sizeof(ctx->errorMessage), "%s", message);
+    }
+    if (!ctx->quiet) {
+        fprintf(stderr, "%s\n", message);
+    }
+}
+
+const char *compileErrorMessage(const CompilerContext *ctx) {
+    if (ctx->errorMessage[0] != '\0') return ctx->errorMessage;
+    return ctx->codegen.error_message;
+}
+
+const char *compileStatusName(CompileStatus status) {
+    switch (status) {
+        case COMPILE_OK:             return "ok";
+        case COMPILE_IO_ERROR:       return "io_error";
+        case COMPILE_SYNTAX_ERROR:   return "syntax_error";
+        case COMPILE_SEMANTIC_ERROR: return "semantic_error";
+        case COMPILE_OUTPUT_ERROR:   return "output_error";
+    }
+    return "unknown";
+}
+
+static CompileStatus runPhases(CompilerContext *ctx, const char *outputPath);
+
+CompileStatus compileFile(CompilerContext *ctx, const char *outputPath) {
+    if (!traceEventsActive()) return runPhases(ctx, outputPath);
+    double start = traceNowUs();
+    CompileStatus status = runPhases(ctx, outputPath);
+    char file[256];
+    traceEscape(file, sizeof(file), ctx->filename);
+    traceSpan("compile", "compile", start, "\"file\": \"%s\", \"status\": \"%s\"",
+              file, compileStatusName(status));
+    traceCounter("allocations", "\"arena\": %zu, \"arena blocks\": %zu",
+                 ctx->arena.allocations, ctx->arena.blocks);
+    traceCounter("memory", "\"arena kB\": %zu, \"steps\": %d",
+                 ctx->arena.reserved / 1024, traceStepCount(&ctx->ir));
+    traceMemory();
+    return status;
+}
+
+static CompileStatus runPhases(CompilerContext *ctx, const char *outputPath) {
+    // Phase 0: File I/O Error Checking
+    double start = traceNowUs();
+    SourceFile source;
+    if (openSource(&source, ctx->filename) != 0) {
+        reportCompileError(ctx, "Error: Failed to open input file: %s", ctx->filename);
+        if (!ctx->quiet) {
+            fprintf(stderr, "  Check that the file exists and you have read permissions.\n");
+        }
+        return COMPILE_IO_ERROR;
+    }
+    traceSpan("read source", "compile", start, "\"bytes\": %zu", source.size);
+
+    if (!ctx->quiet) {
+        printf("Compiling: %s\n", ctx->filename);
+        printf("Phase 1: Lexical Analysis...\n");
+        // Phase 1: Lexical Analysis (handled by lexer)
+        // Phase 2: Syntax Analysis
+        printf("Phase 2: Syntax Analysis...\n");
+    }
+    start = traceNowUs();
+    int parsed = parseSource(ctx, &source);
+    closeSource(&source);
+    // Scanning is interleaved with parsing; its share is reported as a total
+    traceSpan("parse", "compile", start, "\"tokens\": %d, \"lex us\": %.1f", ctx->tokenCount, ctx->lexUs);
+    traceSpanFor("lex", "compile", start, ctx->lexUs, "\"tokens\": %d, \"aggregate\": true", ctx->tokenCount);
+    if (parsed != 0) {
+        if (!ctx->quiet) fprintf(stderr, "\nCompilation failed during syntax analysis.\n");
+        return COMPILE_SYNTAX_ERROR;
+    }
+
+    // Phase 3: Semantic Analysis
+    if (!ctx->quiet) printf("Phase 3: Semantic Analysis...\n");
+    if (!ctx->root) {
+        reportCompileError(ctx, "Error: No valid program structure found.");
+        return COMPILE_SEMANTIC_ERROR;
+    }
+
+    if (analyzeProgram(&ctx->codegen, ctx->root) != 0) {
+        if (!ctx->quiet) fprintf(stderr, "\nCompilation failed during semantic analysis.\n");
+        return COMPILE_SEMANTIC_ERROR;
+    }
+
+    // Phase 4: Code Generation, skipped when an identical program's trace
+    // is already cached
+    char key[PROGRAM_KEY_SIZE];
+    if (ctx->cache) {
+        start = traceNowUs();
+        programKey(&ctx->codegen, key);
+        ctx->cacheHit = fetchCachedTrace(ctx->cache, key, outputPath, ctx->codegen.limits.steps,
+                                         &ctx->ir.stepCount);
+        traceSpan("cache fetch", "cache", start, "\"hit\": %s", ctx->cacheHit ? "true" : "false");
+        if (ctx->cacheHit) {
+            if (!ctx->quiet) printf("Phase 4: Code Generation... (cached)\n");
+            return COMPILE_OK;
+        }
+    }
+    if (!ctx->quiet) printf("Phase 4: Code Generation...\n");
+    generateSteps(&ctx->codegen);
+    if (hasGenerationError(&ctx->codegen)) {
+        if (!ctx->quiet) fprintf(stderr, "\nCompilation failed during semantic analysis.\n");
+        return COMPILE_SEMANTIC_ERROR;
+    }
+    start = traceNowUs();
+    int written = writeIRToJSON(&ctx->ir, outputPath);
+    traceSpan("writeIRToJSON", "output", start, "\"steps\": %d", traceStepCount(&ctx->ir));
+    if (written != 0) {
+        // writeIRToJSON already reported the failure; keep it for summaries
+        snprintf(ctx->errorMessage, sizeof(ctx->errorMessage), "Failed to open %s for writing", outputPath);
+        return COMPILE_OUTPUT_ERROR;
+    }
+    if (ctx->cache) {
+        start = traceNowUs();
+        storeCachedTrace(ctx->cache, key, outputPath, traceStepCount(&ctx->ir));
+        traceSpan("cache store", "cache", start, NULL);
+    }
+    return COMPILE_OK;
+}
@@ -0,0 +1,64 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdio.h>
+#include "arena.h"
+#include "source.h"
+#include "symbols.h"
+#include "ast.h"
+#include "ir.h"
+#include "codegen.h"
+#include "tracecache.h"
+
+typedef enum {
+    COMPILE_OK = 0,
+    COMPILE_IO_ERROR,
+    COMPILE_SYNTAX_ERROR,
+    COMPILE_SEMANTIC_ERROR,
+    COMPILE_OUTPUT_ERROR
+} CompileStatus;
+
+// All state for compiling one .algo program. Nothing in the front end or
+// code generator is global, so independent contexts may run on separate
+// threads at the same time.
+typedef struct CompilerContext {
+    const char *filename;    // Source path used in diagnostics
+    Arena arena;             // Owns the AST and identifier strings
+    SymbolTable symbols;     // Each distinct identifier, interned once
+    ASTNode *root;           // Program produced by the parser
+    int column;              // Scanner column for lexical error reporting
+    int quiet;               // Suppress banners and diagnostics (batch mode)
+    char errorMessage[256];  // First lexical/syntax error, for summaries
+    const TraceCache *cache; // Reuse traces of identical programs (NULL = off)
+    int cacheHit;            // Trace was copied from the cache
+    int tokenCount;          // Tokens scanned
+    double lexUs;            // Time inside the scanner (only with trace events)
+    IRContext ir;            // Generated steps and trace metadata
+    CodegenContext codegen;  // Semantic analysis and generator state
+} CompilerContext;
+
+void initCompilerContext(CompilerContext *ctx, const char *filename);
+void freeCompilerContext(CompilerContext *ctx);
+void setCompilerQuiet(CompilerContext *ctx, int quiet);
+void setCompilerCache(CompilerContext *ctx, const TraceCache *cache);
+// Threads for generating a program's tracks (default: one per CPU)
+void setCompilerThreads(CompilerContext *ctx, int threads);
+// Bounds on running the program's statements and generating its steps
+// (NULL keeps the VM_DEFAULT_* limits)
+void setCompilerLimits(CompilerContext *ctx, const VMLimits *limits);
+
+// Run every phase on ctx->filename and write the trace to outputPath
+CompileStatus compileFile(CompilerContext *ctx, const char *outputPath);
+const char *compileStatusName(CompileStatus status);
+
+// First diagnostic recorded by any phase ("" if none)
+const char *compileErrorMessage(const CompilerContext *ctx);
+
+// Record a front-end diagnostic; printed to stderr unless ctx->quiet
+void reportCompileError(CompilerContext *ctx, const char *format, ...);
+
+// Scan and parse `src` into ctx->root, in place when it is buffered.
+// Defined alongside the scanner in lexer.l. Returns 0 on success.
+int parseSource(CompilerContext *ctx, SourceFile *src);
+
+#endif
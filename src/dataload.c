@@ -0,0 +1,175 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dataload.h"
+#include "source.h"
+
+void resolveDataPath(char *out, size_t size, const char *sourcePath, const char *path) {
+    int absolute = path[0] == '/' || path[0] == '\\' || (path[0] && path[1] == ':');
+    const char *slash = NULL;
+    if (!absolute && sourcePath && strcmp(sourcePath, "-") != 0) {
+        for (const char *p = sourcePath; *p; p++) {
+            if (*p == '/' || *p == '\\') slash = p;
+        }
+    }
+    if (slash) {
+        snprintf(out, size, "%.*s%s", (int)(slash - sourcePath + 1), sourcePath, path);
+    } else {
+        snprintf(out, size, "%s", path);
+    }
+}
+
+static int hasSuffix(const char *s, const char *suffix) {
+    size_t len = strlen(s), n = strlen(suffix);
+    return len >= n && strcmp(s + len - n, suffix) == 0;
+}
+
+// Streams (pipes, FIFOs) are slurped so both formats can work on one buffer
+static int readStream(SourceFile *src) {
+    size_t cap = 1 << 16, len = 0;
+    char *buf = (char *)malloc(cap);
+    if (!buf) return -1;
+    size_t got;
+    while ((got = fread(buf + len, 1, cap - len - 2, src->stream)) > 0) {
+        len += got;
+        if (cap - len - 2 == 0) {
+            char *grown = (char *)realloc(buf, cap * 2);
+            if (!grown) {
+                free(buf);
+                return -1;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+    }
+    buf[len] = buf[len + 1] = '\0';
+    if (src->stream != stdin) fclose(src->stream);
+    src->stream = NULL;
+    src->data = buf;
+    src->size = len;
+    return 0;
+}
+
+static int loadBinary(const SourceFile *src, Arena *arena, int **values, int *count,
+                      char *error, size_t errorSize) {
+    if (src->size % 4 != 0) {
+        snprintf(error, errorSize, "size %zu is not a multiple of 4 bytes (expected int32 values)", src->size);
+        return -1;
+    }
+    size_t n = src->size / 4;
+    if (n > INT_MAX) {
+        snprintf(error, errorSize, "too many values (%zu)", n);
+        return -1;
+    }
+    int *out = (int *)arenaAlloc(arena, (n ? n : 1) * sizeof(int));
+    if (!out) {
+        snprintf(error, errorSize, "out of memory for %zu values", n);
+        return -1;
+    }
+    const unsigned char *p = (const unsigned char *)src->data;
+    for (size_t i = 0; i < n; i++, p += 4) {
+        // Assembled byte-wise so big-endian hosts read the same file; this
+        // compiles to a plain load on little-endian machines
+        unsigned int v = (unsigned int)p[0] | (unsigned int)p[1] << 8 |
+                         (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24;
+        out[i] = (int)v;
+    }
+    *values = out;
+    *count = (int)n;
+    return 0;
+}
+
+static int isSeparator(char c) {
+    return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int loadText(const SourceFile *src, Arena *arena, int **values, int *count,
+                    char *error, size_t errorSize) {
+    const char *p = src->data;
+    const char *end = src->data + src->size;
+
+    // Pass 1: count tokens so the result is one exact arena allocation
+    size_t n = 0;
+    int inToken = 0;
+    for (const char *q = p; q < end; q++) {
+        int sep = isSeparator(*q);
+        if (!sep && !inToken) n++;
+        inToken = !sep;
+    }
+    if (n > INT_MAX) {
+        snprintf(error, errorSize, "too many values (%zu)", n);
+        return -1;
+    }
+    int *out = (int *)arenaAlloc(arena, (n ? n : 1) * sizeof(int));
+    if (!out) {
+        snprintf(error, errorSize, "out of memory for %zu values", n);
+        return -1;
+    }
+
+    // Pass 2: parse and validate
+    size_t i = 0;
+    int line = 1;
+    while (p < end) {
+        char c = *p;
+        if (isSeparator(c)) {
+            if (c == '\n') line++;
+            p++;
+            continue;
+        }
+        int negative = 0;
+        if (c == '-' || c == '+') {
+            negative = c == '-';
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') {
+            snprintf(error, errorSize, "unexpected character '%c' at line %d", p < end ? *p : c, line);
+            return -1;
+        }
+        long long v = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            v = v * 10 + (*p - '0');
+            if (v > (long long)INT_MAX + 1) {
+                snprintf(error, errorSize, "value out of int32 range at line %d", line);
+                return -1;
+            }
+            p++;
+        }
+        if (negative) v = -v;
+        if (v > INT_MAX) {
+            snprintf(error, errorSize, "value out of int32 range at line %d", line);
+            return -1;
+        }
+        if (p < end && !isSeparator(*p)) {
+            snprintf(error, errorSize, "unexpected character '%c' at line %d", *p, line);
+            return -1;
+        }
+        out[i++] = (int)v;
+    }
+    *values = out;
+    *count = (int)i;
+    return 0;
+}
+
+int loadIntegers(const char *path, Arena *arena, int **values, int *count,
+                 char *error, size_t errorSize) {
+    SourceFile src;
+    if (openSource(&src, path) != 0) {
+        snprintf(error, errorSize, "%s", strerror(errno));
+        return -1;
+    }
+    if (!src.data && readStream(&src) != 0) {
+        closeSource(&src);
+        snprintf(error, errorSize, "read failed");
+        return -1;
+    }
+    int result;
+    if (hasSuffix(path, ".bin") || hasSuffix(path, ".i32")) {
+        result = loadBinary(&src, arena, values, count, error, errorSize);
+    } else {
+        result = loadText(&src, arena, values, count, error, errorSize);
+    }
+    closeSource(&src);
+    return result;
+}
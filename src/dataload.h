@@ -0,0 +1,20 @@
+#ifndef DATALOAD_H
+#define DATALOAD_H
+
+#include <stddef.h>
+#include "arena.h"
+
+// Datasets for load("file"). Files ending in .bin or .i32 hold raw
+// little-endian int32 values; anything else is text with integers separated
+// by commas, semicolons or whitespace (CSV, one value per line, ...).
+
+// Resolves `path` against the directory of the .algo file that names it.
+// Absolute paths and programs read from stdin ("-") use `path` unchanged.
+void resolveDataPath(char *out, size_t size, const char *sourcePath, const char *path);
+
+// Reads every value into a fresh array in `arena`. Returns 0 on success;
+// otherwise -1 with a reason in `error`.
+int loadIntegers(const char *path, Arena *arena, int **values, int *count,
+                 char *error, size_t errorSize);
+
+#endif
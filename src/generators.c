@@ -0,0 +1,129 @@
+#include <stdint.h>
+#include <stdio.h>
+#include "generators.h"
+
+static const ArrayGenerator generators[] = {
+    {SYM_RANDOM, "random(n, seed)", 2},
+    {SYM_SORTED, "sorted(n)", 1},
+    {SYM_REVERSED, "reversed(n)", 1},
+    {SYM_NEARLY_SORTED, "nearly_sorted(n, swaps, seed)", 3},
+    {SYM_FEW_UNIQUE, "few_unique(n, k, seed)", 3},
+    {SYM_ORGAN_PIPE, "organ_pipe(n)", 1},
+};
+
+const ArrayGenerator *findArrayGenerator(int id) {
+    for (size_t i = 0; i < sizeof(generators) / sizeof(generators[0]); i++) {
+        if ((int)generators[i].id == id) return &generators[i];
+    }
+    return NULL;
+}
+
+// xoshiro256** (Blackman & Vigna), seeded through splitmix64 so that
+// small, similar seeds still start from well-mixed states
+typedef struct Rng {
+    uint64_t s[4];
+} Rng;
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15u);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+    return z ^ (z >> 31);
+}
+
+static void seedRng(Rng *rng, int seed) {
+    uint64_t x = (uint64_t)(uint32_t)seed;
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&x);
+    }
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t nextRng(Rng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// Uniform in [0, bound): Lemire's multiply-shift with rejection, which
+// avoids a division on almost every call
+static inline uint32_t boundedRng(Rng *rng, uint32_t bound) {
+    uint64_t m = (uint64_t)(uint32_t)(nextRng(rng) >> 32) * bound;
+    uint32_t low = (uint32_t)m;
+    if (low < bound) {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            m = (uint64_t)(uint32_t)(nextRng(rng) >> 32) * bound;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+int *runArrayGenerator(const ArrayGenerator *gen, const int *args, Arena *arena,
+                       char *error, size_t errorSize) {
+    int n = args[0];
+    if (n < 1 || n > GENERATOR_MAX_ELEMENTS) {
+        snprintf(error, errorSize, "n must be between 1 and %d, got %d", GENERATOR_MAX_ELEMENTS, n);
+        return NULL;
+    }
+    if (gen->id == SYM_NEARLY_SORTED && args[1] < 0) {
+        snprintf(error, errorSize, "swaps must not be negative, got %d", args[1]);
+        return NULL;
+    }
+    if (gen->id == SYM_FEW_UNIQUE && args[1] < 1) {
+        snprintf(error, errorSize, "k must be at least 1, got %d", args[1]);
+        return NULL;
+    }
+    int *out = (int *)arenaAlloc(arena, (size_t)n * sizeof(int));
+    if (!out) {
+        snprintf(error, errorSize, "out of memory for %d values", n);
+        return NULL;
+    }
+
+    Rng rng;
+    switch (gen->id) {
+        case SYM_RANDOM:
+            seedRng(&rng, args[1]);
+            for (int i = 0; i < n; i++) out[i] = (int)boundedRng(&rng, (uint32_t)n);
+            break;
+        case SYM_SORTED:
+            for (int i = 0; i < n; i++) out[i] = i;
+            break;
+        case SYM_REVERSED:
+            for (int i = 0; i < n; i++) out[i] = n - 1 - i;
+            break;
+        case SYM_NEARLY_SORTED:
+            seedRng(&rng, args[2]);
+            for (int i = 0; i < n; i++) out[i] = i;
+            for (int s = 0; s < args[1]; s++) {
+                uint32_t a = boundedRng(&rng, (uint32_t)n);
+                uint32_t b = boundedRng(&rng, (uint32_t)n);
+                int tmp = out[a];
+                out[a] = out[b];
+                out[b] = tmp;
+            }
+            break;
+        case SYM_FEW_UNIQUE:
+            seedRng(&rng, args[2]);
+            for (int i = 0; i < n; i++) out[i] = (int)boundedRng(&rng, (uint32_t)args[1]);
+            break;
+        case SYM_ORGAN_PIPE:
+            for (int i = 0; i < n; i++) out[i] = i < n - 1 - i ? i : n - 1 - i;
+            break;
+        default:
+            snprintf(error, errorSize, "not a generator");
+            return NULL;
+    }
+    return out;
+}
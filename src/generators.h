@@ -0,0 +1,34 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "symbols.h"
+
+// Array initialisers evaluated at compile time:
+//   random(n, seed)               n values in [0, n)
+//   sorted(n), reversed(n)        0..n-1 ascending / descending
+//   nearly_sorted(n, swaps, seed) sorted, then `swaps` random transpositions
+//   few_unique(n, k, seed)        n values drawn from [0, k)
+//   organ_pipe(n)                 0, 1, ..., peak, ..., 1, 0
+// Seeded generators use xoshiro256** with integer-only range reduction, so
+// the same arguments give the same array on every machine.
+
+#define GENERATOR_MAX_ARGS 3
+#define GENERATOR_MAX_ELEMENTS (1 << 27)
+
+typedef struct ArrayGenerator {
+    SymbolId id;
+    const char *usage;   // Call shape for diagnostics, e.g. "random(n, seed)"
+    int arity;           // Every generator takes n first
+} ArrayGenerator;
+
+// NULL if `id` does not name a generator
+const ArrayGenerator *findArrayGenerator(int id);
+
+// Returns a new array of args[0] values in `arena`, or NULL with a reason
+// in `error` when an argument is out of range or memory runs out
+int *runArrayGenerator(const ArrayGenerator *gen, const int *args, Arena *arena,
+                       char *error, size_t errorSize);
+
+#endif
@@ -3,95 +3,273 @@
 #include <string.h>
 #include "ir.h"
 
-static IRNode *irHead = NULL;
-static IRNode *irTail = NULL;
-static char algorithmName[64] = "Algorithm";
-static int algorithmArray[256];
-static int algorithmArraySize = 0;
-static char detectedAlgorithm[64] = "";
-
-void resetIR(void) {
-    IRNode *curr = irHead;
-    while (curr) {
-        IRNode *next = curr->next;
-        free(curr);
-        curr = next;
-    }
-    irHead = NULL;
-    irTail = NULL;
-}
-
-void addIR(const char *action, const char *details) {
-    addIRWithIndices(action, details, NULL, 0);
-}
-
-void addIRWithIndices(const char *action, const char *details, int *indices, int index_count) {
-    IRNode *node = (IRNode *)malloc(sizeof(IRNode));
-    if (!node) return;
-    memset(node, 0, sizeof(IRNode));
-    strncpy(node->action, action ? action : "", sizeof(node->action) - 1);
-    strncpy(node->details, details ? details : "", sizeof(node->details) - 1);
-    node->index_count = (index_count > 4) ? 4 : index_count;
-    if (indices && node->index_count > 0) {
-        for (int i = 0; i < node->index_count; i++) {
-            node->indices[i] = indices[i];
-        }
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Chunks double from 64 nodes up to 64K (1.25 MB), so short traces stay small
+// and long ones cost one malloc per 64K steps
+#define IR_CHUNK_MIN 64
+#define IR_CHUNK_MAX 65536
+
+struct IRChunk {
+    IRChunk *next;
+    int used;
+    int capacity;
+    IRNode nodes[];
+};
+
+#define IR_ACTION_SLOTS 512  // Power of two, at least twice IR_MAX_ACTIONS
+#define IR_ACTION_LENGTH 32
+
+// A track's action names, found through an open-addressed hash table whose
+// slots hold a name's index + 1 (0 = empty)
+struct IRActions {
+    int count;
+    unsigned char slots[IR_ACTION_SLOTS];
+    char names[IR_MAX_ACTIONS][IR_ACTION_LENGTH];
+};
+
+void initIR(IRContext *ir) {
+    ir->chunks = NULL;
+    ir->lastChunk = NULL;
+    ir->actions = NULL;
+    ir->stepCount = 0;
+    ir->lane = -1;
+    strcpy(ir->algorithmName, "Algorithm");
+    ir->array = NULL;
+    ir->arraySize = 0;
+    ir->detectedAlgorithm[0] = '\0';
+    ir->timeComplexity = NULL;
+    ir->spaceComplexity = NULL;
+    ir->tracks = NULL;
+    ir->trackCount = 0;
+}
+
+static void freeTracks(IRContext *ir) {
+    for (int i = 0; i < ir->trackCount; i++) {
+        resetIR(&ir->tracks[i]);
     }
-    node->next = NULL;
-    if (!irHead) {
-        irHead = node;
-        irTail = node;
-    } else {
-        irTail->next = node;
-        irTail = node;
+    free(ir->tracks);
+    ir->tracks = NULL;
+    ir->trackCount = 0;
+}
+
+void resetIR(IRContext *ir) {
+    IRChunk *chunk = ir->chunks;
+    while (chunk) {
+        IRChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
     }
+    ir->chunks = NULL;
+    ir->lastChunk = NULL;
+    free(ir->actions);
+    ir->actions = NULL;
+    ir->stepCount = 0;
+    ir->lane = -1;
+    free(ir->array);
+    ir->array = NULL;
+    ir->arraySize = 0;
+    freeTracks(ir);
 }
 
-void setAlgorithmName(const char *name) {
-    if (name) {
-        strncpy(algorithmName, name, sizeof(algorithmName) - 1);
-        algorithmName[sizeof(algorithmName) - 1] = '\0';
+int addIR(IRContext *ir, const char *action, const char *details) {
+    return addIRWithIndices(ir, action, details, NULL, 0);
+}
+
+static IRNode *allocNode(IRContext *ir) {
+    IRChunk *chunk = ir->lastChunk;
+    if (!chunk || chunk->used == chunk->capacity) {
+        int capacity = chunk ? chunk->capacity * 2 : IR_CHUNK_MIN;
+        if (capacity > IR_CHUNK_MAX) capacity = IR_CHUNK_MAX;
+        IRChunk *next = (IRChunk *)malloc(sizeof(IRChunk) + (size_t)capacity * sizeof(IRNode));
+        if (!next) return NULL;
+        next->next = NULL;
+        next->used = 0;
+        next->capacity = capacity;
+        if (chunk) chunk->next = next;
+        else ir->chunks = next;
+        ir->lastChunk = chunk = next;
     }
+    return &chunk->nodes[chunk->used++];
 }
 
-void setArray(int *arr, int size) {
-    algorithmArraySize = (size > 256) ? 256 : size;
-    if (arr) {
-        for (int i = 0; i < algorithmArraySize; i++) {
-            algorithmArray[i] = arr[i];
-        }
+// Index of `action` (truncated like the names) in the track's names,
+// adding it if new; IR_OUT_OF_MEMORY or IR_TOO_MANY_ACTIONS if it cannot
+static int internAction(IRContext *ir, const char *action) {
+    IRActions *actions = ir->actions;
+    if (!actions) {
+        actions = ir->actions = (IRActions *)calloc(1, sizeof(IRActions));
+        if (!actions) return IR_OUT_OF_MEMORY;
+    }
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < IR_ACTION_LENGTH - 1 && action[i]; i++) {
+        hash = (hash ^ (unsigned char)action[i]) * 16777619u;
     }
+    for (unsigned int slot = hash;; slot++) {
+        int entry = actions->slots[slot & (IR_ACTION_SLOTS - 1)];
+        if (entry == 0) break;
+        if (strncmp(actions->names[entry - 1], action, IR_ACTION_LENGTH - 1) == 0) return entry - 1;
+    }
+    if (actions->count == IR_MAX_ACTIONS) return IR_TOO_MANY_ACTIONS;
+    int index = actions->count++;
+    strncpy(actions->names[index], action, IR_ACTION_LENGTH - 1);
+    unsigned int slot = hash;
+    while (actions->slots[slot & (IR_ACTION_SLOTS - 1)]) slot++;
+    actions->slots[slot & (IR_ACTION_SLOTS - 1)] = (unsigned char)(index + 1);
+    return index;
 }
 
-void setDetectedAlgorithm(const char *name) {
+int addIRWithIndices(IRContext *ir, const char *action, const char *details, int *indices, int index_count) {
+    (void)details;
+    int name = internAction(ir, action ? action : "");
+    if (name < 0) return name;
+    IRNode *node = allocNode(ir);
+    if (!node) return IR_OUT_OF_MEMORY;
+    node->action = (unsigned char)name;
+    node->index_count = (unsigned char)(indices && index_count > 0 ? (index_count > 4 ? 4 : index_count) : 0);
+    for (int i = 0; i < node->index_count; i++) {
+        node->indices[i] = indices[i];
+    }
+    node->lane = (short)ir->lane;
+    ir->stepCount++;
+    return 0;
+}
+
+void setAlgorithmName(IRContext *ir, const char *name) {
     if (name) {
-        strncpy(detectedAlgorithm, name, sizeof(detectedAlgorithm) - 1);
-        detectedAlgorithm[sizeof(detectedAlgorithm) - 1] = '\0';
+        strncpy(ir->algorithmName, name, sizeof(ir->algorithmName) - 1);
+        ir->algorithmName[sizeof(ir->algorithmName) - 1] = '\0';
     }
 }
 
-const char *getDetectedAlgorithm(void) {
-    return detectedAlgorithm;
+void setIRLane(IRContext *ir, int lane) {
+    ir->lane = lane;
 }
 
-void writeIRToJSON(const char *filename) {
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        fprintf(stderr, "Failed to open %s for writing\n", filename);
-        return;
+int setArray(IRContext *ir, const int *arr, int size) {
+    free(ir->array);
+    ir->array = NULL;
+    ir->arraySize = 0;
+    if (!arr || size <= 0) return 0;
+    ir->array = (int *)malloc((size_t)size * sizeof(int));
+    if (!ir->array) return -1;
+    memcpy(ir->array, arr, (size_t)size * sizeof(int));
+    ir->arraySize = size;
+    return 0;
+}
+
+void setDetectedAlgorithm(IRContext *ir, const char *name) {
+    if (name) {
+        strncpy(ir->detectedAlgorithm, name, sizeof(ir->detectedAlgorithm) - 1);
+        ir->detectedAlgorithm[sizeof(ir->detectedAlgorithm) - 1] = '\0';
+    }
+}
+
+const char *getDetectedAlgorithm(const IRContext *ir) {
+    return ir->detectedAlgorithm;
+}
+
+void setComplexity(IRContext *ir, const char *time, const char *space) {
+    ir->timeComplexity = time;
+    ir->spaceComplexity = space;
+}
+
+IRContext *addTracks(IRContext *ir, int count) {
+    freeTracks(ir);
+    if (count <= 0) return NULL;
+    ir->tracks = (IRContext *)malloc((size_t)count * sizeof(IRContext));
+    if (!ir->tracks) return NULL;
+    for (int i = 0; i < count; i++) {
+        initIR(&ir->tracks[i]);
+    }
+    ir->trackCount = count;
+    return ir->tracks;
+}
+
+int traceStepCount(const IRContext *ir) {
+    int steps = ir->stepCount;
+    for (int i = 0; i < ir->trackCount; i++) {
+        steps += ir->tracks[i].stepCount;
     }
+    return steps;
+}
+
+// Loaded datasets can hold millions of values, so format them by hand into
+// a buffer rather than paying for a fprintf call per element
+static void writeIntList(FILE *fp, const int *values, int count) {
+    char buf[8192];
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        if (len > sizeof(buf) - 16) {
+            fwrite(buf, 1, len, fp);
+            len = 0;
+        }
+        if (i > 0) {
+            buf[len++] = ',';
+            buf[len++] = ' ';
+        }
+        unsigned int v = (unsigned int)values[i];
+        if (values[i] < 0) {
+            buf[len++] = '-';
+            v = 0u - v;
+        }
+        char digits[10];
+        int n = 0;
+        do {
+            digits[n++] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v);
+        while (n) buf[len++] = digits[--n];
+    }
+    fwrite(buf, 1, len, fp);
+}
+
+// Moves the finished temporary trace over the old one in a single step, so
+// a visualizer (or watch-mode reader) never sees a half-written file
+static int replaceFile(const char *from, const char *to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+// One step object, without the separator that follows it
+static void writeStep(FILE *fp, const IRContext *ir, const IRNode *curr, const char *pad) {
+    fprintf(fp, "%s  {\n", pad);
+    fprintf(fp, "%s    \"action\": \"%s\"", pad, ir->actions->names[curr->action]);
     
-    // Write new structured JSON format
-    fprintf(fp, "{\n");
-    fprintf(fp, "  \"algorithm\": \"%s\",\n", algorithmName);
+    // Write indices if available
+    if (curr->index_count > 0) {
+        if (curr->index_count == 1) {
+            fprintf(fp, ",\n%s    \"index\": %d", pad, curr->indices[0]);
+        } else {
+            fprintf(fp, ",\n%s    \"indices\": [", pad);
+            for (int i = 0; i < curr->index_count; i++) {
+                fprintf(fp, "%d", curr->indices[i]);
+                if (i < curr->index_count - 1) fprintf(fp, ", ");
+            }
+            fprintf(fp, "]");
+        }
+    }
+    if (curr->lane >= 0) {
+        fprintf(fp, ",\n%s    \"lane\": %d", pad, curr->lane);
+    }
+    
+    fprintf(fp, "\n%s  }", pad);
+}
+
+// One track's members, each line prefixed with `pad`; the caller closes
+// the enclosing object
+static void writeTrack(FILE *fp, const IRContext *ir, const char *pad) {
+    fprintf(fp, "%s\"algorithm\": \"%s\",\n", pad, ir->algorithmName);
     
     // Write array
-    fprintf(fp, "  \"array\": [");
-    if (algorithmArraySize > 0) {
-        for (int i = 0; i < algorithmArraySize; i++) {
-            fprintf(fp, "%d", algorithmArray[i]);
-            if (i < algorithmArraySize - 1) fprintf(fp, ", ");
-        }
+    fprintf(fp, "%s\"array\": [", pad);
+    if (ir->arraySize > 0) {
+        writeIntList(fp, ir->array, ir->arraySize);
     } else {
         // Default array if not set
         fprintf(fp, "5, 3, 8, 4, 2");
@@ -99,44 +277,52 @@ void writeIRToJSON(const char *filename) {
     fprintf(fp, "],\n");
     
     // Write steps
-    fprintf(fp, "  \"steps\": [\n");
-    IRNode *curr = irHead;
-    int step_count = 0;
-    while (curr) {
-        fprintf(fp, "    {\n");
-        fprintf(fp, "      \"action\": \"%s\"", curr->action);
-        
-        // Write indices if available
-        if (curr->index_count > 0) {
-            if (curr->index_count == 1) {
-                fprintf(fp, ",\n      \"index\": %d", curr->indices[0]);
-            } else {
-                fprintf(fp, ",\n      \"indices\": [");
-                for (int i = 0; i < curr->index_count; i++) {
-                    fprintf(fp, "%d", curr->indices[i]);
-                    if (i < curr->index_count - 1) fprintf(fp, ", ");
-                }
-                fprintf(fp, "]");
-            }
+    fprintf(fp, "%s\"steps\": [\n", pad);
+    int written = 0;
+    for (const IRChunk *chunk = ir->chunks; chunk; chunk = chunk->next) {
+        for (int k = 0; k < chunk->used; k++) {
+            writeStep(fp, ir, &chunk->nodes[k], pad);
+            if (++written < ir->stepCount) fprintf(fp, ",");
+            fprintf(fp, "\n");
         }
-        
-        fprintf(fp, "\n    }");
-        if (curr->next) fprintf(fp, ",");
-        fprintf(fp, "\n");
-        curr = curr->next;
-        step_count++;
-    }
-    fprintf(fp, "  ],\n");
+    }
+    fprintf(fp, "%s],\n", pad);
     
     // Write metadata
-    fprintf(fp, "  \"metadata\": {\n");
-    fprintf(fp, "    \"timeComplexity\": \"O(n²)\",\n");
-    fprintf(fp, "    \"spaceComplexity\": \"O(1)\",\n");
-    fprintf(fp, "    \"description\": \"Generated from algorithm visualization compiler.\"\n");
-    fprintf(fp, "  }\n");
-    fprintf(fp, "}\n");
-    
-    fclose(fp);
+    fprintf(fp, "%s\"metadata\": {\n", pad);
+    fprintf(fp, "%s  \"timeComplexity\": \"%s\",\n", pad, ir->timeComplexity ? ir->timeComplexity : "O(n²)");
+    fprintf(fp, "%s  \"spaceComplexity\": \"%s\",\n", pad, ir->spaceComplexity ? ir->spaceComplexity : "O(1)");
+    fprintf(fp, "%s  \"description\": \"Generated from algorithm visualization compiler.\"\n", pad);
+    fprintf(fp, "%s}", pad);
 }
 
-
+int writeIRToJSON(const IRContext *ir, const char *filename) {
+    char tmpPath[1024];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", filename);
+    FILE *fp = fopen(tmpPath, "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s for writing\n", filename);
+        return -1;
+    }
+    
+    // Write new structured JSON format
+    fprintf(fp, "{\n");
+    writeTrack(fp, ir, "  ");
+    if (ir->trackCount > 0) {
+        fprintf(fp, ",\n  \"tracks\": [\n");
+        for (int i = 0; i < ir->trackCount; i++) {
+            fprintf(fp, "    {\n");
+            writeTrack(fp, &ir->tracks[i], "      ");
+            fprintf(fp, "\n    }%s\n", i < ir->trackCount - 1 ? "," : "");
+        }
+        fprintf(fp, "  ]");
+    }
+    fprintf(fp, "\n}\n");
+    
+    if (fclose(fp) != 0 || replaceFile(tmpPath, filename) != 0) {
+        fprintf(stderr, "Failed to write %s\n", filename);
+        remove(tmpPath);
+        return -1;
+    }
+    return 0;
+}
@@ -1,23 +1,65 @@
 #ifndef IR_H
 #define IR_H
 
+// One step, 20 bytes. Traces run to millions of steps, so nodes are laid
+// out in chunks owned by the context rather than allocated one by one, and
+// the action is stored as an index into the context's interned names.
 typedef struct IRNode {
-    char action[32];
-    char details[128];
-    int indices[4];  // Support up to 4 indices for actions
-    int index_count; // Number of valid indices
-    struct IRNode *next;
+    int indices[4];            // Support up to 4 indices for actions
+    unsigned char action;      // Index into the track's action names
+    unsigned char index_count; // Number of valid indices
+    short lane;                // Worker lane of a parallel sort, -1 if none
 } IRNode;
 
-void resetIR(void);
-void addIR(const char *action, const char *details);
-void addIRWithIndices(const char *action, const char *details, int *indices, int index_count);
-void setAlgorithmName(const char *name);
-void setArray(int *arr, int size);
-void setDetectedAlgorithm(const char *name);
-const char *getDetectedAlgorithm(void);
-void writeIRToJSON(const char *filename);
+typedef struct IRChunk IRChunk;
+typedef struct IRActions IRActions;
 
-#endif
+// Per-compilation IR state: the step list plus trace metadata. A program
+// with several algorithm calls or data structures produces one track per
+// call; this context is the first and owns the rest.
+typedef struct IRContext {
+    IRChunk *chunks;      // Steps in order, a chunk at a time
+    IRChunk *lastChunk;   // New steps go here
+    IRActions *actions;   // Action names, NULL until the first step
+    int stepCount;
+    int lane;        // Lane given to new steps (-1 = none)
+    char algorithmName[64];
+    int *array;      // Initial array, owned by the context
+    int arraySize;
+    char detectedAlgorithm[64];
+    const char *timeComplexity;   // String literals (NULL = unspecified)
+    const char *spaceComplexity;
+    struct IRContext *tracks;     // Further tracks, in program order
+    int trackCount;
+} IRContext;
+
+#define IR_MAX_ACTIONS 255      // Distinct action names per track
 
+// What addIR and addIRWithIndices return when the step is not kept
+#define IR_OUT_OF_MEMORY (-1)
+#define IR_TOO_MANY_ACTIONS (-2)
 
+void initIR(IRContext *ir);
+void resetIR(IRContext *ir);
+// `details` are not kept: no trace format has a place for them. Returns
+// 0, or IR_OUT_OF_MEMORY / IR_TOO_MANY_ACTIONS if the step was dropped,
+// which leaves the trace incomplete.
+int addIR(IRContext *ir, const char *action, const char *details);
+int addIRWithIndices(IRContext *ir, const char *action, const char *details, int *indices, int index_count);
+void setAlgorithmName(IRContext *ir, const char *name);
+// Tags the steps added from now on with a worker lane (-1 = none)
+void setIRLane(IRContext *ir, int lane);
+// Copies arr[0..size). Returns 0, or -1 if out of memory.
+int setArray(IRContext *ir, const int *arr, int size);
+void setDetectedAlgorithm(IRContext *ir, const char *name);
+void setComplexity(IRContext *ir, const char *time, const char *space);
+// Replaces the further tracks with `count` empty ones. NULL if out of memory.
+IRContext *addTracks(IRContext *ir, int count);
+// Steps across every track
+int traceStepCount(const IRContext *ir);
+const char *getDetectedAlgorithm(const IRContext *ir);
+// Track 0 is written at the top level, so single-track readers still work;
+// further tracks follow as complete objects in a "tracks" array
+int writeIRToJSON(const IRContext *ir, const char *filename);
+
+#endif
@@ -11,6 +11,7 @@ typedef struct Step {
     char action[MAX_ACTION_LEN];
     int indices[4];
     int index_count;
+    int lane;        // Worker lane of a parallel sort, -1 if none
     struct Step *next;
 } Step;
 
@@ -29,11 +30,12 @@ static void freeSteps(Step *head) {
     }
 }
 
+// Leading integer of `str` (a JSON value is followed by more of the object)
 static int parseNumber(const char *str, int *value) {
     if (!str || !value) return 0;
     char *end;
     *value = (int)strtol(str, &end, 10);
-    return (end != str && *end == '\0');
+    return end != str;
 }
 
 static int extractString(const char *line, const char *key, char *output, size_t max_len) {
@@ -132,6 +134,17 @@ static int extractIndices(const char *line, int *indices, int *count) {
     return 0;
 }
 
+// Integer member `key`; leaves *value alone if absent
+static int extractInt(const char *line, const char *key, int *value) {
+    char search_str[64];
+    snprintf(search_str, sizeof(search_str), "\"%s\"", key);
+    char *pos = strstr(line, search_str);
+    if (!pos) return 0;
+    pos = strchr(pos + strlen(search_str), ':');
+    if (!pos) return 0;
+    return parseNumber(pos + 1, value);
+}
+
 static JSONData *parseJSON(const char *filename) {
     FILE *fp = fopen(filename, "r");
     if (!fp) {
@@ -180,7 +193,13 @@ static JSONData *parseJSON(const char *filename) {
         steps_start = strchr(steps_start, '[');
         if (steps_start) {
             steps_start++;  // Skip '['
-            char *steps_end = strrchr(steps_start, ']');
+            // The matching ']' (later tracks and metadata follow it)
+            char *steps_end = steps_start;
+            for (int depth = 0; *steps_end && (*steps_end != ']' || depth > 0); steps_end++) {
+                if (*steps_end == '[') depth++;
+                else if (*steps_end == ']') depth--;
+            }
+            if (*steps_end != ']') steps_end = NULL;
             if (steps_end) {
                 // Process steps between [ and ]
                 char *step_pos = steps_start;
@@ -225,6 +244,8 @@ static JSONData *parseJSON(const char *filename) {
                             if (!extractIndices(step_obj, step->indices, &step->index_count)) {
                                 step->index_count = 0;
                             }
+                            step->lane = -1;
+                            extractInt(step_obj, "lane", &step->lane);
                             
                             step->next = NULL;
                             if (!data->steps) {
@@ -301,8 +322,14 @@ static void generateJS(JSONData *data, FILE *out) {
     fprintf(out, "// === Step Playback ===\n");
     
     Step *curr = data->steps;
+    int lane = -1;
     
     while (curr) {
+        // Steps of parallel sorts come from lanes; say when the lane changes
+        if (curr->lane != lane) {
+            lane = curr->lane;
+            if (lane >= 0) fprintf(out, "log.println('Lane %d:');\n", lane);
+        }
         if (strcmp(curr->action, "compare") == 0) {
             if (curr->index_count >= 2) {
                 int i = curr->indices[0];
@@ -315,6 +342,15 @@ static void generateJS(JSONData *data, FILE *out) {
                 fprintf(out, "tracer.select(%d, %d);\n", i, j);
                 fprintf(out, "log.println('Compare %d and %d');\n", val_i, val_j);
                 fprintf(out, "Tracer.delay();\n\n");
+            } else if (curr->index_count == 1) {
+                // An element compared with a variable
+                int i = curr->indices[0];
+                int val_i = (i >= 0 && i < data->array_size) ? data->array[i] : 0;
+                
+                fprintf(out, "tracer.select(%d);\n", i);
+                fprintf(out, "log.println('Compare %d');\n", val_i);
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.deselect(%d);\n\n", i);
             }
         }
         else if (strcmp(curr->action, "swap") == 0) {
@@ -329,14 +365,138 @@ static void generateJS(JSONData *data, FILE *out) {
                 fprintf(out, "swap(%d, %d);\n", i, j);
                 
                 // Update array state for future references
-                int temp = data->array[i];
-                data->array[i] = data->array[j];
-                data->array[j] = temp;
+                // (only the first MAX_ARRAY_SIZE values are kept)
+                if (i >= 0 && j >= 0 && i < data->array_size && j < data->array_size) {
+                    int temp = data->array[i];
+                    data->array[i] = data->array[j];
+                    data->array[j] = temp;
+                }
                 
                 fprintf(out, "tracer.deselect(%d, %d);\n", i, j);
                 fprintf(out, "Tracer.delay();\n\n");
             }
         }
+        else if (strcmp(curr->action, "set") == 0) {
+            if (curr->index_count >= 2) {
+                int i = curr->indices[0];
+                int value = curr->indices[1];
+                
+                fprintf(out, "log.println('Storing %d at index %d');\n", value, i);
+                fprintf(out, "array[%d] = %d;\n", i, value);
+                fprintf(out, "tracer.patch(%d, %d);\n", i, value);
+                if (i >= 0 && i < data->array_size) data->array[i] = value;
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.depatch(%d);\n\n", i);
+            }
+        }
+        else if (strcmp(curr->action, "scatter") == 0) {
+            // Radix, merge and the parallel sorts write each pass's output
+            // over the array
+            if (curr->index_count >= 2) {
+                int i = curr->indices[0];
+                int value = curr->indices[1];
+                
+                fprintf(out, "log.println('Scattering %d to index %d');\n", value, i);
+                fprintf(out, "array[%d] = %d;\n", i, value);
+                fprintf(out, "tracer.patch(%d, %d);\n", i, value);
+                if (i >= 0 && i < data->array_size) data->array[i] = value;
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.depatch(%d);\n\n", i);
+            }
+        }
+        else if (strcmp(curr->action, "histogram") == 0) {
+            if (curr->index_count >= 2) {
+                int i = curr->indices[0];
+                fprintf(out, "tracer.select(%d);\n", i);
+                fprintf(out, "log.println('Index %d has %s %d');\n", i,
+                        strncmp(data->algorithm, "Sample", 6) == 0 ? "bucket" : "digit", curr->indices[1]);
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.deselect(%d);\n\n", i);
+            }
+        }
+        else if (strcmp(curr->action, "sift_down") == 0) {
+            if (curr->index_count >= 2) {
+                int i = curr->indices[0];
+                fprintf(out, "log.println('Sift down from index %d (heap size %d)');\n", i, curr->indices[1]);
+                fprintf(out, "tracer.select(%d);\n", i);
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.deselect(%d);\n\n", i);
+            }
+        }
+        else if (strcmp(curr->action, "run") == 0) {
+            if (curr->index_count >= 2) {
+                int i = curr->indices[0];
+                int j = curr->indices[1];
+                fprintf(out, "log.println('Sorting run %d..%d');\n", i, j);
+                fprintf(out, "tracer.select(%d, %d);\n", i, j);
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.deselect(%d, %d);\n\n", i, j);
+            }
+        }
+        else if (strcmp(curr->action, "merge") == 0) {
+            if (curr->index_count >= 3) {
+                int first = curr->indices[0];
+                int last = curr->indices[2];
+                fprintf(out, "log.println('Merging runs %d..%d and %d..%d');\n", first,
+                        curr->indices[1] - 1, curr->indices[1], last);
+                fprintf(out, "tracer.select(%d, %d);\n", first, last);
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.deselect(%d, %d);\n\n", first, last);
+            }
+        }
+        else if (strcmp(curr->action, "split") == 0) {
+            if (curr->index_count >= 2) {
+                int i = curr->indices[0];
+                int j = curr->indices[1];
+                fprintf(out, "log.println('Merging into %d..%d');\n", i, j);
+                fprintf(out, "tracer.select(%d, %d);\n", i, j);
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.deselect(%d, %d);\n\n", i, j);
+            }
+        }
+        else if (strcmp(curr->action, "stage") == 0) {
+            // A sorting network stage exchanges many pairs at once, so the
+            // array is redrawn once after all of them
+            if (curr->index_count >= 4) {
+                int first = curr->indices[0];
+                int last = curr->indices[1];
+                int k = curr->indices[2];
+                int j = curr->indices[3];
+                fprintf(out, "log.println('Stage: compare-exchange %d apart in %d..%d, sequences of %d');\n",
+                        j, first, last, k);
+                fprintf(out, "tracer.select(%d, %d);\n", first, last);
+                for (int i = 0; first >= 0 && j > 0 && first + i + j <= last && last < data->array_size; i++) {
+                    if (i & j) continue;
+                    int *a = &data->array[first + i];
+                    int *b = &data->array[first + i + j];
+                    int descending = (i & k) != 0;
+                    if (descending ? *a < *b : *a > *b) {
+                        int temp = *a;
+                        *a = *b;
+                        *b = temp;
+                        fprintf(out, "array[%d] = %d; array[%d] = %d;\n", first + i, *a, first + i + j, *b);
+                    }
+                }
+                fprintf(out, "tracer.set(array);\n");
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.deselect(%d, %d);\n\n", first, last);
+            }
+        }
+        else if (strcmp(curr->action, "gallop") == 0) {
+            if (curr->index_count >= 2) {
+                int probe = curr->indices[0];
+                fprintf(out, "log.println('Gallop: probing index %d for the element at %d');\n", probe, curr->indices[1]);
+                fprintf(out, "tracer.select(%d);\n", probe);
+                fprintf(out, "Tracer.delay();\n");
+                fprintf(out, "tracer.deselect(%d);\n\n", probe);
+            }
+        }
+        else if (strcmp(curr->action, "gap") == 0) {
+            if (curr->index_count >= 1) {
+                fprintf(out, "log.println('Gap %d');\n", curr->indices[0]);
+                fprintf(out, "Tracer.delay();\n\n");
+            }
+        }
         else if (strcmp(curr->action, "no_swap") == 0) {
             if (curr->index_count >= 2) {
                 int i = curr->indices[0];
@@ -4,24 +4,61 @@
 #include "ast.h"
 #include "ir.h"
 #include "codegen.h"
+#include "compiler.h"
+#include "batch.h"
+#include "watch.h"
+#include "traceevents.h"
 
-int yyparse(void);
-extern FILE *yyin;
-extern ASTNode *root;
+static const char *traceEventsPath;
+
+static void writeTraceEvents(void) {
+    traceMemory();
+    if (traceEventsWrite(traceEventsPath) == 0) {
+        fprintf(stderr, "Trace events written to %s\n", traceEventsPath);
+    }
+}
 
 void printUsage(const char *progName) {
-    printf("Usage: %s [OPTIONS] <input_file>\n\n", progName);
+    printf("Usage: %s [OPTIONS] <input_file>\n", progName);
+    printf("       %s [OPTIONS] <file|dir|pattern>...   (batch mode)\n\n", progName);
     printf("Options:\n");
     printf("  -h, --help          Show this help message\n");
     printf("  -v, --visualize     Visualize algorithm in terminal (default)\n");
     printf("  -j, --json-to-js    Convert JSON to JavaScript for Algorithm Visualizer\n");
     printf("  -o, --output FILE   Specify output file (default: output.json or visualizer.js)\n");
+    printf("  <input_file> of -   Read the program from stdin\n");
+    printf("\n");
+    printf("Batch mode (several inputs, a directory or a wildcard pattern):\n");
+    printf("  -b, --batch         Force batch mode for a single input\n");
+    printf("  -t, --threads N     Worker threads (default: one per CPU)\n");
+    printf("  -d, --out-dir DIR   Directory for <name>.json traces (default: .)\n");
+    printf("  --summary FILE      Summary JSON (default: <out-dir>/summary.json)\n");
+    printf("\n");
+    printf("Trace cache (any mode):\n");
+    printf("  --cache DIR         Reuse traces of programs compiled before (same algorithm and data)\n");
+    printf("  --cache-size MB     Evict least recently used traces beyond this size (default: %d)\n",
+           TRACE_CACHE_DEFAULT_MB);
+    printf("\n");
+    printf("Execution limits (any mode; 0 = no limit):\n");
+    printf("  --max-instructions N  Stop statements after N bytecode instructions (default: %lld)\n",
+           VM_DEFAULT_MAX_INSTRUCTIONS);
+    printf("  --max-steps N       Reject traces longer than N steps (default: %d)\n", VM_DEFAULT_MAX_STEPS);
+    printf("  --timeout MS        Stop generating steps after MS milliseconds (default: %.0f)\n",
+           VM_DEFAULT_TIMEOUT_MS);
+    printf("\n");
+    printf("Watch mode:\n");
+    printf("  -w, --watch         Recompile inputs whenever they are saved (uses -o or -d)\n");
+    printf("\n");
+    printf("Profiling:\n");
+    printf("  --trace-events FILE Record phase timings as Chrome trace events (chrome://tracing)\n");
     printf("\n");
     printf("Examples:\n");
     printf("  %s test.algo                # Compile and visualize in CLI\n", progName);
     printf("  %s -v test.algo              # Same as above\n", progName);
     printf("  %s -j test.algo              # Generate JavaScript for web visualizer\n", progName);
     printf("  %s -j test.algo -o viz.js    # Generate JavaScript with custom output\n", progName);
+    printf("  %s -d traces submissions/    # Compile every .algo in a directory\n", progName);
+    printf("  %s -w test.algo              # Keep output.json up to date while editing\n", progName);
 }
 
 int main(int argc, char **argv) {
@@ -29,12 +66,23 @@ int main(int argc, char **argv) {
     const char *outputPath = NULL;
     int visualizeMode = 1;  // Default: CLI visualization
     int jsonToJsMode = 0;
-    int errors_found = 0;
+    int batchMode = 0;
+    int watchMode = 0;
+    BatchOptions batch = { NULL, NULL, 0, NULL, NULL };
+    TraceCache cache = { NULL, (long long)TRACE_CACHE_DEFAULT_MB << 20 };
+    VMLimits limits = { VM_DEFAULT_MAX_INSTRUCTIONS, VM_DEFAULT_MAX_STEPS, VM_DEFAULT_TIMEOUT_MS };
+    const char **inputs = (const char **)malloc(sizeof(char *) * (argc > 1 ? argc : 1));
+    int inputCount = 0;
+    if (!inputs) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             printUsage(argv[0]);
+            free(inputs);
             return 0;
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--visualize") == 0) {
             visualizeMode = 1;
@@ -47,74 +95,146 @@ int main(int argc, char **argv) {
                 outputPath = argv[++i];
             } else {
                 fprintf(stderr, "Error: -o requires an output file name\n");
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--batch") == 0) {
+            batchMode = 1;
+        } else if (strcmp(argv[i], "-w") == 0 || strcmp(argv[i], "--watch") == 0) {
+            watchMode = 1;
+        } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 < argc) {
+                batch.threads = atoi(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: %s requires a thread count\n", argv[i]);
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--out-dir") == 0) {
+            if (i + 1 < argc) {
+                batch.outputDir = argv[++i];
+            } else {
+                fprintf(stderr, "Error: %s requires a directory\n", argv[i]);
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            if (i + 1 < argc) {
+                cache.dir = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --cache requires a directory\n");
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cache-size") == 0) {
+            if (i + 1 < argc) {
+                cache.maxBytes = atoll(argv[++i]) << 20;
+            } else {
+                fprintf(stderr, "Error: --cache-size requires a size in MB\n");
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-instructions") == 0) {
+            if (i + 1 < argc) {
+                limits.instructions = atoll(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: --max-instructions requires a count\n");
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-steps") == 0) {
+            if (i + 1 < argc) {
+                limits.steps = atoi(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: --max-steps requires a count\n");
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--timeout") == 0) {
+            if (i + 1 < argc) {
+                limits.timeoutMs = atof(argv[++i]);
+            } else {
+                fprintf(stderr, "Error: --timeout requires a time in milliseconds\n");
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--trace-events") == 0) {
+            if (i + 1 < argc) {
+                traceEventsPath = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --trace-events requires a file name\n");
+                free(inputs);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--summary") == 0) {
+            if (i + 1 < argc) {
+                batch.summaryPath = argv[++i];
+            } else {
+                fprintf(stderr, "Error: --summary requires a file name\n");
+                free(inputs);
                 return 1;
             }
-        } else if (argv[i][0] != '-') {
-            inputPath = argv[i];
+        } else if (argv[i][0] != '-' || argv[i][1] == '\0') {  // "-" reads stdin
+            inputs[inputCount++] = argv[i];
         } else {
             fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
             printUsage(argv[0]);
+            free(inputs);
             return 1;
         }
     }
     
-    if (!inputPath) {
-        inputPath = "tests/examples/test.algo";
+    if (cache.dir) {
+        batch.cache = &cache;
     }
-    
-    if (!outputPath) {
-        outputPath = jsonToJsMode ? "visualizer.js" : "output.json";
+    batch.limits = &limits;
+    if (traceEventsPath) {
+        traceEventsStart();
+        atexit(writeTraceEvents);
     }
-
-    // Phase 0: File I/O Error Checking
-    FILE *in = fopen(inputPath, "r");
-    if (!in) {
-        fprintf(stderr, "Error: Failed to open input file: %s\n", inputPath);
-        fprintf(stderr, "  Check that the file exists and you have read permissions.\n");
-        return 1;
+    if (watchMode) {
+        WatchOptions watch = { outputPath, batch.outputDir, batch.cache, batch.limits };
+        int status = 1;
+        if (inputCount == 0) {
+            fprintf(stderr, "Error: --watch requires at least one input file\n");
+        } else {
+            status = runWatch(&watch, inputs, inputCount);
+        }
+        free(inputs);
+        return status;
     }
-    yyin = in;
-
-    printf("Compiling: %s\n", inputPath);
-    printf("Phase 1: Lexical Analysis...\n");
-    
-    resetIR();
-    
-    // Phase 1: Lexical Analysis (handled by lexer)
-    // Phase 2: Syntax Analysis
-    printf("Phase 2: Syntax Analysis...\n");
-    if (yyparse() != 0) {
-        fprintf(stderr, "\nCompilation failed during syntax analysis.\n");
-        fclose(in);
-        errors_found = 1;
-        return 1;
+    if (inputCount > 1 || (inputCount == 1 && isBatchInput(inputs[0]))) {
+        batchMode = 1;
     }
-    fclose(in);
-
-    // Phase 3: Semantic Analysis
-    printf("Phase 3: Semantic Analysis...\n");
-    if (!root) {
-        fprintf(stderr, "Error: No valid program structure found.\n");
-        return 1;
+    if (batchMode) {
+        int status = runBatch(&batch, inputs, inputCount);
+        free(inputs);
+        return status;
     }
     
-    generateCode(root);
+    if (inputCount > 0) {
+        inputPath = inputs[0];
+    }
+    free(inputs);
     
-    // Check for generation errors
-    if (hasGenerationError()) {
-        fprintf(stderr, "\nCompilation failed during semantic analysis.\n");
-        errors_found = 1;
-        return 1;
+    if (!inputPath) {
+        inputPath = "tests/examples/test.algo";
     }
     
-    if (errors_found) {
+    if (!outputPath) {
+        outputPath = jsonToJsMode ? "visualizer.js" : "output.json";
+    }
+
+    CompilerContext ctx;
+    initCompilerContext(&ctx, inputPath);
+    setCompilerCache(&ctx, batch.cache);
+    setCompilerLimits(&ctx, batch.limits);
+    CompileStatus status = compileFile(&ctx, outputPath);
+    freeCompilerContext(&ctx);
+    if (status != COMPILE_OK) {
         return 1;
     }
     
-    // Phase 4: Code Generation
-    printf("Phase 4: Code Generation...\n");
-    writeIRToJSON(outputPath);
-    
     if (jsonToJsMode) {
         // Convert JSON to JavaScript
         printf("\nConverting to JavaScript...\n");
@@ -130,7 +250,7 @@ int main(int argc, char **argv) {
             fprintf(stderr, "\nError: Failed to convert JSON to JavaScript\n");
             return 1;
         }
-    } else {
+    } else if (visualizeMode) {
         // CLI Visualization
         printf("\n[SUCCESS] Compilation successful! Output written to %s\n", outputPath);
         printf("\nStarting CLI visualization...\n\n");
@@ -4,63 +4,89 @@
 #include <string.h>
 #include "ast.h"
 #include "ir.h"
-
-void yyerror(const char *s);
-int yylex(void);
-extern int yylineno;
-extern char *yytext;
-
-ASTNode *root = NULL; // global root used by main.c
-static const char *current_file = NULL;
-
-// Enhanced error reporting
-void reportSyntaxError(const char *msg, const char *token);
+#include "compiler.h"
 %}
 
 %code requires {
-typedef struct ASTNode ASTNode; /* Forward declaration for yylval types in header */
+#include "ast.h" /* ASTNode, ASTList and NumberList for yylval */
+typedef struct CompilerContext CompilerContext;
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
 }
 
+%code {
+int yylex(YYSTYPE *yylval_param, YYLTYPE *yylloc_param, yyscan_t yyscanner);
+void yyerror(YYLTYPE *loc, yyscan_t scanner, CompilerContext *ctx, const char *s);
+}
+
+%define api.pure full
+%locations
+%lex-param   { yyscan_t scanner }
+%parse-param { yyscan_t scanner } { CompilerContext *ctx }
+
 %union {
     int num;
-    char *id;
+    const Symbol *id;
+    char *str;
     ASTNode *node;
+    ASTList list;
+    NumberList *numbers;
 }
 
 %token <num> NUMBER
 %token <id> ID
+%token <str> STRING
 %token FOR IF ELSE WHILE
 %token ASSIGN SEMICOLON LPAREN RPAREN LBRACE RBRACE COMMA
 %token LBRACKET RBRACKET
 %token LT GT LE GE EQ NEQ
-%token PLUSPLUS DOT
+%token PLUS MINUS STAR SLASH PERCENT AND OR
+%token PLUSPLUS MINUSMINUS DOT
 %error-verbose
 
-%type <node> program stmt_list statement assignment loop condition expr opt_stmt_list call call_stmt
-%type <node> for_init for_inc assign_nosemi inc_nosemi
-%type <node> arg_list opt_args array_decl number_list method_call
+%left OR
+%left AND
+%left EQ NEQ
+%left LT GT LE GE
+%left PLUS MINUS
+%left STAR SLASH PERCENT
+%right UMINUS
+
+%type <node> program statement assignment loop condition expr opt_stmt_list call call_stmt
+%type <node> for_init for_inc assign_nosemi inc_nosemi else_part
+%type <node> opt_args array_decl method_call
+%type <list> stmt_list arg_list
+%type <numbers> number_list
+%type <num> number
+
+// number_list is heap scratch (everything else lives in ctx->arena); free it
+// when error recovery discards a half-parsed array literal
+%destructor { freeNumberList($$); } number_list
 
 %%
 program
-    : stmt_list                 { root = $1; }
+    : stmt_list                 { ctx->root = $1.head; }
     ;
 
 stmt_list
-    : statement                 { $$ = $1; }
-    | stmt_list statement       { $$ = appendSequence($1, $2); }
+    : statement                 { $$ = startList($1); }
+    | stmt_list statement       { $$ = appendList($1, $2); }
     ;
 
 statement
-    : assignment                { $$ = $1; }
-    | loop                      { $$ = $1; }
-    | condition                 { $$ = $1; }
-    | call_stmt                 { $$ = $1; }
-    | array_decl                { $$ = $1; }
-    | method_call SEMICOLON     { $$ = $1; }
+    : assignment                { $$ = setLine($1, @1.first_line); }
+    | loop                      { $$ = setLine($1, @1.first_line); }
+    | condition                 { $$ = setLine($1, @1.first_line); }
+    | call_stmt                 { $$ = setLine($1, @1.first_line); }
+    | array_decl                { $$ = setLine($1, @1.first_line); }
+    | method_call SEMICOLON     { $$ = setLine($1, @1.first_line); }
     ;
 
 assignment
-    : ID ASSIGN expr SEMICOLON  { $$ = createAssignNode($1, $3); }
+    : assign_nosemi SEMICOLON   { $$ = $1; }
+    | inc_nosemi SEMICOLON      { $$ = $1; }
     ;
 
 for_init
@@ -73,59 +99,83 @@ for_inc
     ;
 
 assign_nosemi
-    : ID ASSIGN expr            { $$ = createAssignNode($1, $3); }
+    : ID ASSIGN expr            { $$ = createAssignNode(&ctx->arena, $1, $3); }
+    | ID LBRACKET expr RBRACKET ASSIGN expr
+                                { $$ = createElementAssignNode(&ctx->arena, $1, $3, $6); }
     ;
 
 inc_nosemi
-    : ID PLUSPLUS               { $$ = createAssignNode($1, NULL); }
+    : ID PLUSPLUS               { $$ = createAssignNode(&ctx->arena, $1, NULL); }
+    | ID MINUSMINUS             { $$ = createAssignNode(&ctx->arena, $1,
+                                      createBinaryNode(&ctx->arena, OP_SUB, createValueNode(&ctx->arena, $1),
+                                                       createNumberNode(&ctx->arena, 1))); }
     ;
 
 loop
     : FOR LPAREN for_init SEMICOLON expr SEMICOLON for_inc RPAREN LBRACE opt_stmt_list RBRACE
-                                { $$ = createLoopNode($3, $5, $7, $10); }
+                                { $$ = createLoopNode(&ctx->arena, $3, $5, $7, $10); }
+    | WHILE LPAREN expr RPAREN LBRACE opt_stmt_list RBRACE
+                                { $$ = createLoopNode(&ctx->arena, NULL, $3, NULL, $6); }
     ;
 
 condition
-    : IF LPAREN expr RPAREN LBRACE opt_stmt_list RBRACE
-                                { $$ = createIfNode($3, $6); }
+    : IF LPAREN expr RPAREN LBRACE opt_stmt_list RBRACE else_part
+                                { $$ = createIfNode(&ctx->arena, $3, $6, $8); }
+    ;
+
+else_part
+    : /* empty */               { $$ = NULL; }
+    | ELSE LBRACE opt_stmt_list RBRACE
+                                { $$ = $3; }
+    | ELSE condition            { $$ = setLine($2, @2.first_line); }
     ;
 
 opt_stmt_list
     : /* empty */               { $$ = NULL; }
-    | stmt_list                 { $$ = $1; }
+    | stmt_list                 { $$ = $1.head; }
     ;
 
 expr
-    : ID                        { $$ = createValueNode($1); }
-    | NUMBER                    { $$ = createNumberNode($1); }
-    | ID LBRACKET expr RBRACKET { $$ = createValueNode($1); }
+    : ID                        { $$ = createValueNode(&ctx->arena, $1); }
+    | NUMBER                    { $$ = createNumberNode(&ctx->arena, $1); }
+    | STRING                    { $$ = createStringNode(&ctx->arena, $1); }
+    | ID LBRACKET expr RBRACKET { $$ = createIndexNode(&ctx->arena, $1, $3); }
+    | ID LPAREN opt_args RPAREN { $$ = createAlgorithmCallNode(&ctx->arena, $1, $3); }
     | LPAREN expr RPAREN        { $$ = $2; }
-    | expr GT expr              { $$ = $1; }
-    | expr LT expr              { $$ = $1; }
+    | MINUS expr %prec UMINUS   { $$ = createNegateNode(&ctx->arena, $2); }
+    | expr PLUS expr            { $$ = createBinaryNode(&ctx->arena, OP_ADD, $1, $3); }
+    | expr MINUS expr           { $$ = createBinaryNode(&ctx->arena, OP_SUB, $1, $3); }
+    | expr STAR expr            { $$ = createBinaryNode(&ctx->arena, OP_MUL, $1, $3); }
+    | expr SLASH expr           { $$ = createBinaryNode(&ctx->arena, OP_DIV, $1, $3); }
+    | expr PERCENT expr         { $$ = createBinaryNode(&ctx->arena, OP_MOD, $1, $3); }
+    | expr LT expr              { $$ = createBinaryNode(&ctx->arena, OP_LT, $1, $3); }
+    | expr GT expr              { $$ = createBinaryNode(&ctx->arena, OP_GT, $1, $3); }
+    | expr LE expr              { $$ = createBinaryNode(&ctx->arena, OP_LE, $1, $3); }
+    | expr GE expr              { $$ = createBinaryNode(&ctx->arena, OP_GE, $1, $3); }
+    | expr EQ expr              { $$ = createBinaryNode(&ctx->arena, OP_EQ, $1, $3); }
+    | expr NEQ expr             { $$ = createBinaryNode(&ctx->arena, OP_NE, $1, $3); }
+    | expr AND expr             { $$ = createBinaryNode(&ctx->arena, OP_AND, $1, $3); }
+    | expr OR expr              { $$ = createBinaryNode(&ctx->arena, OP_OR, $1, $3); }
     ;
 
 call
     : method_call                { $$ = $1; }
-    | ID LPAREN opt_args RPAREN { $$ = createAlgorithmCallNode($1, $3); }
+    | ID LPAREN opt_args RPAREN { $$ = createAlgorithmCallNode(&ctx->arena, $1, $3); }
     ;
 
 method_call
-    : ID DOT ID LPAREN opt_args RPAREN { 
-        // Create method call: obj.method(args)
-        char full_name[128];
-        snprintf(full_name, sizeof(full_name), "%s.%s", $1, $3);
-        $$ = createAlgorithmCallNode(full_name, $5);
-      }
+    : ID DOT ID LPAREN opt_args RPAREN
+                                { $$ = createMethodCallNode(&ctx->arena, $1, $3, $5); }
     ;
 
 opt_args
     : /* empty */               { $$ = NULL; }
-    | arg_list                  { $$ = $1; }
+    | arg_list                  { $$ = $1.head; }
     ;
 
 arg_list
-    : expr                      { $$ = $1; }
-    | arg_list COMMA expr       { $$ = appendSequence($1, $3); }
+    : expr                      { $$ = startList($1); }
+    | arg_list COMMA expr       { $$ = appendList($1, $3); }
     ;
 
 call_stmt
@@ -134,43 +184,32 @@ call_stmt
 
 array_decl
     : ID LBRACKET RBRACKET ASSIGN LBRACKET number_list RBRACKET SEMICOLON
-                                { $$ = createArrayDeclNode($1, $6 ? $6->array_values : NULL, $6 ? $6->array_count : 0); }
+                                { $$ = createArrayDeclNode(&ctx->arena, $1, $6 ? $6->values : NULL, $6 ? $6->count : 0);
+                                  // The literal is copied into the arena; drop the scratch list
+                                  freeNumberList($6);
+                                  if (!$$) { yyerror(&@$, scanner, ctx, "out of memory"); YYABORT; } }
+    | ID LBRACKET RBRACKET ASSIGN ID LPAREN opt_args RPAREN SEMICOLON
+                                { $$ = createArrayInitNode(&ctx->arena, $1, createAlgorithmCallNode(&ctx->arena, $5, $7)); }
     ;
 
 number_list
-    : NUMBER                    { ASTNode *node = (ASTNode *)calloc(1, sizeof(ASTNode)); 
-                                  if (node) {
-                                    node->array_values = (int *)malloc(sizeof(int)); 
-                                    if (node->array_values) {
-                                      node->array_values[0] = $1; 
-                                      node->array_count = 1;
-                                    }
-                                  }
-                                  $$ = node; }
-    | number_list COMMA NUMBER { ASTNode *prev = (ASTNode*)$1;
-                                  ASTNode *node = (ASTNode *)calloc(1, sizeof(ASTNode));
-                                  if (node && prev) {
-                                    node->array_count = prev->array_count + 1;
-                                    node->array_values = (int *)malloc(node->array_count * sizeof(int));
-                                    if (node->array_values) {
-                                      for (int i = 0; i < prev->array_count; i++) {
-                                        node->array_values[i] = prev->array_values[i];
-                                      }
-                                      node->array_values[node->array_count - 1] = $3;
-                                      free(prev->array_values);
-                                      free(prev);
-                                    }
-                                  } else if (node) {
-                                    node->array_values = (int *)malloc(sizeof(int));
-                                    if (node->array_values) {
-                                      node->array_values[0] = $3;
-                                      node->array_count = 1;
-                                    }
-                                  }
-                                  $$ = node; }
+    : number                    { $$ = appendNumber(NULL, $1);
+                                  if (!$$) { yyerror(&@$, scanner, ctx, "out of memory"); YYABORT; } }
+    | number_list COMMA number  { $$ = appendNumber($1, $3);
+                                  // appendNumber has freed $1, so YYABORT leaves nothing behind
+                                  if (!$$) { yyerror(&@$, scanner, ctx, "out of memory"); YYABORT; } }
+    ;
+
+number
+    : NUMBER                    { $$ = $1; }
+    | MINUS NUMBER              { $$ = (int)(0u - (unsigned)$2); }
     ;
 
 %%
-void yyerror(const char *s) { fprintf(stderr, "Error: %s\n", s); }
+void yyerror(YYLTYPE *loc, yyscan_t scanner, CompilerContext *ctx, const char *s) {
+    (void)loc;
+    (void)scanner;
+    reportCompileError(ctx, "Error: %s", s);
+}
 
 
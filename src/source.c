@@ -0,0 +1,133 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "source.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// flex's yy_scan_buffer wants the text followed by two NUL bytes
+#define SENTINEL_BYTES 2
+
+static int readWhole(SourceFile *src, FILE *in, size_t size) {
+    src->data = (char *)malloc(size + SENTINEL_BYTES);
+    if (!src->data) return -1;
+    size_t got = fread(src->data, 1, size, in);
+    if (got != size && ferror(in)) {
+        free(src->data);
+        src->data = NULL;
+        return -1;
+    }
+    memset(src->data + got, 0, SENTINEL_BYTES);
+    src->size = got;
+    return 0;
+}
+
+#ifdef _WIN32
+
+int openSource(SourceFile *src, const char *path) {
+    memset(src, 0, sizeof(*src));
+    if (strcmp(path, "-") == 0) {
+        src->stream = stdin;
+        return 0;
+    }
+    FILE *in = fopen(path, "rb");
+    if (!in) return -1;
+    long size = -1;
+    if (fseek(in, 0, SEEK_END) == 0) {
+        size = ftell(in);
+        rewind(in);
+    }
+    if (size < 0) {
+        src->stream = in;  // Not seekable: stream it
+        return 0;
+    }
+    int result = readWhole(src, in, (size_t)size);
+    fclose(in);
+    return result;
+}
+
+#else
+
+int openSource(SourceFile *src, const char *path) {
+    memset(src, 0, sizeof(*src));
+    if (strcmp(path, "-") == 0) {
+        src->stream = stdin;
+        return 0;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        src->stream = fdopen(fd, "r");
+        if (!src->stream) {
+            close(fd);
+            return -1;
+        }
+        return 0;
+    }
+
+    size_t size = (size_t)st.st_size;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t tail = page > 0 ? size % (size_t)page : 0;
+    // The sentinel must come from the zero-filled rest of the last page;
+    // touching a page wholly past EOF would raise SIGBUS
+    if (size > 0 && tail != 0 && (size_t)page - tail >= SENTINEL_BYTES) {
+        // Private and writable: flex writes NULs after tokens, and only the
+        // pages it touches are copied
+        void *map = mmap(NULL, size + SENTINEL_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        // A file truncated while we mapped it would SIGBUS on the lost
+        // pages, so check it is still as long as the mapping assumes and
+        // read whatever is left otherwise
+        struct stat now;
+        if (map != MAP_FAILED && (fstat(fd, &now) != 0 || now.st_size != st.st_size)) {
+            munmap(map, size + SENTINEL_BYTES);
+            map = MAP_FAILED;
+            size = fstat(fd, &now) == 0 && now.st_size > 0 ? (size_t)now.st_size : 0;
+            lseek(fd, 0, SEEK_SET);
+        }
+        if (map != MAP_FAILED) {
+            posix_madvise(map, size + SENTINEL_BYTES, POSIX_MADV_SEQUENTIAL);
+            close(fd);
+            src->data = (char *)map;
+            src->size = size;
+            src->mapped = size + SENTINEL_BYTES;
+            return 0;
+        }
+    }
+
+    FILE *in = fdopen(fd, "rb");
+    if (!in) {
+        close(fd);
+        return -1;
+    }
+    int result = readWhole(src, in, size);
+    fclose(in);
+    return result;
+}
+
+#endif
+
+void closeSource(SourceFile *src) {
+#ifndef _WIN32
+    if (src->mapped) {
+        munmap(src->data, src->mapped);
+    } else
+#endif
+    {
+        free(src->data);
+    }
+    if (src->stream && src->stream != stdin) fclose(src->stream);
+    memset(src, 0, sizeof(*src));
+}
@@ -0,0 +1,21 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Program text handed to the scanner. Regular files are mapped (or read in
+// one go) so flex can scan them in place with yy_scan_buffer; pipes,
+// terminals and "-" (stdin) are streamed through `stream` instead.
+typedef struct SourceFile {
+    char *data;      // size bytes of text + two NULs (flex's end sentinel), or NULL
+    size_t size;
+    size_t mapped;   // Length of the private mapping, 0 if data is heap memory
+    FILE *stream;    // Set when data is NULL
+} SourceFile;
+
+// Returns 0 on success, -1 if the file cannot be opened or read
+int openSource(SourceFile *src, const char *path);
+void closeSource(SourceFile *src);
+
+#endif
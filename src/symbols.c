@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <string.h>
+#include "symbols.h"
+
+#define INITIAL_CAPACITY 64
+
+static const char *const builtinNames[SYM_BUILTIN_COUNT] = {
+    [SYM_NONE] = "",
+    [SYM_BUBBLE_SORT] = "bubble_sort",
+    [SYM_INSERTION_SORT] = "insertion_sort",
+    [SYM_SELECTION_SORT] = "selection_sort",
+    [SYM_MERGE_SORT] = "merge_sort",
+    [SYM_QUICK_SORT] = "quick_sort",
+    [SYM_QUICKSORT] = "quicksort",
+    [SYM_HEAP_SORT] = "heap_sort",
+    [SYM_SHELL_SORT] = "shell_sort",
+    [SYM_RADIX_SORT] = "radix_sort",
+    [SYM_TIM_SORT] = "tim_sort",
+    [SYM_BITONIC_SORT] = "bitonic_sort",
+    [SYM_PARALLEL_MERGE_SORT] = "parallel_merge_sort",
+    [SYM_SAMPLE_SORT] = "sample_sort",
+    [SYM_ODD_EVEN_SORT] = "odd_even_sort",
+    [SYM_STACK] = "stack",
+    [SYM_QUEUE] = "queue",
+    [SYM_TREE] = "tree",
+    [SYM_GRAPH] = "graph",
+    [SYM_PUSH] = "push",
+    [SYM_POP] = "pop",
+    [SYM_PEEK] = "peek",
+    [SYM_TOP] = "top",
+    [SYM_ENQUEUE] = "enqueue",
+    [SYM_DEQUEUE] = "dequeue",
+    [SYM_INSERT] = "insert",
+    [SYM_TRAVERSE_INORDER] = "traverse_inorder",
+    [SYM_TRAVERSE_PREORDER] = "traverse_preorder",
+    [SYM_TRAVERSE_POSTORDER] = "traverse_postorder",
+    [SYM_ADD_NODE] = "add_node",
+    [SYM_ADD_EDGE] = "add_edge",
+    [SYM_BFS] = "bfs",
+    [SYM_DFS] = "dfs",
+    [SYM_LOAD] = "load",
+    [SYM_RANDOM] = "random",
+    [SYM_SORTED] = "sorted",
+    [SYM_REVERSED] = "reversed",
+    [SYM_NEARLY_SORTED] = "nearly_sorted",
+    [SYM_FEW_UNIQUE] = "few_unique",
+    [SYM_ORGAN_PIPE] = "organ_pipe",
+    [SYM_SWAP] = "swap",
+    [SYM_LEN] = "len",
+};
+
+// FNV-1a
+static unsigned hashName(const char *name, size_t length) {
+    unsigned hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int growTable(SymbolTable *table) {
+    size_t capacity = table->capacity ? table->capacity * 2 : INITIAL_CAPACITY;
+    const Symbol **slots = (const Symbol **)calloc(capacity, sizeof(*slots));
+    if (!slots) return 0;
+    for (size_t i = 0; i < table->capacity; i++) {
+        const Symbol *sym = table->slots[i];
+        if (!sym) continue;
+        size_t j = sym->hash & (capacity - 1);
+        while (slots[j]) j = (j + 1) & (capacity - 1);
+        slots[j] = sym;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return 1;
+}
+
+// Adds a symbol known not to be present. `name` is used as-is when `copy`
+// is 0 (static built-in names), otherwise copied into the arena.
+static const Symbol *addSymbol(SymbolTable *table, const char *name, size_t length,
+                               unsigned hash, size_t slot, int copy) {
+    Symbol *sym = (Symbol *)arenaAlloc(table->arena, sizeof(Symbol));
+    if (!sym) return NULL;
+    sym->name = copy ? arenaStrndup(table->arena, name, length) : name;
+    if (!sym->name) return NULL;
+    sym->length = length;
+    sym->hash = hash;
+    sym->id = (int)table->count;
+    table->slots[slot] = sym;
+    table->count++;
+    return sym;
+}
+
+static const Symbol *lookup(SymbolTable *table, const char *name, size_t length, int copy) {
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    if ((table->count + 1) * 2 > table->capacity && !growTable(table)) return NULL;
+
+    unsigned hash = hashName(name, length);
+    size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+    while (table->slots[i]) {
+        const Symbol *sym = table->slots[i];
+        if (sym->hash == hash && sym->length == length && memcmp(sym->name, name, length) == 0) {
+            return sym;
+        }
+        i = (i + 1) & mask;
+    }
+    return addSymbol(table, name, length, hash, i, copy);
+}
+
+int initSymbolTable(SymbolTable *table, Arena *arena) {
+    table->arena = arena;
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+    for (int id = 0; id < SYM_BUILTIN_COUNT; id++) {
+        const char *name = builtinNames[id];
+        if (!lookup(table, name, strlen(name), 0)) return 0;
+    }
+    return 1;
+}
+
+void freeSymbolTable(SymbolTable *table) {
+    free(table->slots);
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+const Symbol *internSymbol(SymbolTable *table, const char *name, size_t length) {
+    return lookup(table, name, length, 1);
+}
+
+const char *builtinName(SymbolId id) {
+    return id >= 0 && id < SYM_BUILTIN_COUNT ? builtinNames[id] : "";
+}
@@ -0,0 +1,96 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stddef.h>
+#include "arena.h"
+
+// Names the compiler gives meaning to. They are interned first, in this
+// order, so a symbol's id equals its SymbolId and semantic checks compare
+// integers instead of strings. User identifiers get ids from
+// SYM_BUILTIN_COUNT upwards.
+typedef enum {
+    SYM_NONE = 0,
+
+    // Algorithms
+    SYM_BUBBLE_SORT,
+    SYM_INSERTION_SORT,
+    SYM_SELECTION_SORT,
+    SYM_MERGE_SORT,
+    SYM_QUICK_SORT,
+    SYM_QUICKSORT,
+    SYM_HEAP_SORT,
+    SYM_SHELL_SORT,
+    SYM_RADIX_SORT,
+    SYM_TIM_SORT,
+    SYM_BITONIC_SORT,
+    SYM_PARALLEL_MERGE_SORT,
+    SYM_SAMPLE_SORT,
+    SYM_ODD_EVEN_SORT,
+
+    // Data structures (keep contiguous: see STRUCTURE_BIT in codegen.c)
+    SYM_STACK,
+    SYM_QUEUE,
+    SYM_TREE,
+    SYM_GRAPH,
+
+    // Data structure methods
+    SYM_PUSH,
+    SYM_POP,
+    SYM_PEEK,
+    SYM_TOP,
+    SYM_ENQUEUE,
+    SYM_DEQUEUE,
+    SYM_INSERT,
+    SYM_TRAVERSE_INORDER,
+    SYM_TRAVERSE_PREORDER,
+    SYM_TRAVERSE_POSTORDER,
+    SYM_ADD_NODE,
+    SYM_ADD_EDGE,
+    SYM_BFS,
+    SYM_DFS,
+
+    // Array initialisers: arr[] = load("file");  (load is also a graph method)
+    SYM_LOAD,
+    SYM_RANDOM,
+    SYM_SORTED,
+    SYM_REVERSED,
+    SYM_NEARLY_SORTED,
+    SYM_FEW_UNIQUE,
+    SYM_ORGAN_PIPE,
+
+    // Intrinsics of user-written statements: swap(arr[i], arr[j]), len(arr)
+    SYM_SWAP,
+    SYM_LEN,
+
+    SYM_BUILTIN_COUNT
+} SymbolId;
+
+typedef struct Symbol {
+    const char *name;   // NUL-terminated, stable for the table's lifetime
+    size_t length;
+    unsigned hash;
+    int id;             // SymbolId for built-ins
+} Symbol;
+
+// Open-addressing hash table of distinct identifiers. Symbols and their
+// strings live in the owning compilation's arena; only the slot array is
+// heap-allocated so it can grow.
+typedef struct SymbolTable {
+    Arena *arena;
+    const Symbol **slots;
+    size_t capacity;     // Power of two
+    size_t count;
+} SymbolTable;
+
+// Creates the table with every SymbolId already interned
+int initSymbolTable(SymbolTable *table, Arena *arena);
+void freeSymbolTable(SymbolTable *table);
+
+// Returns the unique symbol for name[0..length), adding it if new.
+// NULL only when out of memory.
+const Symbol *internSymbol(SymbolTable *table, const char *name, size_t length);
+
+// Spelling of a built-in name ("" for ids outside the enum)
+const char *builtinName(SymbolId id);
+
+#endif
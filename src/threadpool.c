@@ -0,0 +1,259 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "threadpool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct {
+    ThreadPoolTask fn;
+    void *arg;
+} PoolTask;
+
+// Ring-buffer deque; owner pushes/pops at the bottom, thieves take the top
+typedef struct {
+    pthread_mutex_t lock;
+    PoolTask *tasks;
+    int capacity;
+    int top;    // Index of the oldest task
+    int count;
+} WorkerDeque;
+
+typedef struct {
+    ThreadPool *pool;
+    int id;
+} WorkerArgs;
+
+struct ThreadPool {
+    int size;                       // Number of running workers
+    int deque_count;                // Fixed before any worker starts
+    pthread_t *threads;
+    WorkerArgs *args;
+    WorkerDeque *deques;
+    pthread_mutex_t lock;           // Guards sleeping workers and waiters
+    pthread_cond_t work_available;
+    pthread_cond_t all_done;
+    atomic_int queued;              // Tasks sitting in deques
+    atomic_int pending;             // Tasks submitted but not yet finished
+    atomic_uint next_deque;         // Round-robin target for external submits
+    int shutting_down;
+};
+
+static _Thread_local ThreadPool *current_pool = NULL;
+static _Thread_local int current_worker = -1;
+
+static void threadPoolDestroyWorkers(ThreadPool *pool, int running);
+
+static int dequePush(WorkerDeque *dq, PoolTask task) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count == dq->capacity) {
+        int newcap = dq->capacity ? dq->capacity * 2 : 64;
+        PoolTask *grown = (PoolTask *)malloc(sizeof(PoolTask) * newcap);
+        if (!grown) {
+            pthread_mutex_unlock(&dq->lock);
+            return 0;
+        }
+        for (int i = 0; i < dq->count; i++) {
+            grown[i] = dq->tasks[(dq->top + i) % dq->capacity];
+        }
+        free(dq->tasks);
+        dq->tasks = grown;
+        dq->capacity = newcap;
+        dq->top = 0;
+    }
+    dq->tasks[(dq->top + dq->count) % dq->capacity] = task;
+    dq->count++;
+    pthread_mutex_unlock(&dq->lock);
+    return 1;
+}
+
+static int dequePopBottom(ThreadPool *pool, WorkerDeque *dq, PoolTask *out) {
+    int found = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count > 0) {
+        dq->count--;
+        *out = dq->tasks[(dq->top + dq->count) % dq->capacity];
+        atomic_fetch_sub(&pool->queued, 1);
+        found = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return found;
+}
+
+static int dequeStealTop(ThreadPool *pool, WorkerDeque *dq, PoolTask *out) {
+    int found = 0;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count > 0) {
+        *out = dq->tasks[dq->top];
+        dq->top = (dq->top + 1) % dq->capacity;
+        dq->count--;
+        atomic_fetch_sub(&pool->queued, 1);
+        found = 1;
+    }
+    pthread_mutex_unlock(&dq->lock);
+    return found;
+}
+
+static int findTask(ThreadPool *pool, int self, PoolTask *out) {
+    if (dequePopBottom(pool, &pool->deques[self], out)) return 1;
+    for (int i = 1; i < pool->deque_count; i++) {
+        int victim = (self + i) % pool->deque_count;
+        if (dequeStealTop(pool, &pool->deques[victim], out)) return 1;
+    }
+    return 0;
+}
+
+static void runTask(ThreadPool *pool, PoolTask task) {
+    task.fn(task.arg);
+    if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->all_done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *workerMain(void *arg) {
+    WorkerArgs *wa = (WorkerArgs *)arg;
+    ThreadPool *pool = wa->pool;
+    current_pool = pool;
+    current_worker = wa->id;
+
+    for (;;) {
+        PoolTask task;
+        if (findTask(pool, wa->id, &task)) {
+            runTask(pool, task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->shutting_down) {
+            pthread_cond_wait(&pool->work_available, &pool->lock);
+        }
+        int stop = pool->shutting_down && atomic_load(&pool->queued) == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) break;
+    }
+    return NULL;
+}
+
+ThreadPool *threadPoolCreate(int threads) {
+    if (threads < 1) threads = 1;
+    ThreadPool *pool = (ThreadPool *)calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->threads = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    pool->args = (WorkerArgs *)calloc(threads, sizeof(WorkerArgs));
+    pool->deques = (WorkerDeque *)calloc(threads, sizeof(WorkerDeque));
+    if (!pool->threads || !pool->args || !pool->deques) {
+        free(pool->threads);
+        free(pool->args);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_available, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->next_deque, 0);
+    pool->deque_count = threads;
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+    for (int i = 0; i < threads; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].id = i;
+    }
+    pool->size = 0;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, workerMain, &pool->args[i]) != 0) {
+            break;  // Run with the workers we managed to start
+        }
+        pool->size++;
+    }
+    if (pool->size == 0) {
+        threadPoolDestroyWorkers(pool, 0);
+        return NULL;
+    }
+    return pool;
+}
+
+void threadPoolSubmit(ThreadPool *pool, ThreadPoolTask fn, void *arg) {
+    PoolTask task = { fn, arg };
+    int target;
+    if (current_pool == pool && current_worker >= 0) {
+        target = current_worker;
+    } else {
+        target = (int)(atomic_fetch_add(&pool->next_deque, 1) % (unsigned)pool->deque_count);
+    }
+
+    atomic_fetch_add(&pool->pending, 1);
+    atomic_fetch_add(&pool->queued, 1);
+    if (!dequePush(&pool->deques[target], task)) {
+        // Out of memory: run inline rather than drop the task
+        atomic_fetch_sub(&pool->queued, 1);
+        runTask(pool, task);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void threadPoolWait(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&pool->pending) > 0) {
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void threadPoolDestroyWorkers(ThreadPool *pool, int running) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = 1;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < running; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->deque_count; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_cond_destroy(&pool->all_done);
+    pthread_cond_destroy(&pool->work_available);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->deques);
+    free(pool->args);
+    free(pool->threads);
+    free(pool);
+}
+
+void threadPoolDestroy(ThreadPool *pool) {
+    if (!pool) return;
+    threadPoolDestroyWorkers(pool, pool->size);
+}
+
+int threadPoolSize(const ThreadPool *pool) {
+    return pool->size;
+}
+
+int threadPoolDefaultSize(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
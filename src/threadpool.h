@@ -0,0 +1,20 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+typedef void (*ThreadPoolTask)(void *arg);
+
+typedef struct ThreadPool ThreadPool;
+
+// Work-stealing pool: every worker owns a deque. Tasks submitted from a
+// worker go to the bottom of its own deque (LIFO, cache-warm); idle workers
+// steal from the top of other deques (FIFO, oldest work first).
+ThreadPool *threadPoolCreate(int threads);
+void threadPoolSubmit(ThreadPool *pool, ThreadPoolTask fn, void *arg);
+void threadPoolWait(ThreadPool *pool);
+void threadPoolDestroy(ThreadPool *pool);
+int threadPoolSize(const ThreadPool *pool);
+
+// Number of online CPUs (at least 1)
+int threadPoolDefaultSize(void);
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include "tracecache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#define ENTRY_SUFFIX ".trace"
+#define HEADER_TAG "dsa-trace"
+
+static int replaceFile(const char *from, const char *to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+static void entryPath(char *out, size_t size, const TraceCache *cache, const char *key) {
+    snprintf(out, size, "%s/%s%s", cache->dir, key, ENTRY_SUFFIX);
+}
+
+// Temporary names are unique per destination, so threads storing or
+// fetching the same key at once never share a file
+static void tempPath(char *out, size_t size, const char *target, const char *other) {
+    unsigned hash = 2166136261u;
+    for (const char *p = other; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    snprintf(out, size, "%s.%08x.tmp", target, hash);
+}
+
+static int copyRest(FILE *in, FILE *out) {
+    char buffer[64 * 1024];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, got, out) != got) return -1;
+    }
+    return ferror(in) ? -1 : 0;
+}
+
+int fetchCachedTrace(const TraceCache *cache, const char *key, const char *outputPath, int maxSteps, int *steps) {
+    char path[1024], tmp[1100];
+    entryPath(path, sizeof(path), cache, key);
+    FILE *in = fopen(path, "rb");
+    if (!in) return 0;
+    int count;
+    if (fscanf(in, HEADER_TAG " %d", &count) != 1 || fgetc(in) != '\n' || (maxSteps > 0 && count > maxSteps)) {
+        fclose(in);
+        return 0;
+    }
+    tempPath(tmp, sizeof(tmp), outputPath, key);
+    FILE *out = fopen(tmp, "wb");
+    if (!out) {
+        fclose(in);
+        return 0;
+    }
+    int status = copyRest(in, out);
+    fclose(in);
+    if (fclose(out) != 0 || status != 0 || replaceFile(tmp, outputPath) != 0) {
+        remove(tmp);
+        return 0;
+    }
+    utime(path, NULL);  // Most recently used
+    *steps = count;
+    return 1;
+}
+
+typedef struct {
+    char *path;
+    long long size;
+    time_t used;
+} CacheEntry;
+
+static int compareByUse(const void *a, const void *b) {
+    const CacheEntry *x = (const CacheEntry *)a, *y = (const CacheEntry *)b;
+    return (x->used > y->used) - (x->used < y->used);
+}
+
+static void evict(const TraceCache *cache) {
+    DIR *d = opendir(cache->dir);
+    if (!d) return;
+    CacheEntry *entries = NULL;
+    int count = 0, capacity = 0;
+    long long total = 0;
+    struct dirent *ent;
+    size_t suffixLen = strlen(ENTRY_SUFFIX);
+    while ((ent = readdir(d)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len <= suffixLen || strcmp(ent->d_name + len - suffixLen, ENTRY_SUFFIX) != 0) continue;
+        if (count == capacity) {
+            int grown = capacity ? capacity * 2 : 64;
+            CacheEntry *bigger = (CacheEntry *)realloc(entries, sizeof(CacheEntry) * grown);
+            if (!bigger) break;
+            entries = bigger;
+            capacity = grown;
+        }
+        size_t pathLen = strlen(cache->dir) + len + 2;
+        char *path = (char *)malloc(pathLen);
+        if (!path) break;
+        snprintf(path, pathLen, "%s/%s", cache->dir, ent->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            free(path);  // Evicted by someone else meanwhile
+            continue;
+        }
+        entries[count].path = path;
+        entries[count].size = (long long)st.st_size;
+        entries[count].used = st.st_mtime;
+        total += entries[count].size;
+        count++;
+    }
+    closedir(d);
+
+    if (total > cache->maxBytes) {
+        qsort(entries, count, sizeof(CacheEntry), compareByUse);
+        for (int i = 0; i < count && total > cache->maxBytes; i++) {
+            if (remove(entries[i].path) == 0) total -= entries[i].size;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        free(entries[i].path);
+    }
+    free(entries);
+}
+
+void storeCachedTrace(const TraceCache *cache, const char *key, const char *tracePath, int steps) {
+    char path[1024], tmp[1100];
+    struct stat st;
+    if (stat(cache->dir, &st) != 0) {
+#ifdef _WIN32
+        _mkdir(cache->dir);
+#else
+        mkdir(cache->dir, 0777);
+#endif
+    }
+    entryPath(path, sizeof(path), cache, key);
+    tempPath(tmp, sizeof(tmp), path, tracePath);
+    FILE *in = fopen(tracePath, "rb");
+    if (!in) return;
+    FILE *out = fopen(tmp, "wb");
+    if (!out) {
+        fclose(in);
+        return;
+    }
+    fprintf(out, HEADER_TAG " %d\n", steps);
+    int status = copyRest(in, out);
+    fclose(in);
+    if (fclose(out) != 0 || status != 0 || replaceFile(tmp, path) != 0) {
+        remove(tmp);
+        return;
+    }
+    evict(cache);
+}
@@ -0,0 +1,29 @@
+#ifndef TRACECACHE_H
+#define TRACECACHE_H
+
+// On-disk store of generated traces, keyed by programKey. An entry is
+// <dir>/<key>.trace: a "dsa-trace <steps>" header line followed by the
+// trace JSON. Entries are published with a rename, so concurrent compiles
+// (batch mode, several processes) never read a partial entry. A hit
+// refreshes the entry's modification time, and each store evicts the least
+// recently used entries until the directory fits in maxBytes.
+typedef struct TraceCache {
+    const char *dir;
+    long long maxBytes;
+} TraceCache;
+
+#define TRACE_CACHE_DEFAULT_MB 256
+
+// Writes the cached trace for `key` to outputPath (atomically). Returns 1
+// and sets *steps on a hit, 0 on a miss. The key does not cover the
+// limits, so an entry of more than maxSteps steps (0 = no limit) counts as
+// a miss and is regenerated, to fail the step limit as any compile would.
+// The timeout bounds generating steps, which a hit does not do, so it
+// is not checked.
+int fetchCachedTrace(const TraceCache *cache, const char *key, const char *outputPath, int maxSteps, int *steps);
+
+// Copies tracePath, just generated for `key`, into the cache. Best effort:
+// a cache that cannot be written only costs the next compile its hit.
+void storeCachedTrace(const TraceCache *cache, const char *key, const char *tracePath, int steps);
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "traceevents.h"
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2  // GetProcessMemoryInfo from kernel32, no -lpsapi
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+typedef struct {
+    char name[64];
+    const char *category;  // String literal
+    char phase;            // 'X' complete span, 'C' counter
+    int tid;
+    double ts;             // Microseconds
+    double dur;
+    char args[192];        // Members of the "args" object
+} TraceEvent;
+
+static atomic_int active;
+static double originUs;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceEvent *events;
+static size_t eventCount;
+static size_t eventCapacity;
+static atomic_int nextThreadId;
+static _Thread_local int threadId;  // 0 until the thread records
+
+static double clockUs(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1e6 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+#endif
+}
+
+void traceEventsStart(void) {
+    originUs = clockUs();
+    threadId = atomic_fetch_add(&nextThreadId, 1) + 1;  // The caller is "main"
+    atomic_store(&active, 1);
+}
+
+int traceEventsActive(void) {
+    return atomic_load_explicit(&active, memory_order_relaxed);
+}
+
+double traceNowUs(void) {
+    if (!traceEventsActive()) return 0.0;
+    return clockUs() - originUs;
+}
+
+static void record(const TraceEvent *event) {
+    pthread_mutex_lock(&lock);
+    if (eventCount == eventCapacity) {
+        size_t grown = eventCapacity ? eventCapacity * 2 : 1024;
+        TraceEvent *bigger = (TraceEvent *)realloc(events, grown * sizeof(TraceEvent));
+        if (!bigger) {
+            pthread_mutex_unlock(&lock);
+            return;  // Drop the event rather than disturb the program
+        }
+        events = bigger;
+        eventCapacity = grown;
+    }
+    events[eventCount++] = *event;
+    pthread_mutex_unlock(&lock);
+}
+
+static void fillEvent(TraceEvent *event, const char *name, const char *category, char phase,
+                      const char *argsFormat, va_list args) {
+    if (threadId == 0) threadId = atomic_fetch_add(&nextThreadId, 1) + 1;
+    snprintf(event->name, sizeof(event->name), "%s", name);
+    event->category = category;
+    event->phase = phase;
+    event->tid = threadId;
+    event->args[0] = '\0';
+    if (argsFormat) vsnprintf(event->args, sizeof(event->args), argsFormat, args);
+}
+
+void traceSpan(const char *name, const char *category, double startUs, const char *argsFormat, ...) {
+    if (!traceEventsActive()) return;
+    TraceEvent event;
+    va_list args;
+    va_start(args, argsFormat);
+    fillEvent(&event, name, category, 'X', argsFormat, args);
+    va_end(args);
+    event.ts = startUs;
+    event.dur = traceNowUs() - startUs;
+    record(&event);
+}
+
+void traceSpanFor(const char *name, const char *category, double startUs, double durUs,
+                  const char *argsFormat, ...) {
+    if (!traceEventsActive()) return;
+    TraceEvent event;
+    va_list args;
+    va_start(args, argsFormat);
+    fillEvent(&event, name, category, 'X', argsFormat, args);
+    va_end(args);
+    event.ts = startUs;
+    event.dur = durUs;
+    record(&event);
+}
+
+void traceCounter(const char *name, const char *argsFormat, ...) {
+    if (!traceEventsActive()) return;
+    TraceEvent event;
+    va_list args;
+    va_start(args, argsFormat);
+    fillEvent(&event, name, "memory", 'C', argsFormat, args);
+    va_end(args);
+    event.ts = traceNowUs();
+    event.dur = 0.0;
+    record(&event);
+}
+
+void traceEscape(char *out, size_t size, const char *text) {
+    size_t len = 0;
+    for (; *text && len + 7 < size; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') {
+            out[len++] = '\\';
+            out[len++] = (char)c;
+        } else if (c < 0x20) {
+            len += (size_t)snprintf(out + len, size - len, "\\u%04x", c);
+        } else {
+            out[len++] = (char)c;
+        }
+    }
+    out[len] = '\0';
+}
+
+void traceMemory(void) {
+    if (!traceEventsActive()) return;
+    long long peakKb = 0;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        peakKb = (long long)(counters.PeakWorkingSetSize / 1024);
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        peakKb = (long long)usage.ru_maxrss / 1024;  // Bytes on macOS
+#else
+        peakKb = (long long)usage.ru_maxrss;
+#endif
+    }
+#endif
+    traceCounter("peak RSS", "\"kB\": %lld", peakKb);
+}
+
+int traceEventsWrite(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s for writing\n", path);
+        return -1;
+    }
+    pthread_mutex_lock(&lock);
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (size_t i = 0; i < eventCount; i++) {
+        const TraceEvent *e = &events[i];
+        fprintf(fp, "  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%c\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f",
+                e->name, e->category, e->phase, e->tid, e->ts);
+        if (e->phase == 'X') fprintf(fp, ", \"dur\": %.3f", e->dur);
+        fprintf(fp, ", \"args\": {%s}},\n", e->args);
+    }
+    fprintf(fp, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"main\"}}\n");
+    fprintf(fp, "]}\n");
+    pthread_mutex_unlock(&lock);
+    return fclose(fp) == 0 ? 0 : -1;
+}
@@ -0,0 +1,43 @@
+#ifndef TRACEEVENTS_H
+#define TRACEEVENTS_H
+
+#include <stddef.h>
+
+// Chrome trace-event recorder for profiling the compiler and visualizer
+// (open the output in chrome://tracing or ui.perfetto.dev). Nothing is
+// recorded until traceEventsStart; until then traceNowUs returns 0 without
+// reading the clock and the record calls return after one flag check.
+//
+//     double start = traceNowUs();
+//     ...work...
+//     traceSpan("parse", "compile", start, "\"tokens\": %d", tokens);
+
+void traceEventsStart(void);
+int traceEventsActive(void);
+
+// Microseconds since traceEventsStart (0 while inactive)
+double traceNowUs(void);
+
+// Complete event from startUs to now on the calling thread. `argsFormat`
+// (may be NULL) is printf-style and yields the members of the "args"
+// object, e.g. "\"file\": \"%s\"".
+void traceSpan(const char *name, const char *category, double startUs, const char *argsFormat, ...);
+
+// Complete event of a given length, for time that was accumulated in
+// pieces (e.g. scanning, interleaved with parsing) rather than measured
+void traceSpanFor(const char *name, const char *category, double startUs, double durUs,
+                  const char *argsFormat, ...);
+
+// Counter event: one or more named series sampled now
+void traceCounter(const char *name, const char *argsFormat, ...);
+
+// Copies `text` into `out` as the inside of a JSON string, for args
+void traceEscape(char *out, size_t size, const char *text);
+
+// Samples process memory (peak RSS) as a counter
+void traceMemory(void);
+
+// Writes every recorded event to `path`. Returns 0 on success.
+int traceEventsWrite(const char *path);
+
+#endif
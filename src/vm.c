@@ -0,0 +1,758 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <limits.h>
+#include "vm.h"
+#include "batch.h"
+
+// Computed-goto dispatch where the compiler supports labels as values:
+// every handler ends in its own indirect jump, which predicts far better
+// than the single shared jump of a switch
+#if defined(__GNUC__) && !defined(VM_SWITCH_DISPATCH)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+typedef struct {
+    VMProgram *program;
+    int *variables;      // Register per symbol id, -1 if not a variable
+    int *arraySlots;     // Array slot per symbol id, -1 if not declared
+    int *declarations;   // Per array slot: times declared
+    size_t symbolCount;
+    int variableCount;
+    int nextTemp;
+    int line;            // Statement being lowered
+    VMError *error;
+    int failed;
+} Lowering;
+
+static void fail(Lowering *L, const char *format, ...) {
+    if (L->failed) return;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(L->error->message, sizeof(L->error->message), format, args);
+    va_end(args);
+    L->error->line = L->line;
+    L->failed = 1;
+}
+
+static int emit(Lowering *L, int op, int a, int b, int c) {
+    VMProgram *program = L->program;
+    if (program->codeSize == program->codeCapacity) {
+        int grown = program->codeCapacity ? program->codeCapacity * 2 : 64;
+        VMInstruction *bigger = (VMInstruction *)realloc(program->code, (size_t)grown * sizeof(VMInstruction));
+        if (bigger) program->code = bigger;
+        int *lines = (int *)realloc(program->lines, (size_t)grown * sizeof(int));
+        if (lines) program->lines = lines;
+        if (!bigger || !lines) {
+            fail(L, "Out of memory for %d bytecode instructions", grown);
+            return 0;
+        }
+        program->codeCapacity = grown;
+    }
+    program->lines[program->codeSize] = L->line;
+    VMInstruction *ins = &program->code[program->codeSize];
+    ins->op = op;
+    ins->a = a;
+    ins->b = b;
+    ins->c = c;
+    return program->codeSize++;
+}
+
+static int here(const Lowering *L) {
+    return L->program->codeSize;
+}
+
+static int newTemp(Lowering *L) {
+    int reg = L->nextTemp++;
+    if (L->nextTemp > L->program->registerCount) L->program->registerCount = L->nextTemp;
+    return reg;
+}
+
+// Pending jumps are chained through their `c` (target) fields until patched
+static int joinJumps(Lowering *L, int first, int second) {
+    if (first < 0) return second;
+    int last = first;
+    while (L->program->code[last].c >= 0) last = L->program->code[last].c;
+    L->program->code[last].c = second;
+    return first;
+}
+
+static void patchJumps(Lowering *L, int chain, int target) {
+    while (chain >= 0 && !L->failed) {
+        int next = L->program->code[chain].c;
+        L->program->code[chain].c = target;
+        chain = next;
+    }
+}
+
+static int isComparison(BinaryOp op) {
+    return op >= OP_LT && op <= OP_NE;
+}
+
+// Value of an expression made only of literals; 0 if it has any other part
+static int constantValue(const ASTNode *node, int *out) {
+    if (!node) return 0;
+    if (node->type == NUMBER_NODE) {
+        *out = node->number;
+        return 1;
+    }
+    int x, y;
+    if (node->type != BINARY_NODE || !constantValue(node->left, &x) || !constantValue(node->rhs, &y)) return 0;
+    unsigned ux = (unsigned)x, uy = (unsigned)y;
+    switch (node->op) {
+        case OP_ADD: *out = (int)(ux + uy); return 1;
+        case OP_SUB: *out = (int)(ux - uy); return 1;
+        case OP_MUL: *out = (int)(ux * uy); return 1;
+        case OP_DIV:
+            if (y == 0) return 0;  // Left for the runtime error
+            *out = y == -1 ? (int)(0u - ux) : x / y;
+            return 1;
+        case OP_MOD:
+            if (y == 0) return 0;
+            *out = y == -1 ? 0 : x % y;
+            return 1;
+        case OP_LT: *out = x < y; return 1;
+        case OP_GT: *out = x > y; return 1;
+        case OP_LE: *out = x <= y; return 1;
+        case OP_GE: *out = x >= y; return 1;
+        case OP_EQ: *out = x == y; return 1;
+        case OP_NE: *out = x != y; return 1;
+        case OP_AND: *out = x && y; return 1;
+        case OP_OR: *out = x || y; return 1;
+    }
+    return 0;
+}
+
+static int arraySlot(Lowering *L, const Symbol *name) {
+    int slot = name && (size_t)name->id < L->symbolCount ? L->arraySlots[name->id] : -1;
+    if (slot < 0) {
+        fail(L, "Array '%s' is not declared", name ? name->name : "");
+        return 0;
+    }
+    if (L->declarations[slot] > 1) {
+        fail(L, "Array '%s' is declared more than once; statements need a single declaration", name->name);
+    }
+    return slot;
+}
+
+static int variableRegister(Lowering *L, const Symbol *name) {
+    int reg = name && (size_t)name->id < L->symbolCount ? L->variables[name->id] : -1;
+    if (reg >= 0) return reg;
+    if (name && (size_t)name->id < L->symbolCount && L->arraySlots[name->id] >= 0) {
+        fail(L, "'%s' is an array; use %s[i] or len(%s)", name->name, name->name, name->name);
+    } else {
+        fail(L, "Unknown variable '%s'", name ? name->name : "");
+    }
+    return 0;
+}
+
+static void lowerInto(Lowering *L, const ASTNode *expr, int dst);
+static int lowerJump(Lowering *L, const ASTNode *cond, int sense);
+
+// Register holding the value of `expr`: the variable itself, or a temporary
+static int lowerExpr(Lowering *L, const ASTNode *expr) {
+    if (expr && expr->type == VALUE_NODE) return variableRegister(L, expr->symbol);
+    int reg = newTemp(L);
+    lowerInto(L, expr, reg);
+    return reg;
+}
+
+// Comparison operand; sets *element to the index register when it is an
+// element of the traced array
+static int lowerOperand(Lowering *L, const ASTNode *expr, int *element) {
+    if (expr && expr->type == INDEX_NODE) {
+        int slot = arraySlot(L, expr->symbol);
+        int index = lowerExpr(L, expr->left);
+        int reg = newTemp(L);
+        emit(L, VM_LOAD, reg, slot, index);
+        if (slot == L->program->traced) *element = index;
+        return reg;
+    }
+    return lowerExpr(L, expr);
+}
+
+// Evaluates both sides of a comparison, recording it when it reads the
+// traced array
+static void lowerComparison(Lowering *L, const ASTNode *expr, int *lhs, int *rhs) {
+    int left = -1, right = -1;
+    *lhs = lowerOperand(L, expr->left, &left);
+    *rhs = lowerOperand(L, expr->rhs, &right);
+    if (left >= 0) {
+        emit(L, VM_TRACE_COMPARE, left, right, 0);
+    } else if (right >= 0) {
+        emit(L, VM_TRACE_COMPARE, right, -1, 0);
+    }
+}
+
+static const int arithmeticOps[] = {
+    [OP_ADD] = VM_ADD, [OP_SUB] = VM_SUB, [OP_MUL] = VM_MUL, [OP_DIV] = VM_DIV, [OP_MOD] = VM_MOD,
+    [OP_LT] = VM_LT, [OP_GT] = VM_GT, [OP_LE] = VM_LE, [OP_GE] = VM_GE, [OP_EQ] = VM_EQ, [OP_NE] = VM_NE,
+};
+
+// Jump taken when the comparison holds, and when it does not
+static const int jumpIfOps[] = {
+    [OP_LT] = VM_JLT, [OP_GT] = VM_JGT, [OP_LE] = VM_JLE, [OP_GE] = VM_JGE, [OP_EQ] = VM_JEQ, [OP_NE] = VM_JNE,
+};
+static const int jumpUnlessOps[] = {
+    [OP_LT] = VM_JGE, [OP_GT] = VM_JLE, [OP_LE] = VM_JGT, [OP_GE] = VM_JLT, [OP_EQ] = VM_JNE, [OP_NE] = VM_JEQ,
+};
+
+// len(arr), the only call allowed in an expression
+static void lowerCallInto(Lowering *L, const ASTNode *expr, int dst) {
+    const ASTNode *arg = expr->left;
+    if (!expr->symbol || expr->method || expr->symbol->id != SYM_LEN) {
+        fail(L, "'%s' cannot be used in an expression", expr->name ? expr->name : "");
+        return;
+    }
+    if (!arg || arg->type != VALUE_NODE || arg->right) {
+        fail(L, "len expects one array: len(arr)");
+        return;
+    }
+    int slot = arraySlot(L, arg->symbol);
+    if (!L->failed) emit(L, VM_LOADK, dst, L->program->arrays[slot].size, 0);
+}
+
+static void lowerInto(Lowering *L, const ASTNode *expr, int dst) {
+    int value;
+    if (!expr || L->failed) return;
+    if (constantValue(expr, &value)) {
+        emit(L, VM_LOADK, dst, value, 0);
+        return;
+    }
+    switch (expr->type) {
+        case VALUE_NODE: {
+            int reg = variableRegister(L, expr->symbol);
+            if (reg != dst) emit(L, VM_MOV, dst, reg, 0);
+            return;
+        }
+        case INDEX_NODE: {
+            int slot = arraySlot(L, expr->symbol);
+            emit(L, VM_LOAD, dst, slot, lowerExpr(L, expr->left));
+            return;
+        }
+        case ALGORITHM_CALL_NODE:
+            lowerCallInto(L, expr, dst);
+            return;
+        case BINARY_NODE:
+            break;
+        case STRING_NODE:
+            fail(L, "Strings can only be passed to load(), not used in expressions");
+            return;
+        default:
+            fail(L, "Unsupported expression");
+            return;
+    }
+
+    if (expr->op == OP_AND || expr->op == OP_OR) {
+        int otherwise = lowerJump(L, expr, 0);
+        emit(L, VM_LOADK, dst, 1, 0);
+        int done = emit(L, VM_JMP, 0, 0, -1);
+        patchJumps(L, otherwise, here(L));
+        emit(L, VM_LOADK, dst, 0, 0);
+        patchJumps(L, done, here(L));
+        return;
+    }
+    int lhs, rhs;
+    if (isComparison(expr->op)) {
+        lowerComparison(L, expr, &lhs, &rhs);
+    } else if ((expr->op == OP_ADD || expr->op == OP_SUB) && constantValue(expr->rhs, &value)) {
+        lhs = lowerExpr(L, expr->left);
+        if (expr->op == OP_SUB) value = (int)(0u - (unsigned)value);
+        emit(L, VM_ADDK, dst, lhs, value);
+        return;
+    } else {
+        lhs = lowerExpr(L, expr->left);
+        rhs = lowerExpr(L, expr->rhs);
+    }
+    emit(L, arithmeticOps[expr->op], dst, lhs, rhs);
+}
+
+// Emits the jumps taken when `cond` is true (sense 1) or false (sense 0),
+// returning their chain for the caller to patch
+static int lowerJump(Lowering *L, const ASTNode *cond, int sense) {
+    int value;
+    if (constantValue(cond, &value)) {
+        return (value != 0) == sense ? emit(L, VM_JMP, 0, 0, -1) : -1;
+    }
+    if (cond->type == BINARY_NODE && (cond->op == OP_AND || cond->op == OP_OR)) {
+        // Both sides jump to the same place, or the first skips the second
+        if ((cond->op == OP_OR) == sense) {
+            int first = lowerJump(L, cond->left, sense);
+            return joinJumps(L, first, lowerJump(L, cond->rhs, sense));
+        }
+        int skip = lowerJump(L, cond->left, !sense);
+        int jumps = lowerJump(L, cond->rhs, sense);
+        patchJumps(L, skip, here(L));
+        return jumps;
+    }
+    if (cond->type == BINARY_NODE && isComparison(cond->op)) {
+        int lhs, rhs;
+        lowerComparison(L, cond, &lhs, &rhs);
+        return emit(L, sense ? jumpIfOps[cond->op] : jumpUnlessOps[cond->op], lhs, rhs, -1);
+    }
+    int reg = lowerExpr(L, cond);
+    return emit(L, sense ? VM_JNZ : VM_JZ, reg, 0, -1);
+}
+
+static void lowerStatements(Lowering *L, const ASTNode *node);
+
+static void lowerSwap(Lowering *L, const ASTNode *call) {
+    const ASTNode *a = call->left;
+    const ASTNode *b = a ? a->right : NULL;
+    if (!a || !b || b->right || a->type != INDEX_NODE || b->type != INDEX_NODE || a->symbol != b->symbol) {
+        fail(L, "swap expects two elements of the same array: swap(arr[i], arr[j])");
+        return;
+    }
+    int slot = arraySlot(L, a->symbol);
+    int i = lowerExpr(L, a->left);
+    int j = lowerExpr(L, b->left);
+    emit(L, slot == L->program->traced ? VM_SWAP_TRACED : VM_SWAP, slot, i, j);
+}
+
+static void lowerStatement(Lowering *L, const ASTNode *node) {
+    L->nextTemp = L->variableCount;  // No temporary outlives its statement
+    int line = node->line ? node->line : L->line;  // A for loop's init and increment have none
+    L->line = line;
+    switch (node->type) {
+        case ASSIGN_NODE:
+            if (node->index) {
+                int slot = arraySlot(L, node->symbol);
+                int index = lowerExpr(L, node->index);
+                int value = lowerExpr(L, node->left);
+                emit(L, slot == L->program->traced ? VM_STORE_TRACED : VM_STORE, slot, index, value);
+            } else if (!node->left) {
+                int reg = variableRegister(L, node->symbol);
+                emit(L, VM_ADDK, reg, reg, 1);
+            } else {
+                lowerInto(L, node->left, variableRegister(L, node->symbol));
+            }
+            break;
+        case LOOP_NODE: {
+            if (node->left) lowerStatement(L, node->left);
+            int top = here(L);
+            L->nextTemp = L->variableCount;
+            int exit = lowerJump(L, node->cond, 0);
+            lowerStatements(L, node->body);
+            if (node->inc) lowerStatement(L, node->inc);
+            L->line = line;
+            emit(L, VM_LOOP, here(L) - top + 1, 0, top);
+            patchJumps(L, exit, here(L));
+            break;
+        }
+        case IF_NODE: {
+            int otherwise = lowerJump(L, node->cond, 0);
+            lowerStatements(L, node->body);
+            if (node->left) {
+                L->line = line;
+                int done = emit(L, VM_JMP, 0, 0, -1);
+                patchJumps(L, otherwise, here(L));
+                lowerStatements(L, node->left);
+                patchJumps(L, done, here(L));
+            } else {
+                patchJumps(L, otherwise, here(L));
+            }
+            break;
+        }
+        case ALGORITHM_CALL_NODE:
+            // Algorithms and data structures get tracks of their own
+            if (node->symbol && !node->method && node->symbol->id == SYM_SWAP) lowerSwap(L, node);
+            break;
+        default:
+            break;  // Declarations are hoisted
+    }
+}
+
+static void lowerStatements(Lowering *L, const ASTNode *node) {
+    for (const ASTNode *curr = node; curr && !L->failed; curr = curr->right) {
+        lowerStatement(L, curr);
+    }
+}
+
+// Arrays are hoisted: every declaration is visible to every statement
+static void declareArrays(Lowering *L, const ASTNode *node) {
+    for (const ASTNode *curr = node; curr && !L->failed; curr = curr->right) {
+        if (curr->line) L->line = curr->line;
+        if (curr->type == ARRAY_DECL_NODE && curr->symbol) {
+            int *slot = &L->arraySlots[curr->symbol->id];
+            if (*slot < 0) {
+                VMProgram *program = L->program;
+                VMArray *bigger = (VMArray *)realloc(program->arrays, (size_t)(program->arrayCount + 1) * sizeof(VMArray));
+                int *counts = (int *)realloc(L->declarations, (size_t)(program->arrayCount + 1) * sizeof(int));
+                if (bigger) program->arrays = bigger;
+                if (counts) L->declarations = counts;
+                if (!bigger || !counts) {
+                    fail(L, "Out of memory for %d arrays", program->arrayCount + 1);
+                    return;
+                }
+                *slot = program->arrayCount++;
+                L->declarations[*slot] = 0;
+            }
+            VMArray *array = &L->program->arrays[*slot];
+            array->name = curr->symbol;
+            array->values = curr->array_values;
+            array->size = curr->array_count;
+            L->declarations[*slot]++;
+        } else if (curr->type == LOOP_NODE || curr->type == IF_NODE) {
+            declareArrays(L, curr->body);
+            declareArrays(L, curr->left);
+        }
+    }
+}
+
+// Every assigned name is a variable with a register of its own
+static void declareVariables(Lowering *L, const ASTNode *node) {
+    for (const ASTNode *curr = node; curr && !L->failed; curr = curr->right) {
+        if (curr->line) L->line = curr->line;
+        if (curr->type == ASSIGN_NODE && !curr->index && curr->symbol) {
+            int id = curr->symbol->id;
+            if (L->arraySlots[id] >= 0) {
+                fail(L, "'%s' is an array; assign its elements with %s[i] = value", curr->name, curr->name);
+                return;
+            }
+            if (L->variables[id] < 0) L->variables[id] = L->variableCount++;
+        } else if (curr->type == LOOP_NODE || curr->type == IF_NODE) {
+            declareVariables(L, curr->left);
+            declareVariables(L, curr->body);
+            declareVariables(L, curr->inc);
+        }
+    }
+}
+
+// First array in program order whose elements are compared, swapped or
+// stored. *effects is set when any statement does one of those.
+static const Symbol *findTracedInExpr(const ASTNode *expr, int *effects) {
+    if (!expr) return NULL;
+    const Symbol *found = NULL;
+    if (expr->type == BINARY_NODE && isComparison(expr->op)) {
+        if (expr->left && expr->left->type == INDEX_NODE) found = expr->left->symbol;
+        else if (expr->rhs && expr->rhs->type == INDEX_NODE) found = expr->rhs->symbol;
+        if (found) *effects = 1;
+    }
+    if (!found && (expr->type == BINARY_NODE || expr->type == INDEX_NODE)) {
+        found = findTracedInExpr(expr->left, effects);
+        if (!found) found = findTracedInExpr(expr->rhs, effects);
+    }
+    return found;
+}
+
+static const Symbol *findTraced(const ASTNode *node, int *effects) {
+    for (const ASTNode *curr = node; curr; curr = curr->right) {
+        const Symbol *found = NULL;
+        switch (curr->type) {
+            case ASSIGN_NODE:
+                if (curr->index) {
+                    *effects = 1;
+                    found = curr->symbol;
+                } else {
+                    found = findTracedInExpr(curr->left, effects);
+                }
+                break;
+            case LOOP_NODE:
+                found = findTraced(curr->left, effects);
+                if (!found) found = findTracedInExpr(curr->cond, effects);
+                if (!found) found = findTraced(curr->body, effects);
+                if (!found) found = findTraced(curr->inc, effects);
+                break;
+            case IF_NODE:
+                found = findTracedInExpr(curr->cond, effects);
+                if (!found) found = findTraced(curr->body, effects);
+                if (!found) found = findTraced(curr->left, effects);
+                break;
+            case ALGORITHM_CALL_NODE:
+                if (curr->symbol && !curr->method && curr->symbol->id == SYM_SWAP) {
+                    *effects = 1;
+                    if (curr->left && curr->left->type == INDEX_NODE) found = curr->left->symbol;
+                }
+                break;
+            default:
+                break;
+        }
+        if (found) return found;
+    }
+    return NULL;
+}
+
+int vmCompile(const ASTNode *root, const SymbolTable *symbols, VMProgram **out, VMError *error) {
+    *out = NULL;
+    error->line = 0;
+    error->message[0] = '\0';
+    int effects = 0;
+    const Symbol *traced = findTraced(root, &effects);
+    if (!effects) return 0;
+
+    Lowering L;
+    memset(&L, 0, sizeof(L));
+    L.symbolCount = symbols->count;
+    L.error = error;
+    L.program = (VMProgram *)calloc(1, sizeof(VMProgram));
+    L.variables = (int *)malloc(L.symbolCount * sizeof(int));
+    L.arraySlots = (int *)malloc(L.symbolCount * sizeof(int));
+    if (!L.program || !L.variables || !L.arraySlots) {
+        fail(&L, "Out of memory compiling statements");
+    } else {
+        memset(L.variables, -1, L.symbolCount * sizeof(int));
+        memset(L.arraySlots, -1, L.symbolCount * sizeof(int));
+        L.program->traced = -1;
+        declareArrays(&L, root);
+        declareVariables(&L, root);
+    }
+    if (!L.failed) {
+        L.program->registerCount = L.variableCount;
+        // An undeclared traced array is reported where a statement uses it
+        if (traced) L.program->traced = L.arraySlots[traced->id];
+        lowerStatements(&L, root);
+        L.line = 0;
+        emit(&L, VM_HALT, 0, 0, 0);
+    }
+    free(L.variables);
+    free(L.arraySlots);
+    free(L.declarations);
+    if (L.failed) {
+        vmFree(L.program);
+        return -1;
+    }
+    *out = L.program;
+    return 0;
+}
+
+void vmFree(VMProgram *program) {
+    if (!program) return;
+    free(program->code);
+    free(program->lines);
+    free(program->arrays);
+    free(program);
+}
+
+static int recordStep(IRContext *ir, const char *action, int first, int second, int count) {
+    int indices[2] = { first, second };
+    return addIRWithIndices(ir, action, "", indices, count);
+}
+
+int vmRun(const VMProgram *program, const VMLimits *limits, double deadlineMs, IRContext *ir,
+          VMError *error) {
+    size_t total = 0;
+    for (int i = 0; i < program->arrayCount; i++) {
+        total += (size_t)program->arrays[i].size;
+    }
+    int *r = (int *)calloc((size_t)(program->registerCount > 0 ? program->registerCount : 1), sizeof(int));
+    int **data = (int **)malloc((size_t)(program->arrayCount > 0 ? program->arrayCount : 1) * sizeof(int *));
+    int *sizes = (int *)malloc((size_t)(program->arrayCount > 0 ? program->arrayCount : 1) * sizeof(int));
+    int *memory = (int *)malloc((total > 0 ? total : 1) * sizeof(int));
+    int status = -1;
+    error->line = 0;
+    error->message[0] = '\0';
+    if (!r || !data || !sizes || !memory) {
+        snprintf(error->message, sizeof(error->message), "Out of memory for %zu array elements", total);
+        goto cleanup;
+    }
+    int *next = memory;
+    for (int i = 0; i < program->arrayCount; i++) {
+        const VMArray *array = &program->arrays[i];
+        data[i] = next;
+        sizes[i] = array->size;
+        if (array->size > 0) memcpy(next, array->values, (size_t)array->size * sizeof(int));
+        next += array->size;
+    }
+    if (program->traced >= 0) {
+        const VMArray *traced = &program->arrays[program->traced];
+        if (setArray(ir, traced->values, traced->size) != 0) {
+            snprintf(error->message, sizeof(error->message), "Out of memory for a %d-element array", traced->size);
+            goto cleanup;
+        }
+    }
+
+    const VMInstruction *code = program->code;
+    const VMInstruction *pc = code;
+    int maxSteps = limits->steps > 0 ? limits->steps : INT_MAX;
+    // Loops draw on `fuel`; when it runs out, refuel charges what was used
+    // and checks the instruction limit and the clock
+    long long executed = 0, grant = 0, fuel = 0;
+    int badSlot = 0, badIndex = 0;
+    int recorded = 0;  // What recordStep returned for a step it could not keep
+
+#ifdef VM_COMPUTED_GOTO
+    static void *const dispatch[VM_OPCODE_COUNT] = {
+        [VM_HALT] = &&op_HALT, [VM_LOADK] = &&op_LOADK, [VM_MOV] = &&op_MOV,
+        [VM_ADD] = &&op_ADD, [VM_SUB] = &&op_SUB, [VM_MUL] = &&op_MUL, [VM_DIV] = &&op_DIV,
+        [VM_MOD] = &&op_MOD, [VM_ADDK] = &&op_ADDK,
+        [VM_LT] = &&op_LT, [VM_LE] = &&op_LE, [VM_GT] = &&op_GT, [VM_GE] = &&op_GE,
+        [VM_EQ] = &&op_EQ, [VM_NE] = &&op_NE,
+        [VM_JMP] = &&op_JMP, [VM_LOOP] = &&op_LOOP, [VM_JZ] = &&op_JZ, [VM_JNZ] = &&op_JNZ,
+        [VM_JLT] = &&op_JLT, [VM_JLE] = &&op_JLE, [VM_JGT] = &&op_JGT, [VM_JGE] = &&op_JGE,
+        [VM_JEQ] = &&op_JEQ, [VM_JNE] = &&op_JNE,
+        [VM_LOAD] = &&op_LOAD, [VM_STORE] = &&op_STORE, [VM_STORE_TRACED] = &&op_STORE_TRACED,
+        [VM_SWAP] = &&op_SWAP, [VM_SWAP_TRACED] = &&op_SWAP_TRACED,
+        [VM_TRACE_COMPARE] = &&op_TRACE_COMPARE,
+    };
+#define OP(name) op_##name
+#define NEXT() do { pc++; goto *dispatch[pc->op]; } while (0)
+#define JUMP(target) do { pc = code + (target); goto *dispatch[pc->op]; } while (0)
+    goto *dispatch[pc->op];
+#else
+#define OP(name) case VM_##name
+#define NEXT() do { pc++; goto dispatch; } while (0)
+#define JUMP(target) do { pc = code + (target); goto dispatch; } while (0)
+dispatch:
+    switch (pc->op) {
+#endif
+
+#define ARITHMETIC(name, expr) OP(name): { unsigned x = (unsigned)r[pc->b], y = (unsigned)r[pc->c]; \
+                                           r[pc->a] = (int)(expr); NEXT(); }
+#define COMPARE(name, cmp) OP(name): r[pc->a] = r[pc->b] cmp r[pc->c]; NEXT();
+#define BRANCH(name, cmp) OP(name): if (r[pc->a] cmp r[pc->b]) JUMP(pc->c); NEXT();
+#define RECORD(action, first, second, count) do { if (ir->stepCount >= maxSteps) goto tooManySteps; \
+                                                recorded = recordStep(ir, action, first, second, count); \
+                                                if (recorded != 0) goto notRecorded; } while (0)
+#define CHECK(slot, index) if ((unsigned)(index) >= (unsigned)sizes[slot]) { \
+                               badSlot = (slot); badIndex = (index); goto outOfBounds; }
+
+    OP(HALT):
+        status = 0;
+        goto cleanup;
+    OP(LOADK):
+        r[pc->a] = pc->b;
+        NEXT();
+    OP(MOV):
+        r[pc->a] = r[pc->b];
+        NEXT();
+    ARITHMETIC(ADD, x + y)
+    ARITHMETIC(SUB, x - y)
+    ARITHMETIC(MUL, x * y)
+    OP(DIV): {
+        int x = r[pc->b], y = r[pc->c];
+        if (y == 0) goto divideByZero;
+        r[pc->a] = y == -1 ? (int)(0u - (unsigned)x) : x / y;  // INT_MIN / -1 wraps
+        NEXT();
+    }
+    OP(MOD): {
+        int x = r[pc->b], y = r[pc->c];
+        if (y == 0) goto divideByZero;
+        r[pc->a] = y == -1 ? 0 : x % y;
+        NEXT();
+    }
+    OP(ADDK):
+        r[pc->a] = (int)((unsigned)r[pc->b] + (unsigned)pc->c);
+        NEXT();
+    COMPARE(LT, <)
+    COMPARE(LE, <=)
+    COMPARE(GT, >)
+    COMPARE(GE, >=)
+    COMPARE(EQ, ==)
+    COMPARE(NE, !=)
+    OP(JMP):
+        JUMP(pc->c);
+    OP(LOOP):
+        if ((fuel -= pc->a) < 0) goto refuel;
+        JUMP(pc->c);
+    OP(JZ):
+        if (r[pc->a] == 0) JUMP(pc->c);
+        NEXT();
+    OP(JNZ):
+        if (r[pc->a] != 0) JUMP(pc->c);
+        NEXT();
+    BRANCH(JLT, <)
+    BRANCH(JLE, <=)
+    BRANCH(JGT, >)
+    BRANCH(JGE, >=)
+    BRANCH(JEQ, ==)
+    BRANCH(JNE, !=)
+    OP(LOAD): {
+        int index = r[pc->c];
+        CHECK(pc->b, index);
+        r[pc->a] = data[pc->b][index];
+        NEXT();
+    }
+    OP(STORE): {
+        int index = r[pc->b];
+        CHECK(pc->a, index);
+        data[pc->a][index] = r[pc->c];
+        NEXT();
+    }
+    OP(STORE_TRACED): {
+        int index = r[pc->b];
+        CHECK(pc->a, index);
+        data[pc->a][index] = r[pc->c];
+        RECORD("set", index, r[pc->c], 2);
+        NEXT();
+    }
+    OP(SWAP):
+    OP(SWAP_TRACED): {
+        int *array = data[pc->a];
+        int i = r[pc->b], j = r[pc->c];
+        CHECK(pc->a, i);
+        CHECK(pc->a, j);
+        int temp = array[i];
+        array[i] = array[j];
+        array[j] = temp;
+        if (pc->op == VM_SWAP_TRACED) RECORD("swap", i, j, 2);
+        NEXT();
+    }
+    OP(TRACE_COMPARE):
+        if (pc->b >= 0) {
+            RECORD("compare", r[pc->a], r[pc->b], 2);
+        } else {
+            RECORD("compare", r[pc->a], 0, 1);
+        }
+        NEXT();
+
+#ifndef VM_COMPUTED_GOTO
+    default:
+        snprintf(error->message, sizeof(error->message), "Invalid bytecode %d", pc->op);
+        goto cleanup;
+    }
+#endif
+
+refuel:
+    executed += grant - fuel;
+    if (limits->instructions > 0 && executed > limits->instructions) goto tooLong;
+    if (deadlineMs > 0 && monotonicMs() >= deadlineMs) goto timedOut;
+    grant = VM_FUEL_CHUNK;
+    if (limits->instructions > 0 && limits->instructions - executed < grant) grant = limits->instructions - executed;
+    fuel = grant;
+    JUMP(pc->c);
+
+#undef OP
+#undef NEXT
+#undef JUMP
+#undef ARITHMETIC
+#undef COMPARE
+#undef BRANCH
+#undef RECORD
+#undef CHECK
+
+outOfBounds:
+    snprintf(error->message, sizeof(error->message), "Index %d is out of bounds for '%s' (size %d)",
+             badIndex, program->arrays[badSlot].name->name, sizes[badSlot]);
+    goto failed;
+divideByZero:
+    snprintf(error->message, sizeof(error->message), "Division by zero");
+    goto failed;
+tooLong:
+    snprintf(error->message, sizeof(error->message), "Statements did not finish within %lld instructions",
+             limits->instructions);
+    goto failed;
+timedOut:
+    snprintf(error->message, sizeof(error->message), "Statements did not finish within %.0f ms",
+             limits->timeoutMs);
+    goto failed;
+tooManySteps:
+    snprintf(error->message, sizeof(error->message), "Statements produced more than %d steps", maxSteps);
+    goto failed;
+notRecorded:
+    if (recorded == IR_TOO_MANY_ACTIONS) {
+        snprintf(error->message, sizeof(error->message), "Statements used more than %d distinct actions",
+                 IR_MAX_ACTIONS);
+    } else {
+        snprintf(error->message, sizeof(error->message), "Out of memory recording step %d",
+                 ir->stepCount + 1);
+    }
+failed:
+    error->line = program->lines[pc - code];
+cleanup:
+    free(r);
+    free(data);
+    free(sizes);
+    free(memory);
+    return status;
+}
@@ -0,0 +1,118 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stddef.h>
+#include "ast.h"
+#include "ir.h"
+#include "symbols.h"
+
+// Register bytecode for the statements a program writes itself (loops,
+// ifs, assignments, swap). vmCompile lowers them once; vmRun executes the
+// bytecode against private copies of the declared arrays and records a
+// step for every comparison, swap and store that touches the traced array,
+// so the trace shows what the code actually did.
+//
+//     i = 0;                      LOADK  r0, 0
+//     while (i < n) {             JGE    r0, r1, done
+//         i++;                    ADDK   r0, r0, 1
+//     }                           LOOP   top
+
+typedef enum {
+    VM_HALT,
+    VM_LOADK,       // r[a] = b
+    VM_MOV,         // r[a] = r[b]
+    VM_ADD,         // r[a] = r[b] op r[c]; arithmetic wraps like unsigned
+    VM_SUB,
+    VM_MUL,
+    VM_DIV,         // Division by zero is a runtime error
+    VM_MOD,
+    VM_ADDK,        // r[a] = r[b] + c
+    VM_LT,          // r[a] = r[b] cmp r[c] (0 or 1)
+    VM_LE,
+    VM_GT,
+    VM_GE,
+    VM_EQ,
+    VM_NE,
+    VM_JMP,         // Forward jump to c
+    VM_LOOP,        // Backward jump to c; charges the a instructions of one iteration
+    VM_JZ,          // Jump to c if r[a] == 0
+    VM_JNZ,
+    VM_JLT,         // Jump to c if r[a] cmp r[b]
+    VM_JLE,
+    VM_JGT,
+    VM_JGE,
+    VM_JEQ,
+    VM_JNE,
+    VM_LOAD,        // r[a] = arrays[b][r[c]], bounds checked
+    VM_STORE,       // arrays[a][r[b]] = r[c]
+    VM_STORE_TRACED,  // STORE that records "set"
+    VM_SWAP,        // Exchange arrays[a][r[b]] and arrays[a][r[c]]
+    VM_SWAP_TRACED,   // SWAP that records "swap"
+    VM_TRACE_COMPARE, // Records "compare" of traced elements r[a] and r[b] (b < 0: one element)
+    VM_OPCODE_COUNT
+} VMOpcode;
+
+typedef struct VMInstruction {
+    int op;
+    int a, b, c;
+} VMInstruction;
+
+typedef struct VMArray {
+    const Symbol *name;
+    const int *values;   // Declared contents (arena-owned, never written)
+    int size;
+} VMArray;
+
+typedef struct VMProgram {
+    VMInstruction *code;
+    int *lines;          // Source line of each instruction's statement
+    int codeSize;
+    int codeCapacity;
+    int registerCount;   // Variables first, then temporaries; all start at 0
+    VMArray *arrays;
+    int arrayCount;
+    int traced;          // Array whose operations become steps
+} VMProgram;
+
+// Bounds on one run, so a runaway program cannot hold a worker or fill the
+// disk. Zero leaves a bound off. Instructions are charged a whole loop
+// iteration at a time, when the loop jumps back; that one counter is all
+// the hot path pays, and the clock is read only every VM_FUEL_CHUNK
+// instructions.
+typedef struct VMLimits {
+    long long instructions;  // Bytecode instructions executed
+    int steps;               // Steps recorded in the trace
+    double timeoutMs;        // Wall-clock time for the whole program
+} VMLimits;
+
+#define VM_DEFAULT_MAX_INSTRUCTIONS 2000000000LL
+#define VM_DEFAULT_MAX_STEPS 10000000
+#define VM_DEFAULT_TIMEOUT_MS 10000.0
+#define VM_FUEL_CHUNK 65536
+
+// Why a program could not be compiled or run, and the line of the
+// statement at fault (0 if none)
+typedef struct VMError {
+    int line;
+    char message[224];
+} VMError;
+
+// Lowers the executable statements of `root`. Array contents come from the
+// ARRAY_DECL_NODEs, which must already hold their values (collectDSLInfo
+// evaluates initialisers). Sets *out to NULL when the statements never
+// compare, swap or store array elements, since there is nothing to show.
+// Returns 0, or -1 with `error` filled in.
+int vmCompile(const ASTNode *root, const SymbolTable *symbols, VMProgram **out, VMError *error);
+
+// Runs the program, writing the traced array and its steps to `ir`.
+// Time is bounded by `deadlineMs`, a monotonicMs() reading to stop at
+// (0 = none), rather than limits->timeoutMs, so that tracks running side
+// by side share one deadline.
+// Returns 0, or -1 with `error` filled in (bad index, division by zero, a
+// limit).
+int vmRun(const VMProgram *program, const VMLimits *limits, double deadlineMs, IRContext *ir,
+          VMError *error);
+
+void vmFree(VMProgram *program);
+
+#endif
@@ -0,0 +1,350 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "watch.h"
+#include "batch.h"
+#include "compiler.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define POLL_INTERVAL_MS 100
+
+// A dataset the program loads, watched like the program itself
+typedef struct {
+    char *path;
+    char *dir;
+    const char *name;
+    int wd;
+} WatchedData;
+
+typedef struct {
+    char *input;
+    char *output;
+    char *dir;                // Directory containing input, watched for saves
+    const char *name;         // File name within dir
+    int wd;                   // inotify watch on dir
+    int dirty;
+    int seen;                 // hash holds the last compiled contents
+    unsigned long long hash;  // Of the program, and of its datasets' stats
+    WatchedData *data;        // What the last analysed compile loaded
+    int dataCount;
+} WatchedFile;
+
+// FNV-1a over the whole file; -1 if it cannot be read right now (e.g. an
+// editor is between deleting and renaming it)
+static int hashFile(const char *path, unsigned long long *hash) {
+    // Read rather than map: an editor truncating the file mid-hash would
+    // turn a mapped read past the new end into SIGBUS
+    FILE *in = fopen(path, "rb");
+    if (!in) return -1;
+    unsigned long long h = 14695981039346656037ull;
+    unsigned char buf[65536];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), in)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            h ^= buf[i];
+            h *= 1099511628211ull;
+        }
+    }
+    int failed = ferror(in);
+    fclose(in);
+    if (failed) return -1;
+    *hash = h;
+    return 0;
+}
+
+// Datasets can be large, so they are folded in by size and modification
+// time rather than read; a missing one hashes as such, so creating it
+// counts as a change
+static unsigned long long hashData(unsigned long long h, const WatchedFile *file) {
+    for (int i = 0; i < file->dataCount; i++) {
+        struct stat st;
+        long long parts[3] = { -1, -1, -1 };
+        if (stat(file->data[i].path, &st) == 0) {
+            parts[0] = (long long)st.st_size;
+            parts[1] = (long long)st.st_mtime;
+#ifdef __linux__
+            parts[2] = (long long)st.st_mtim.tv_nsec;
+#endif
+        }
+        for (int k = 0; k < 3; k++) {
+            h ^= (unsigned long long)parts[k];
+            h *= 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+static char *directoryOf(const char *path, const char **name);
+
+static void freeData(WatchedFile *file) {
+    for (int i = 0; i < file->dataCount; i++) {
+        free(file->data[i].path);
+        free(file->data[i].dir);
+    }
+    free(file->data);
+    file->data = NULL;
+    file->dataCount = 0;
+}
+
+static int sameData(const WatchedFile *file, const LoadedFile *loaded) {
+    int count = 0;
+    for (; loaded; loaded = loaded->next, count++) {
+        if (count == file->dataCount || strcmp(file->data[count].path, loaded->path) != 0) return 0;
+    }
+    return count == file->dataCount;
+}
+
+// Takes over the datasets a compile loaded; 1 if they differ from the last
+// compile's. Watches on directories that
+// are no longer needed are left in place; they only cost spurious wakeups.
+static int updateData(WatchedFile *file, const LoadedFile *loaded) {
+    if (sameData(file, loaded)) return 0;
+    freeData(file);
+    int count = 0;
+    for (const LoadedFile *l = loaded; l; l = l->next) count++;
+    if (count == 0) return 1;
+    file->data = (WatchedData *)calloc((size_t)count, sizeof(WatchedData));
+    if (!file->data) return 1;
+    for (const LoadedFile *l = loaded; l; l = l->next) {
+        WatchedData *data = &file->data[file->dataCount];
+        data->path = (char *)malloc(strlen(l->path) + 1);
+        if (!data->path) break;
+        strcpy(data->path, l->path);
+        data->dir = directoryOf(data->path, &data->name);
+        data->wd = -1;
+        file->dataCount++;
+        if (!data->dir) break;
+    }
+    return 1;
+}
+
+// Recompiles `file` if it or a dataset it loads differs from the last
+// compile. The trace on disk is the cached result for unchanged programs.
+static void refresh(WatchedFile *file, const WatchOptions *options) {
+    unsigned long long source;
+    if (hashFile(file->input, &source) != 0) return;
+    unsigned long long hash = hashData(source, file);
+    if (file->seen && hash == file->hash) return;
+    file->seen = 1;
+
+    double start = monotonicMs();
+    CompilerContext ctx;
+    initCompilerContext(&ctx, file->input);
+    setCompilerQuiet(&ctx, 1);
+    setCompilerCache(&ctx, options->cache);
+    setCompilerLimits(&ctx, options->limits);
+    CompileStatus status = compileFile(&ctx, file->output);
+    double elapsed = monotonicMs() - start;
+    // A program that did not get as far as analysis keeps its datasets
+    int changed = status != COMPILE_IO_ERROR && status != COMPILE_SYNTAX_ERROR &&
+                  updateData(file, ctx.codegen.loaded_files);
+    file->hash = changed ? hashData(source, file) : hash;
+    if (status == COMPILE_OK) {
+        printf("[watch] %s -> %s: %d steps in %.1f ms%s\n", file->input, file->output, traceStepCount(&ctx.ir),
+               elapsed, ctx.cacheHit ? " (cached)" : "");
+    } else {
+        printf("[watch] %s: [%s] %s\n", file->input, compileStatusName(status), compileErrorMessage(&ctx));
+    }
+    fflush(stdout);
+    freeCompilerContext(&ctx);
+}
+
+static char *directoryOf(const char *path, const char **name) {
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash && (!slash || backslash > slash)) slash = backslash;
+    *name = slash ? slash + 1 : path;
+    size_t len = slash ? (size_t)(slash - path) : 1;
+    char *dir = (char *)malloc(len + 1);
+    if (!dir) return NULL;
+    if (!slash) {
+        strcpy(dir, ".");
+    } else if (len == 0) {
+        strcpy(dir, "/");
+    } else {
+        memcpy(dir, path, len);
+        dir[len] = '\0';
+    }
+    return dir;
+}
+
+#if defined(__linux__)
+
+// Watches the directories of datasets not watched yet. One that cannot be
+// watched (its directory does not exist) is tried again after the next
+// compile.
+static void watchData(int fd, WatchedFile *file) {
+    for (int i = 0; i < file->dataCount; i++) {
+        WatchedData *data = &file->data[i];
+        if (data->wd < 0 && data->dir) data->wd = inotify_add_watch(fd, data->dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+}
+
+static int matchesEvent(int wd, const char *name, const struct inotify_event *event) {
+    return wd == event->wd && event->len > 0 && strcmp(name, event->name) == 0;
+}
+
+// Directories rather than files are watched: editors that save by writing
+// a new file and renaming it over the old one would orphan a file watch
+static int watchLoop(WatchedFile *files, int count, const WatchOptions *options) {
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+        perror("Error: inotify_init1");
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        // Watching a directory twice returns the same descriptor
+        files[i].wd = inotify_add_watch(fd, files[i].dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (files[i].wd < 0) {
+            fprintf(stderr, "Error: Cannot watch %s\n", files[i].dir);
+            close(fd);
+            return 1;
+        }
+        watchData(fd, &files[i]);
+    }
+
+    union {
+        struct inotify_event event;
+        char bytes[16 * 1024];
+    } buffer;
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    for (;;) {
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("Error: poll");
+            break;
+        }
+        // Drain everything queued so a burst of saves costs one compile
+        do {
+            ssize_t len = read(fd, buffer.bytes, sizeof(buffer.bytes));
+            if (len <= 0) break;
+            for (char *p = buffer.bytes; p < buffer.bytes + len;) {
+                struct inotify_event *event = (struct inotify_event *)p;
+                for (int i = 0; i < count; i++) {
+                    if (matchesEvent(files[i].wd, files[i].name, event)) files[i].dirty = 1;
+                    for (int k = 0; k < files[i].dataCount; k++) {
+                        if (matchesEvent(files[i].data[k].wd, files[i].data[k].name, event)) files[i].dirty = 1;
+                    }
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        } while (poll(&pfd, 1, 0) > 0);
+        for (int i = 0; i < count; i++) {
+            if (files[i].dirty) {
+                files[i].dirty = 0;
+                refresh(&files[i], options);
+                watchData(fd, &files[i]);
+            }
+        }
+    }
+    close(fd);
+    return 1;
+}
+
+#else
+
+// No change notifications: compare contents every POLL_INTERVAL_MS
+static int watchLoop(WatchedFile *files, int count, const WatchOptions *options) {
+    for (;;) {
+#ifdef _WIN32
+        Sleep(POLL_INTERVAL_MS);
+#else
+        struct timespec delay = { 0, POLL_INTERVAL_MS * 1000000L };
+        nanosleep(&delay, NULL);
+#endif
+        for (int i = 0; i < count; i++) {
+            refresh(&files[i], options);
+        }
+    }
+    return 1;
+}
+
+#endif
+
+static char *copyString(const char *s) {
+    char *copy = (char *)malloc(strlen(s) + 1);
+    if (copy) strcpy(copy, s);
+    return copy;
+}
+
+int runWatch(const WatchOptions *options, const char **inputs, int inputCount) {
+    for (int i = 0; i < inputCount; i++) {
+        if (strcmp(inputs[i], "-") == 0) {
+            fprintf(stderr, "Error: Cannot watch stdin\n");
+            return 1;
+        }
+    }
+
+    BatchPlan plan = { NULL, NULL, 0 };
+    int count;
+    if (inputCount == 1 && !isBatchInput(inputs[0])) {
+        // A single program writes where a normal compile would
+        plan.inputs = (char **)malloc(sizeof(char *));
+        plan.outputs = (char **)malloc(sizeof(char *));
+        if (plan.inputs && plan.outputs) {
+            plan.inputs[0] = copyString(inputs[0]);
+            plan.outputs[0] = copyString(options->outputPath ? options->outputPath : "output.json");
+            plan.count = 1;
+        }
+        count = plan.count == 1 && plan.inputs[0] && plan.outputs[0] ? 1 : -1;
+    } else {
+        count = planBatch(options->outputDir ? options->outputDir : ".", inputs, inputCount, &plan);
+    }
+    if (count <= 0) {
+        fprintf(stderr, count == 0 ? "Error: No input files matched\n" : "Error: Out of memory\n");
+        freeBatchPlan(&plan);
+        return 1;
+    }
+
+    WatchedFile *files = (WatchedFile *)calloc(count, sizeof(WatchedFile));
+    if (!files) {
+        fprintf(stderr, "Error: Out of memory\n");
+        freeBatchPlan(&plan);
+        return 1;
+    }
+    int ready = 1;
+    for (int i = 0; i < count; i++) {
+        files[i].input = plan.inputs[i];
+        files[i].output = plan.outputs[i];
+        files[i].dir = directoryOf(plan.inputs[i], &files[i].name);
+        files[i].wd = -1;
+        if (!files[i].dir || !files[i].output) ready = 0;
+    }
+
+    if (ready) {
+        printf("Watching %d file(s) for changes (Ctrl-C to stop)...\n", count);
+        for (int i = 0; i < count; i++) {
+            refresh(&files[i], options);
+            if (!files[i].seen) {
+                printf("[watch] %s: not readable yet\n", files[i].input);
+            }
+        }
+        fflush(stdout);
+        watchLoop(files, count, options);
+    } else {
+        fprintf(stderr, "Error: Out of memory\n");
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(files[i].dir);
+        freeData(&files[i]);
+    }
+    free(files);
+    freeBatchPlan(&plan);
+    return 1;
+}
@@ -0,0 +1,22 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "tracecache.h"
+#include "vm.h"
+
+typedef struct {
+    const char *outputPath;  // Trace for a single input (NULL = output.json)
+    const char *outputDir;   // Directory for several inputs, named as in batch mode
+    const TraceCache *cache; // Shared trace cache (NULL = off)
+    const VMLimits *limits;  // Bounds on each program (NULL = defaults)
+} WatchOptions;
+
+// Compile every input, then keep recompiling whichever ones change, or
+// whose load() datasets change, until interrupted. Saves that leave a
+// program's contents unchanged are ignored; datasets are compared by size
+// and modification time.
+// Uses inotify on Linux and polls elsewhere. Returns 1 if watching could
+// not start.
+int runWatch(const WatchOptions *options, const char **inputs, int inputCount);
+
+#endif